@@ -30,7 +30,7 @@ static void configure_list_rows(GtkListBox* list, UpgUri* uri);
 
 static void new_window(GtkApplication*, gpointer);
 static void update_uri_field(UpgUri* uri, GParamSpec* spec, GtkEntry* entry);
-static void update_uri_data(GtkEntry* entry, UpgUri* uri);
+static void update_uri_data(GtkEntry* entry, UpgUriParser* parser);
 
 static void about(GtkApplication* app);
 
@@ -80,11 +80,12 @@ static void new_window(GtkApplication* app, gpointer data)
 {
     GtkBuilder* builder = gtk_builder_new_from_resource("/tk/thatlittlegit/liburiparser-gobject-demo/wizard.ui");
 
-    UpgUri* uri = upg_uri_new(NULL, NULL);
+    UpgUriParser* parser = upg_uri_parser_new();
+    UpgUri* uri = upg_uri_parser_get_uri(parser);
 
     GtkWidget* uriField = GTK_WIDGET(gtk_builder_get_object(builder, "uri-field"));
     g_signal_connect(uri, "notify", G_CALLBACK(update_uri_field), uriField);
-    g_signal_connect(uriField, "changed", G_CALLBACK(update_uri_data), uri);
+    g_signal_connect(uriField, "changed", G_CALLBACK(update_uri_data), parser);
 
     GtkListBox* list = GTK_LIST_BOX(gtk_builder_get_object(builder, "fields"));
     configure_list_rows(list, uri);
@@ -107,13 +108,13 @@ static void update_uri_field(UpgUri* uri, GParamSpec* spec, GtkEntry* entry)
     gtk_entry_set_text(entry, text ? text : "");
 }
 
-static void update_uri_data(GtkEntry* entry, UpgUri* uri)
+static void update_uri_data(GtkEntry* entry, UpgUriParser* parser)
 {
     g_return_if_fail(GTK_IS_ENTRY(entry));
-    g_return_if_fail(UPG_IS_URI(uri));
+    g_return_if_fail(UPG_IS_URI_PARSER(parser));
 
     const char* text = gtk_entry_get_text(entry);
-    gtk_entry_set_error(entry, !upg_uri_configure_from_string(uri, text, NULL));
+    gtk_entry_set_error(entry, upg_uri_parser_parse(parser, text, -1, NULL) == NULL);
 }
 
 static void about(GtkApplication* app)
@@ -0,0 +1,138 @@
+/* parse.fuzz.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include <liburiparser-gobject.h>
+#include <sanitizer/allocator_interface.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * This feeds arbitrary bytes to the parser, and then does the usual things
+ * with the result. As well as crashes, it treats any input that makes
+ * everything allocate too much, or take too long, for how long it is as a
+ * bug, so that anything quadratic turns up as a failure.
+ *
+ * Allocations are counted with the sanitizer's malloc hook, so everything is
+ * counted: liburiparser, GLib and the library itself, not just what goes
+ * through a UriMemoryManager.
+ *
+ * The thresholds can be changed with UPG_FUZZ_MAX_ALLOCS_PER_BYTE and
+ * UPG_FUZZ_MAX_NS_PER_BYTE, since sanitizers slow everything down.
+ */
+
+#define DEFAULT_MAX_ALLOCS_PER_BYTE 8
+#define DEFAULT_MAX_NS_PER_BYTE 20000
+/* fixed costs, so that tiny inputs don't fail because of them */
+#define ALLOC_SLACK 256
+#define NS_SLACK (10 * G_TIME_SPAN_MILLISECOND * 1000)
+
+static gboolean counting = FALSE;
+static gsize allocations = 0;
+
+static void count_malloc(const volatile void* ptr, size_t size)
+{
+    (void)ptr;
+    (void)size;
+
+    if (counting)
+        allocations++;
+}
+
+static void count_free(const volatile void* ptr)
+{
+    (void)ptr;
+}
+
+static guint64 threshold_from_env(const gchar* name, guint64 fallback)
+{
+    const gchar* value = g_getenv(name);
+    return value != NULL ? g_ascii_strtoull(value, NULL, 10) : fallback;
+}
+
+static void exercise(UpgUri* uri)
+{
+    g_free(upg_uri_to_string(uri));
+    g_list_free_full(upg_uri_get_path(uri), g_free);
+
+    GHashTable* query = upg_uri_get_query(uri);
+    if (query != NULL)
+        g_hash_table_unref(query);
+
+    GHashTable* fragment = upg_uri_get_fragment_params(uri);
+    if (fragment != NULL)
+        g_hash_table_unref(fragment);
+
+    UpgParamIter iter;
+    upg_param_iter_init_query(&iter, uri);
+    while (upg_param_iter_next(&iter, NULL, NULL)) {
+    }
+
+    UpgUri* copy = upg_uri_copy(uri);
+    g_object_unref(copy);
+}
+
+int LLVMFuzzerTestOneInput(const guint8* data, size_t size)
+{
+    static guint64 max_allocs_per_byte = 0;
+    static guint64 max_ns_per_byte = 0;
+    if (max_allocs_per_byte == 0) {
+        max_allocs_per_byte = threshold_from_env("UPG_FUZZ_MAX_ALLOCS_PER_BYTE", DEFAULT_MAX_ALLOCS_PER_BYTE);
+        max_ns_per_byte = threshold_from_env("UPG_FUZZ_MAX_NS_PER_BYTE", DEFAULT_MAX_NS_PER_BYTE);
+        __sanitizer_install_malloc_and_free_hooks(count_malloc, count_free);
+
+        // the types and their classes are set up the first time around, which
+        // shouldn't count against whatever input happens to come first
+        UpgUri* warm = upg_uri_new("http://user@example.com:80/a/b?c=d&e#f=g", NULL);
+        exercise(warm);
+        g_object_unref(warm);
+    }
+
+    // GLib wants nul-terminated text, and the parser doesn't allow nul bytes
+    gchar* text = g_strndup((const gchar*)data, size);
+    gsize len = strlen(text);
+
+    allocations = 0;
+    counting = TRUE;
+    gint64 start = g_get_monotonic_time();
+
+    UpgLimits limits;
+    upg_limits_init_default(&limits);
+    UpgUri* uri = upg_uri_new_full(text, &limits, NULL);
+    if (uri != NULL) {
+        exercise(uri);
+        g_object_unref(uri);
+    }
+
+    guint64 elapsed_ns = (guint64)(g_get_monotonic_time() - start) * 1000;
+    counting = FALSE;
+
+    if (allocations > max_allocs_per_byte * len + ALLOC_SLACK) {
+        fprintf(stderr, "%" G_GSIZE_FORMAT " allocations for %" G_GSIZE_FORMAT " bytes\n", allocations, len);
+        abort();
+    }
+
+    if (elapsed_ns > max_ns_per_byte * len + NS_SLACK) {
+        fprintf(stderr, "%" G_GUINT64_FORMAT " ns for %" G_GSIZE_FORMAT " bytes\n", elapsed_ns, len);
+        abort();
+    }
+
+    g_free(text);
+    return 0;
+}
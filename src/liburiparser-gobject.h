@@ -27,6 +27,21 @@ G_BEGIN_DECLS
 #include "liburiparser-gobject-version.h"
 #include "upgerror.h"
 #include "upguri.h"
+#include "upgparser.h"
+#include "upgbuilder.h"
+#include "upgwriter.h"
+#include "upgresolver.h"
+#include "upgtrie.h"
+#include "upgset.h"
+#include "upgbloom.h"
+#include "upgsort.h"
+#include "upgsurt.h"
+#include "upgshard.h"
+#include "upgparams.h"
+#include "upgcanonicalizer.h"
+#include "upgqueryfilter.h"
+#include "upgrewrite.h"
+#include "upgrouter.h"
 #undef __LIBURIPARSER_GOBJECT_INSIDE__
 
 G_END_DECLS
@@ -0,0 +1,480 @@
+/* upgbloom.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgbloom.h"
+#include "upgparser.h"
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define UPG_BLOOM_BLOCK_BYTES 64
+#define UPG_BLOOM_BLOCK_BITS (UPG_BLOOM_BLOCK_BYTES * 8)
+#define UPG_BLOOM_MAX_HASHES 16
+#define UPG_BLOOM_MAGIC "UPGBLOOM"
+#define UPG_BLOOM_VERSION 1
+
+/**
+ * SECTION:upgbloom
+ * @short_description: Checking whether a URI has probably been seen
+ * @include: liburiparser-gobject.h
+ * @title: UpgBloomFilter
+ *
+ * #UpgBloomFilter remembers URIs approximately: it can say for sure that a
+ * URI hasn't been added, but sometimes says one has been when it hasn't. In
+ * exchange it takes a few bits per URI, however long they are, where
+ * #UpgUriSet keeps all of the text.
+ *
+ * URIs are hashed part by part after being parsed and normalized, just like
+ * upg_uri_configure_from_string() does, so `HTTP://Example.COM/a/../b` and
+ * `http://example.com/b` are the same URI to the filter, whether they're given
+ * as strings or as #UpgUri.
+ *
+ * The filter is split into blocks the size of a cache line, and all of the bits
+ * for a URI are in the same block, so checking one costs a single cache miss.
+ * That makes false positives a little more likely than in a plain Bloom
+ * filter, which upg_bloom_filter_new() makes up for by using a bit more
+ * memory.
+ *
+ * Filters can be written to a file with upg_bloom_filter_save() and read back
+ * with upg_bloom_filter_load(); the file is the same on every platform.
+ *
+ * Nothing is shared between calls besides the bits, so a filter that isn't
+ * being added to can be checked from several threads at once. Adding needs
+ * the caller to lock, like any other #GObject.
+ */
+struct _UpgBloomFilter {
+    GObject parent_instance;
+
+    guint8* allocation;
+    guint8* blocks;
+    guint64 n_blocks;
+    guint n_hashes;
+};
+
+G_DEFINE_TYPE(UpgBloomFilter, upg_bloom_filter, G_TYPE_OBJECT)
+
+static void upg_bloom_filter_finalize(GObject* obj)
+{
+    UpgBloomFilter* self = UPG_BLOOM_FILTER(obj);
+
+    g_free(self->allocation);
+
+    G_OBJECT_CLASS(upg_bloom_filter_parent_class)->finalize(obj);
+}
+
+static void upg_bloom_filter_class_init(UpgBloomFilterClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_bloom_filter_finalize;
+}
+
+static void upg_bloom_filter_init(UpgBloomFilter* self)
+{
+}
+
+static UpgBloomFilter* upg_bloom_filter_new_sized(guint64 n_blocks, guint n_hashes)
+{
+    UpgBloomFilter* self = g_object_new(UPG_TYPE_BLOOM_FILTER, NULL);
+    self->n_blocks = n_blocks;
+    self->n_hashes = n_hashes;
+
+    // g_aligned_alloc() is too new, so line the blocks up by hand
+    self->allocation = g_malloc0(n_blocks * UPG_BLOOM_BLOCK_BYTES + UPG_BLOOM_BLOCK_BYTES - 1);
+    self->blocks = (guint8*)(((guintptr)self->allocation + UPG_BLOOM_BLOCK_BYTES - 1) & ~(guintptr)(UPG_BLOOM_BLOCK_BYTES - 1));
+
+    return self;
+}
+
+/**
+ * upg_bloom_filter_new:
+ * @expected_items: How many URIs the filter is expected to hold.
+ * @false_positive_rate: How often the filter should be wrong about a URI being
+ *                       there once it holds @expected_items, between 0 and 1.
+ *
+ * Creates a new, empty #UpgBloomFilter that's big enough to hold
+ * @expected_items URIs with the given false positive rate. It can hold more,
+ * but it'll be wrong more often.
+ *
+ * Returns: (transfer full): a new #UpgBloomFilter.
+ */
+UpgBloomFilter* upg_bloom_filter_new(guint64 expected_items, gdouble false_positive_rate)
+{
+    g_return_val_if_fail(false_positive_rate > 0 && false_positive_rate < 1, NULL);
+
+    gdouble n = MAX(expected_items, 1);
+    gdouble bits = -n * log(false_positive_rate) / (G_LN2 * G_LN2);
+
+    // blocking wastes a little of each block; a fifth more bits covers it for
+    // the usual rates
+    bits *= 1.2;
+
+    guint64 n_blocks = MAX((guint64)ceil(bits / UPG_BLOOM_BLOCK_BITS), 1);
+    guint n_hashes = CLAMP((guint)round(bits / n * G_LN2), 1, UPG_BLOOM_MAX_HASHES);
+
+    return upg_bloom_filter_new_sized(n_blocks, n_hashes);
+}
+
+static guint64 upg_bloom_mix(guint64 hash)
+{
+    hash ^= hash >> 31;
+    hash *= G_GUINT64_CONSTANT(0x7fb5d329728ea185);
+    hash ^= hash >> 27;
+    hash *= G_GUINT64_CONSTANT(0x81dadef4bc2dd44d);
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/*
+ * upg_bloom_filter_apply:
+ * @self: The filter.
+ * @hash: The hash of a URI.
+ * @set: Whether to set the bits for @hash, or just check them.
+ *
+ * Finds the block for @hash, and then the bits in it; nine bits of hash pick
+ * each one, and when a hash runs out a new one is mixed from it.
+ *
+ * Returns: Whether all of the bits were already set.
+ */
+static gboolean upg_bloom_filter_apply(UpgBloomFilter* self, guint64 hash, gboolean set)
+{
+    guint8* block = self->blocks + (hash % self->n_blocks) * UPG_BLOOM_BLOCK_BYTES;
+    guint64 bits = upg_bloom_mix(hash);
+    gboolean present = TRUE;
+
+    for (guint i = 0; i < self->n_hashes; i++) {
+        if (i > 0 && i % 7 == 0) {
+            bits = upg_bloom_mix(bits);
+        }
+
+        guint bit = (bits >> ((i % 7) * 9)) & (UPG_BLOOM_BLOCK_BITS - 1);
+        guint8 mask = 1 << (bit & 7);
+        if (!(block[bit >> 3] & mask)) {
+            present = FALSE;
+            if (!set) {
+                return FALSE;
+            }
+            block[bit >> 3] |= mask;
+        }
+    }
+
+    return present;
+}
+
+/*
+ * upg_bloom_hash_text:
+ * @str: The URI, as text.
+ * @len: The length of @str.
+ * @hash: (out): Where to put the hash.
+ * @error: A #GError.
+ *
+ * Parses and normalizes @str like upg_uri_configure_from_string() would, and
+ * hashes the result.
+ *
+ * Returns: Whether @str could be parsed; if not, @error is set.
+ */
+static gboolean upg_bloom_hash_text(const gchar* str, gsize len, guint64* hash, GError** error)
+{
+    // parse into the stack rather than a parser kept on the filter, so
+    // that two threads can check the same filter
+    guint8 buffer[2048];
+    UpgArena arena;
+    upg_arena_init(&arena, buffer, sizeof(buffer));
+
+    UriUriA parsed;
+    gboolean success = upg_uri_parse_range(&parsed, str, str + len, &arena.memory, error);
+    if (success) {
+        *hash = upg_uri_hash_parsed(&parsed);
+    }
+
+    upg_arena_clear(&arena);
+    return success;
+}
+
+/*
+ * upg_bloom_hash_uri:
+ * @uri: The URI to hash.
+ *
+ * Hashes @uri as if it had been given as text. Setters and #UpgUriBuilder
+ * don't normalize, so @uri is written out and parsed again; if that doesn't
+ * work, its parts are hashed as they are.
+ *
+ * Returns: The hash of @uri.
+ */
+static guint64 upg_bloom_hash_uri(UpgUri* uri)
+{
+    gchar buffer[1024];
+    gchar* text = buffer;
+    gsize len = 0;
+    if (!upg_uri_to_string_buf(uri, buffer, sizeof(buffer), &len)) {
+        text = upg_uri_to_string(uri);
+        len = strlen(text);
+    }
+
+    guint64 hash;
+    if (!upg_bloom_hash_text(text, len, &hash, NULL)) {
+        hash = upg_uri_hash_components(uri);
+    }
+
+    if (text != buffer) {
+        g_free(text);
+    }
+    return hash;
+}
+
+/**
+ * upg_bloom_filter_add:
+ * @self: The filter to add to.
+ * @uri: (transfer none) (not nullable): The URI to add.
+ *
+ * Adds @uri to @self.
+ */
+void upg_bloom_filter_add(UpgBloomFilter* self, UpgUri* uri)
+{
+    g_return_if_fail(UPG_IS_BLOOM_FILTER(self));
+    g_return_if_fail(UPG_IS_URI(uri));
+
+    upg_bloom_filter_apply(self, upg_bloom_hash_uri(uri), TRUE);
+}
+
+/**
+ * upg_bloom_filter_add_string:
+ * @self: The filter to add to.
+ * @uri: (transfer none) (not nullable): The URI to add, as text.
+ * @error: A #GError.
+ *
+ * Parses @uri and adds it to @self.
+ *
+ * Returns: Whether @uri could be parsed; if not, @error is set.
+ */
+gboolean upg_bloom_filter_add_string(UpgBloomFilter* self, const gchar* uri, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_BLOOM_FILTER(self), FALSE);
+    g_return_val_if_fail(uri != NULL, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    guint64 hash;
+    if (!upg_bloom_hash_text(uri, strlen(uri), &hash, error)) {
+        return FALSE;
+    }
+
+    upg_bloom_filter_apply(self, hash, TRUE);
+    return TRUE;
+}
+
+/**
+ * upg_bloom_filter_contains:
+ * @self: The filter to look in.
+ * @uri: (transfer none) (not nullable): The URI to look for.
+ *
+ * Checks if @uri has (probably) been added to @self.
+ *
+ * Returns: %FALSE if @uri definitely hasn't been added, and %TRUE if it
+ * probably has.
+ */
+gboolean upg_bloom_filter_contains(UpgBloomFilter* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_BLOOM_FILTER(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+
+    return upg_bloom_filter_apply(self, upg_bloom_hash_uri(uri), FALSE);
+}
+
+/**
+ * upg_bloom_filter_contains_string:
+ * @self: The filter to look in.
+ * @uri: (transfer none) (not nullable): The URI to look for, as text.
+ * @error: A #GError.
+ *
+ * Parses @uri and checks if it has (probably) been added to @self.
+ *
+ * Returns: %FALSE if @uri definitely hasn't been added or couldn't be parsed
+ * (in which case @error is set), and %TRUE if it probably has been added.
+ */
+gboolean upg_bloom_filter_contains_string(UpgBloomFilter* self, const gchar* uri, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_BLOOM_FILTER(self), FALSE);
+    g_return_val_if_fail(uri != NULL, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    guint64 hash;
+    if (!upg_bloom_hash_text(uri, strlen(uri), &hash, error)) {
+        return FALSE;
+    }
+
+    return upg_bloom_filter_apply(self, hash, FALSE);
+}
+
+/**
+ * upg_bloom_filter_get_size:
+ * @self: The filter.
+ *
+ * Gets how much memory the bits of @self take up.
+ *
+ * Returns: The size of @self, in bytes.
+ */
+gsize upg_bloom_filter_get_size(UpgBloomFilter* self)
+{
+    g_return_val_if_fail(UPG_IS_BLOOM_FILTER(self), 0);
+
+    return self->n_blocks * UPG_BLOOM_BLOCK_BYTES;
+}
+
+/*
+ * UpgBloomHeader:
+ *
+ * The start of a saved filter; the blocks come straight after it. All of the
+ * numbers are little-endian.
+ */
+typedef struct {
+    gchar magic[8];
+    guint32 version;
+    guint32 n_hashes;
+    guint64 n_blocks;
+} UpgBloomHeader;
+
+static void upg_bloom_set_format_error(GError** error, const gchar* filename, const gchar* problem)
+{
+    gchar* display = g_filename_display_name(filename);
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "“%s” %s", display, problem);
+    g_free(display);
+}
+
+static void upg_bloom_set_file_error(GError** error, const gchar* filename, const gchar* doing)
+{
+    int saved = errno;
+    gchar* display = g_filename_display_name(filename);
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved),
+        "Failed to %s “%s”: %s", doing, display, g_strerror(saved));
+    g_free(display);
+}
+
+/**
+ * upg_bloom_filter_save:
+ * @self: The filter to save.
+ * @filename: (type filename): Where to save it.
+ * @error: A #GError.
+ *
+ * Writes @self to @filename, replacing anything that was there, so that it
+ * can be read back with upg_bloom_filter_load().
+ *
+ * Returns: Whether the filter was saved; if not, @error is set.
+ */
+gboolean upg_bloom_filter_save(UpgBloomFilter* self, const gchar* filename, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_BLOOM_FILTER(self), FALSE);
+    g_return_val_if_fail(filename != NULL, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    UpgBloomHeader header;
+    memcpy(header.magic, UPG_BLOOM_MAGIC, sizeof(header.magic));
+    header.version = GUINT32_TO_LE(UPG_BLOOM_VERSION);
+    header.n_hashes = GUINT32_TO_LE(self->n_hashes);
+    header.n_blocks = GUINT64_TO_LE(self->n_blocks);
+
+    FILE* file = g_fopen(filename, "wb");
+    if (file == NULL) {
+        upg_bloom_set_file_error(error, filename, "open");
+        return FALSE;
+    }
+
+    gsize size = upg_bloom_filter_get_size(self);
+    if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(self->blocks, 1, size, file) != size) {
+        upg_bloom_set_file_error(error, filename, "write to");
+        fclose(file);
+        return FALSE;
+    }
+
+    if (fclose(file) != 0) {
+        upg_bloom_set_file_error(error, filename, "close");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * upg_bloom_filter_load:
+ * @filename: (type filename): The file to load.
+ * @error: A #GError.
+ *
+ * Reads a filter that was written by upg_bloom_filter_save(). The file has to
+ * be exactly as long as its header says; nothing is allocated until that's
+ * been checked.
+ *
+ * Returns: (transfer full): The filter, or %NULL if @error is set.
+ */
+UpgBloomFilter* upg_bloom_filter_load(const gchar* filename, GError** error)
+{
+    g_return_val_if_fail(filename != NULL, NULL);
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+    FILE* file = g_fopen(filename, "rb");
+    if (file == NULL) {
+        upg_bloom_set_file_error(error, filename, "open");
+        return NULL;
+    }
+
+    UpgBloomHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, UPG_BLOOM_MAGIC, sizeof(header.magic)) != 0
+        || GUINT32_FROM_LE(header.version) != UPG_BLOOM_VERSION
+        || GUINT32_FROM_LE(header.n_hashes) == 0
+        || GUINT32_FROM_LE(header.n_hashes) > UPG_BLOOM_MAX_HASHES
+        || GUINT64_FROM_LE(header.n_blocks) == 0
+        || GUINT64_FROM_LE(header.n_blocks) > G_MAXSIZE / UPG_BLOOM_BLOCK_BYTES - 1) {
+        upg_bloom_set_format_error(error, filename, "isn't a saved Bloom filter");
+        fclose(file);
+        return NULL;
+    }
+
+    // the header can't be trusted to say how much to allocate, so make sure
+    // the file really is that long first
+    gsize size = (gsize)GUINT64_FROM_LE(header.n_blocks) * UPG_BLOOM_BLOCK_BYTES;
+    struct stat info;
+    if (fstat(fileno(file), &info) != 0) {
+        upg_bloom_set_file_error(error, filename, "read");
+        fclose(file);
+        return NULL;
+    }
+    guint64 expected = sizeof(header) + (guint64)size;
+    if (S_ISREG(info.st_mode) && (guint64)info.st_size != expected) {
+        upg_bloom_set_format_error(error, filename,
+            (guint64)info.st_size < expected ? "is cut short" : "has data after the filter");
+        fclose(file);
+        return NULL;
+    }
+
+    UpgBloomFilter* self = upg_bloom_filter_new_sized(GUINT64_FROM_LE(header.n_blocks), GUINT32_FROM_LE(header.n_hashes));
+    if (fread(self->blocks, 1, size, file) != size || fgetc(file) != EOF) {
+        if (ferror(file)) {
+            upg_bloom_set_file_error(error, filename, "read");
+        } else {
+            upg_bloom_set_format_error(error, filename, feof(file) ? "is cut short" : "has data after the filter");
+        }
+        g_object_unref(self);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    return self;
+}
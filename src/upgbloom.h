@@ -0,0 +1,48 @@
+/* upgbloom.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGBLOOM_H
+#define UPGBLOOM_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+#define UPG_TYPE_BLOOM_FILTER upg_bloom_filter_get_type()
+G_DECLARE_FINAL_TYPE(UpgBloomFilter, upg_bloom_filter, UPG, BLOOM_FILTER, GObject)
+
+UpgBloomFilter* upg_bloom_filter_new(guint64 expected_items, gdouble false_positive_rate);
+UpgBloomFilter* upg_bloom_filter_load(const gchar* filename, GError** error);
+gboolean upg_bloom_filter_save(UpgBloomFilter* self, const gchar* filename, GError** error);
+void upg_bloom_filter_add(UpgBloomFilter* self, UpgUri* uri);
+gboolean upg_bloom_filter_add_string(UpgBloomFilter* self, const gchar* uri, GError** error);
+gboolean upg_bloom_filter_contains(UpgBloomFilter* self, UpgUri* uri);
+gboolean upg_bloom_filter_contains_string(UpgBloomFilter* self, const gchar* uri, GError** error);
+gsize upg_bloom_filter_get_size(UpgBloomFilter* self);
+
+G_END_DECLS
+
+#endif
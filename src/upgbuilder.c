@@ -0,0 +1,505 @@
+/* upgbuilder.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgbuilder.h"
+#include <string.h>
+#include <uriparser/Uri.h>
+
+/**
+ * SECTION:upgbuilder
+ * @short_description: Putting URIs together from their parts
+ * @include: liburiparser-gobject.h
+ * @title: UpgUriBuilder
+ *
+ * #UpgUriBuilder collects the parts of a URI and then writes them all out at
+ * once. Making a #UpgUri with upg_uri_new() and then calling all of its setters
+ * copies every part separately (and notifies for each one); the builder works
+ * out how big the finished URI will be and puts everything, path segments
+ * included, into a single allocation.
+ *
+ * The parts are used as they are given, just like with the setters on
+ * #UpgUri: nothing is escaped or normalized, so make sure they are already
+ * valid (except for slashes in path segments). A host with a colon in it is
+ * taken to be an IPv6 address, and gets brackets around it; the #UpgUri from
+ * upg_uri_builder_to_uri() knows what kind of host it has, just like a parsed
+ * one.
+ *
+ * |[<!-- language="C" -->
+ * UpgUriBuilder* builder = upg_uri_builder_new ();
+ * upg_uri_builder_set_scheme (builder, "https");
+ * upg_uri_builder_set_host (builder, "example.com");
+ * upg_uri_builder_append_segment (builder, "users");
+ * upg_uri_builder_append_segment (builder, "42");
+ * upg_uri_builder_add_query_param (builder, "tab", "posts");
+ *
+ * // https://example.com/users/42?tab=posts
+ * gchar* str = upg_uri_builder_to_string (builder);
+ * ]|
+ *
+ * A builder can be used again after upg_uri_builder_reset(), and keeps its
+ * buffers when it is.
+ */
+
+typedef struct {
+    gssize offset;
+    gsize len;
+} UpgBuilderRange;
+
+struct _UpgUriBuilder {
+    GObject parent_instance;
+
+    GString* scratch;
+    UpgBuilderRange scheme;
+    UpgBuilderRange userinfo;
+    UpgBuilderRange host;
+    UpgBuilderRange fragment;
+    guint16 port;
+    GString* path;
+    GString* query;
+    gboolean has_query;
+};
+
+G_DEFINE_TYPE(UpgUriBuilder, upg_uri_builder, G_TYPE_OBJECT)
+
+static void* upg_uri_builder_mm_malloc(UriMemoryManager* memory, size_t size)
+{
+    return g_malloc(size);
+}
+
+static void* upg_uri_builder_mm_calloc(UriMemoryManager* memory, size_t nmemb, size_t size)
+{
+    return g_malloc0_n(nmemb, size);
+}
+
+static void* upg_uri_builder_mm_realloc(UriMemoryManager* memory, void* ptr, size_t size)
+{
+    return g_realloc(ptr, size);
+}
+
+static void* upg_uri_builder_mm_reallocarray(UriMemoryManager* memory, void* ptr, size_t nmemb, size_t size)
+{
+    return g_realloc_n(ptr, nmemb, size);
+}
+
+static void upg_uri_builder_mm_free(UriMemoryManager* memory, void* ptr)
+{
+    // the path segments live in the same buffer as the text, which the URI
+    // frees by itself
+}
+
+static UriMemoryManager upg_uri_builder_memory = {
+    upg_uri_builder_mm_malloc,
+    upg_uri_builder_mm_calloc,
+    upg_uri_builder_mm_realloc,
+    upg_uri_builder_mm_reallocarray,
+    upg_uri_builder_mm_free,
+    NULL,
+};
+
+static void upg_uri_builder_finalize(GObject* obj)
+{
+    UpgUriBuilder* self = UPG_URI_BUILDER(obj);
+
+    g_string_free(self->scratch, TRUE);
+    g_string_free(self->path, TRUE);
+    g_string_free(self->query, TRUE);
+
+    G_OBJECT_CLASS(upg_uri_builder_parent_class)->finalize(obj);
+}
+
+static void upg_uri_builder_class_init(UpgUriBuilderClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_uri_builder_finalize;
+}
+
+static void upg_uri_builder_init(UpgUriBuilder* self)
+{
+    self->scratch = g_string_new(NULL);
+    self->path = g_string_new(NULL);
+    self->query = g_string_new(NULL);
+    upg_uri_builder_reset(self);
+}
+
+/**
+ * upg_uri_builder_new:
+ *
+ * Creates a new, empty #UpgUriBuilder.
+ *
+ * Returns: (transfer full): a new #UpgUriBuilder.
+ */
+UpgUriBuilder* upg_uri_builder_new(void)
+{
+    return g_object_new(UPG_TYPE_URI_BUILDER, NULL);
+}
+
+/**
+ * upg_uri_builder_reset:
+ * @self: The builder to reset.
+ *
+ * Forgets all of the parts given to @self so far, so that it can be used for
+ * another URI.
+ */
+void upg_uri_builder_reset(UpgUriBuilder* self)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+
+    g_string_truncate(self->scratch, 0);
+    g_string_truncate(self->path, 0);
+    g_string_truncate(self->query, 0);
+
+    self->scheme = (UpgBuilderRange) { -1, 0 };
+    self->userinfo = (UpgBuilderRange) { -1, 0 };
+    self->host = (UpgBuilderRange) { -1, 0 };
+    self->fragment = (UpgBuilderRange) { -1, 0 };
+    self->port = 0;
+    self->has_query = FALSE;
+}
+
+static void upg_uri_builder_store(UpgUriBuilder* self, UpgBuilderRange* range, const gchar* str)
+{
+    if (str == NULL) {
+        *range = (UpgBuilderRange) { -1, 0 };
+        return;
+    }
+
+    range->offset = self->scratch->len;
+    range->len = strlen(str);
+    g_string_append_len(self->scratch, str, range->len);
+}
+
+/**
+ * upg_uri_builder_set_scheme:
+ * @self: The builder to change.
+ * @scheme: (transfer none) (nullable): The scheme, or %NULL for none.
+ *
+ * Sets the scheme that the built URI will have.
+ */
+void upg_uri_builder_set_scheme(UpgUriBuilder* self, const gchar* scheme)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+
+    upg_uri_builder_store(self, &self->scheme, scheme);
+}
+
+/**
+ * upg_uri_builder_set_userinfo:
+ * @self: The builder to change.
+ * @userinfo: (transfer none) (nullable): The user information, or %NULL for
+ *            none.
+ *
+ * Sets the user information that the built URI will have. This is ignored if
+ * there is no host.
+ */
+void upg_uri_builder_set_userinfo(UpgUriBuilder* self, const gchar* userinfo)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+
+    upg_uri_builder_store(self, &self->userinfo, userinfo);
+}
+
+/**
+ * upg_uri_builder_set_host:
+ * @self: The builder to change.
+ * @host: (transfer none) (nullable): The host, or %NULL for none.
+ *
+ * Sets the host that the built URI will have. If the host is %NULL, then the
+ * URI doesn't have an authority at all; use "" for an empty one, like in
+ * `file:///etc/passwd`.
+ */
+void upg_uri_builder_set_host(UpgUriBuilder* self, const gchar* host)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+
+    upg_uri_builder_store(self, &self->host, host);
+}
+
+/**
+ * upg_uri_builder_set_port:
+ * @self: The builder to change.
+ * @port: The port, or 0 for none.
+ *
+ * Sets the port that the built URI will have. Like upg_uri_set_port(), 0 means
+ * that there isn't a port. This is ignored if there is no host.
+ */
+void upg_uri_builder_set_port(UpgUriBuilder* self, guint16 port)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+
+    self->port = port;
+}
+
+/**
+ * upg_uri_builder_append_segment:
+ * @self: The builder to change.
+ * @segment: (transfer none) (not nullable): The path segment to add.
+ *
+ * Adds @segment to the end of the path. The path always starts with a slash.
+ *
+ * Unlike everything else, a slash in @segment is escaped, as `%2F`, since
+ * otherwise it would turn into more than one segment.
+ */
+void upg_uri_builder_append_segment(UpgUriBuilder* self, const gchar* segment)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+    g_return_if_fail(segment != NULL);
+
+    g_string_append_c(self->path, '/');
+    for (const gchar* slash; (slash = strchr(segment, '/')) != NULL; segment = slash + 1) {
+        g_string_append_len(self->path, segment, slash - segment);
+        g_string_append(self->path, "%2F");
+    }
+    g_string_append(self->path, segment);
+}
+
+/**
+ * upg_uri_builder_add_query_param:
+ * @self: The builder to change.
+ * @key: (transfer none) (not nullable): The name of the parameter.
+ * @value: (transfer none) (nullable): The value of the parameter, or %NULL for
+ *         a parameter without a value.
+ *
+ * Adds a query parameter after any that were added before.
+ */
+void upg_uri_builder_add_query_param(UpgUriBuilder* self, const gchar* key, const gchar* value)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+    g_return_if_fail(key != NULL);
+
+    if (self->has_query) {
+        g_string_append_c(self->query, '&');
+    }
+
+    g_string_append(self->query, key);
+    if (value != NULL) {
+        g_string_append_c(self->query, '=');
+        g_string_append(self->query, value);
+    }
+
+    self->has_query = TRUE;
+}
+
+/**
+ * upg_uri_builder_set_fragment:
+ * @self: The builder to change.
+ * @fragment: (transfer none) (nullable): The fragment, or %NULL for none.
+ *
+ * Sets the fragment that the built URI will have.
+ */
+void upg_uri_builder_set_fragment(UpgUriBuilder* self, const gchar* fragment)
+{
+    g_return_if_fail(UPG_IS_URI_BUILDER(self));
+
+    upg_uri_builder_store(self, &self->fragment, fragment);
+}
+
+static gboolean upg_uri_builder_host_is_ipv6(UpgUriBuilder* self)
+{
+    return self->host.offset >= 0 && memchr(self->scratch->str + self->host.offset, ':', self->host.len) != NULL;
+}
+
+/*
+ * upg_uri_builder_measure:
+ * @self: The builder to measure.
+ *
+ * Works out how long the built URI is going to be.
+ *
+ * Returns: the length of the URI, not including the nul.
+ */
+static gsize upg_uri_builder_measure(UpgUriBuilder* self)
+{
+    gsize len = 0;
+
+    if (self->scheme.offset >= 0) {
+        len += self->scheme.len + 1;
+    }
+
+    if (self->host.offset >= 0) {
+        len += 2 + self->host.len;
+
+        if (self->userinfo.offset >= 0) {
+            len += self->userinfo.len + 1;
+        }
+
+        if (upg_uri_builder_host_is_ipv6(self)) {
+            len += 2;
+        }
+
+        if (self->port != 0) {
+            len += 1 + (self->port >= 10000 ? 5 : self->port >= 1000 ? 4 : self->port >= 100 ? 3 : self->port >= 10 ? 2 : 1);
+        }
+    }
+
+    len += self->path->len;
+
+    if (self->has_query) {
+        len += 1 + self->query->len;
+    }
+
+    if (self->fragment.offset >= 0) {
+        len += 1 + self->fragment.len;
+    }
+
+    return len;
+}
+
+static UriTextRangeA upg_uri_builder_copy(gchar** cursor, const gchar* str, gsize len)
+{
+    UriTextRangeA range = { *cursor, *cursor + len };
+    memcpy(*cursor, str, len);
+    *cursor += len;
+    return range;
+}
+
+/*
+ * upg_uri_builder_write:
+ * @self: The builder to write out.
+ * @out: Where to write the URI, which has room for upg_uri_builder_measure()
+ *       bytes and a nul.
+ * @uri: (out caller-allocates): A UriUriA to point at the written parts.
+ * @segments: (nullable): Room for the path segments of @uri, or %NULL if they
+ *            aren't needed.
+ *
+ * Writes the URI out into @out, and fills in @uri so that it refers to it.
+ */
+static void upg_uri_builder_write(UpgUriBuilder* self, gchar* out, UriUriA* uri, UriPathSegmentA* segments)
+{
+    const gchar* scratch = self->scratch->str;
+    gchar* cursor = out;
+
+    memset(uri, 0, sizeof(UriUriA));
+
+    if (self->scheme.offset >= 0) {
+        uri->scheme = upg_uri_builder_copy(&cursor, scratch + self->scheme.offset, self->scheme.len);
+        *cursor++ = ':';
+    }
+
+    if (self->host.offset >= 0) {
+        *cursor++ = '/';
+        *cursor++ = '/';
+
+        if (self->userinfo.offset >= 0) {
+            uri->userInfo = upg_uri_builder_copy(&cursor, scratch + self->userinfo.offset, self->userinfo.len);
+            *cursor++ = '@';
+        }
+
+        gboolean ipv6 = upg_uri_builder_host_is_ipv6(self);
+        if (ipv6) {
+            *cursor++ = '[';
+        }
+        uri->hostText = upg_uri_builder_copy(&cursor, scratch + self->host.offset, self->host.len);
+        if (ipv6) {
+            *cursor++ = ']';
+        }
+
+        if (self->port != 0) {
+            gchar port[6];
+            gint len = g_snprintf(port, sizeof(port), "%u", self->port);
+            *cursor++ = ':';
+            uri->portText = upg_uri_builder_copy(&cursor, port, len);
+        }
+    }
+
+    gchar* path = cursor;
+    upg_uri_builder_copy(&cursor, self->path->str, self->path->len);
+
+    if (segments != NULL && self->path->len > 0) {
+        UriPathSegmentA* segment = segments;
+        gchar* start = path + 1;
+
+        for (gchar* current = start; current <= cursor; current++) {
+            if (current != cursor && *current != '/') {
+                continue;
+            }
+
+            *segment = (UriPathSegmentA) { { start, current }, segment + 1 };
+            segment++;
+            start = current + 1;
+        }
+
+        segment[-1].next = NULL;
+        uri->pathHead = segments;
+        uri->pathTail = &segment[-1];
+        uri->absolutePath = self->host.offset < 0;
+    }
+
+    if (self->has_query) {
+        *cursor++ = '?';
+        uri->query = upg_uri_builder_copy(&cursor, self->query->str, self->query->len);
+    }
+
+    if (self->fragment.offset >= 0) {
+        *cursor++ = '#';
+        uri->fragment = upg_uri_builder_copy(&cursor, scratch + self->fragment.offset, self->fragment.len);
+    }
+
+    *cursor = '\0';
+    uri->owner = URI_FALSE;
+}
+
+/**
+ * upg_uri_builder_to_string:
+ * @self: The builder to use.
+ *
+ * Writes out the URI that @self describes. The string is allocated once, at
+ * exactly the right size.
+ *
+ * Returns: (transfer full): The built URI.
+ */
+gchar* upg_uri_builder_to_string(UpgUriBuilder* self)
+{
+    g_return_val_if_fail(UPG_IS_URI_BUILDER(self), NULL);
+
+    UriUriA uri;
+    gchar* out = g_malloc(upg_uri_builder_measure(self) + 1);
+    upg_uri_builder_write(self, out, &uri, NULL);
+    return out;
+}
+
+/**
+ * upg_uri_builder_to_uri:
+ * @self: The builder to use.
+ *
+ * Makes a new #UpgUri out of the parts given to @self. All of the text and the
+ * path segments of the URI are kept in one allocation, and since nothing is
+ * parsed, this can't fail.
+ *
+ * Returns: (transfer full): a new #UpgUri.
+ */
+UpgUri* upg_uri_builder_to_uri(UpgUriBuilder* self)
+{
+    g_return_val_if_fail(UPG_IS_URI_BUILDER(self), NULL);
+
+    guint n_segments = 0;
+    for (gsize i = 0; i < self->path->len; i++) {
+        n_segments += self->path->str[i] == '/';
+    }
+
+    gsize text_size = upg_uri_builder_measure(self) + 1;
+    gsize segments_offset = (text_size + sizeof(gpointer) - 1) & ~(sizeof(gpointer) - 1);
+    gchar* buffer = g_malloc(segments_offset + n_segments * sizeof(UriPathSegmentA));
+
+    UriUriA uri;
+    upg_uri_builder_write(self, buffer, &uri, (UriPathSegmentA*)(buffer + segments_offset));
+
+    UpgUri* ret = upg_uri_new(NULL, NULL);
+    upg_uri_take_internal(ret, &uri, &upg_uri_builder_memory, buffer);
+    return ret;
+}
@@ -0,0 +1,51 @@
+/* upgbuilder.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGBUILDER_H
+#define UPGBUILDER_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+#define UPG_TYPE_URI_BUILDER upg_uri_builder_get_type()
+G_DECLARE_FINAL_TYPE(UpgUriBuilder, upg_uri_builder, UPG, URI_BUILDER, GObject)
+
+UpgUriBuilder* upg_uri_builder_new(void);
+void upg_uri_builder_reset(UpgUriBuilder* self);
+void upg_uri_builder_set_scheme(UpgUriBuilder* self, const gchar* scheme);
+void upg_uri_builder_set_userinfo(UpgUriBuilder* self, const gchar* userinfo);
+void upg_uri_builder_set_host(UpgUriBuilder* self, const gchar* host);
+void upg_uri_builder_set_port(UpgUriBuilder* self, guint16 port);
+void upg_uri_builder_append_segment(UpgUriBuilder* self, const gchar* segment);
+void upg_uri_builder_add_query_param(UpgUriBuilder* self, const gchar* key, const gchar* value);
+void upg_uri_builder_set_fragment(UpgUriBuilder* self, const gchar* fragment);
+gchar* upg_uri_builder_to_string(UpgUriBuilder* self);
+UpgUri* upg_uri_builder_to_uri(UpgUriBuilder* self);
+
+G_END_DECLS
+
+#endif
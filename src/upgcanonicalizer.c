@@ -0,0 +1,434 @@
+/* upgcanonicalizer.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgcanonicalizer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define UPG_CANONICALIZER_STACK_PARAMS 32
+
+/**
+ * SECTION:upgcanonicalizer
+ * @short_description: Writing canonical keys for URIs
+ * @include: liburiparser-gobject.h
+ * @title: UpgCanonicalizer
+ *
+ * #UpgCanonicalizer writes a URI in a canonical form, so that URIs that mean
+ * the same thing are written the same way; that's what you want for cache
+ * keys, for example. What's done to the URI is chosen once, with
+ * #UpgCanonicalizerStages, when the canonicalizer is made, and
+ * %UPG_CANONICALIZE_CACHE_KEY is the usual choice.
+ *
+ * The key is written in a single pass straight from the parsed parts of the
+ * URI into a buffer that you give it, with upg_canonicalizer_write(); the URI
+ * isn't changed, and nothing is allocated unless there are more than a few
+ * dozen query parameters to sort. A canonicalizer can't be changed after
+ * it's made, so one can be shared between threads.
+ *
+ * Sorting the query compares the `&`-separated parameters byte by byte,
+ * except that the case of percent-escapes is ignored.
+ */
+struct _UpgCanonicalizer {
+    GObject parent_instance;
+
+    UpgCanonicalizerStages stages;
+};
+
+G_DEFINE_TYPE(UpgCanonicalizer, upg_canonicalizer, G_TYPE_OBJECT)
+
+typedef struct {
+    gchar* buf;
+    gsize cap;
+    gsize len;
+} UpgCanonicalizerOut;
+
+/**
+ * upg_canonicalizer_stages_get_type:
+ *
+ * Returns the #GType corresponding to #UpgCanonicalizerStages, setting it up
+ * if necessary.
+ *
+ * Returns: the #GType
+ */
+GType upg_canonicalizer_stages_get_type(void)
+{
+    static volatile gsize gtype_id = 0;
+    static const GFlagsValue values[] = {
+        { UPG_CANONICALIZE_NONE, "UPG_CANONICALIZE_NONE", "none" },
+        { UPG_CANONICALIZE_LOWERCASE_SCHEME, "UPG_CANONICALIZE_LOWERCASE_SCHEME", "lowercase-scheme" },
+        { UPG_CANONICALIZE_LOWERCASE_HOST, "UPG_CANONICALIZE_LOWERCASE_HOST", "lowercase-host" },
+        { UPG_CANONICALIZE_STRIP_DEFAULT_PORT, "UPG_CANONICALIZE_STRIP_DEFAULT_PORT", "strip-default-port" },
+        { UPG_CANONICALIZE_SORT_QUERY, "UPG_CANONICALIZE_SORT_QUERY", "sort-query" },
+        { UPG_CANONICALIZE_STRIP_FRAGMENT, "UPG_CANONICALIZE_STRIP_FRAGMENT", "strip-fragment" },
+        { UPG_CANONICALIZE_UPPERCASE_ESCAPES, "UPG_CANONICALIZE_UPPERCASE_ESCAPES", "uppercase-escapes" },
+        { UPG_CANONICALIZE_STRIP_USERINFO, "UPG_CANONICALIZE_STRIP_USERINFO", "strip-userinfo" },
+        { UPG_CANONICALIZE_CACHE_KEY, "UPG_CANONICALIZE_CACHE_KEY", "cache-key" },
+        { 0, NULL, NULL }
+    };
+
+    if (g_once_init_enter(&gtype_id)) {
+        GType new_type = g_flags_register_static(g_intern_static_string("UpgCanonicalizerStages"), values);
+        g_once_init_leave(&gtype_id, new_type);
+    }
+
+    return (GType)gtype_id;
+}
+
+static void upg_canonicalizer_class_init(UpgCanonicalizerClass* klass)
+{
+}
+
+static void upg_canonicalizer_init(UpgCanonicalizer* self)
+{
+}
+
+/**
+ * upg_canonicalizer_new:
+ * @stages: What to do to URIs.
+ *
+ * Creates a new #UpgCanonicalizer that does @stages to the URIs it writes.
+ *
+ * Returns: (transfer full): a new #UpgCanonicalizer.
+ */
+UpgCanonicalizer* upg_canonicalizer_new(UpgCanonicalizerStages stages)
+{
+    UpgCanonicalizer* self = g_object_new(UPG_TYPE_CANONICALIZER, NULL);
+    self->stages = stages;
+    return self;
+}
+
+/**
+ * upg_canonicalizer_get_stages:
+ * @self: The canonicalizer.
+ *
+ * Gets what @self does to the URIs it writes.
+ *
+ * Returns: The stages @self was made with.
+ */
+UpgCanonicalizerStages upg_canonicalizer_get_stages(UpgCanonicalizer* self)
+{
+    g_return_val_if_fail(UPG_IS_CANONICALIZER(self), UPG_CANONICALIZE_NONE);
+
+    return self->stages;
+}
+
+// past the end of the buffer, only the length is kept, so the caller finds
+// out how much room it needs
+static inline void upg_canonicalizer_put_c(UpgCanonicalizerOut* out, gchar c)
+{
+    if (out->len < out->cap) {
+        out->buf[out->len] = c;
+    }
+    out->len++;
+}
+
+static void upg_canonicalizer_put_len(UpgCanonicalizerOut* out, const gchar* data, gsize len)
+{
+    if (len > 0 && out->len < out->cap) {
+        memcpy(out->buf + out->len, data, MIN(len, out->cap - out->len));
+    }
+    out->len += len;
+}
+
+static void upg_canonicalizer_put_range(UpgCanonicalizerOut* out, const gchar* first, const gchar* after_last, gboolean lower, gboolean escapes)
+{
+    if (!lower && !escapes) {
+        upg_canonicalizer_put_len(out, first, after_last - first);
+        return;
+    }
+
+    guint in_escape = 0;
+    for (const gchar* c = first; c < after_last; c++) {
+        gchar ch = *c;
+        if (in_escape > 0) {
+            in_escape--;
+            if (escapes) {
+                ch = g_ascii_toupper(ch);
+            }
+        } else if (ch == '%') {
+            in_escape = 2;
+        } else if (lower) {
+            ch = g_ascii_tolower(ch);
+        }
+        upg_canonicalizer_put_c(out, ch);
+    }
+}
+
+static void upg_canonicalizer_put_host(UpgCanonicalizerOut* out, const UriUriA* uri, UpgCanonicalizerStages stages)
+{
+    static const gchar hex[] = "0123456789abcdef";
+
+    // these are written the same way uriToStringA() writes them
+    if (uri->hostData.ip4 != NULL) {
+        for (guint i = 0; i < 4; i++) {
+            gchar digits[4];
+            gint n = g_snprintf(digits, sizeof(digits), "%u", uri->hostData.ip4->data[i]);
+            if (i > 0) {
+                upg_canonicalizer_put_c(out, '.');
+            }
+            upg_canonicalizer_put_len(out, digits, n);
+        }
+        return;
+    }
+
+    if (uri->hostData.ip6 != NULL) {
+        upg_canonicalizer_put_c(out, '[');
+        for (guint i = 0; i < 16; i++) {
+            upg_canonicalizer_put_c(out, hex[uri->hostData.ip6->data[i] >> 4]);
+            upg_canonicalizer_put_c(out, hex[uri->hostData.ip6->data[i] & 0xf]);
+            if (i % 2 == 1 && i < 15) {
+                upg_canonicalizer_put_c(out, ':');
+            }
+        }
+        upg_canonicalizer_put_c(out, ']');
+        return;
+    }
+
+    gboolean lower = (stages & UPG_CANONICALIZE_LOWERCASE_HOST) != 0;
+    gboolean escapes = (stages & UPG_CANONICALIZE_UPPERCASE_ESCAPES) != 0;
+
+    if (uri->hostData.ipFuture.first != NULL) {
+        upg_canonicalizer_put_c(out, '[');
+        upg_canonicalizer_put_range(out, uri->hostData.ipFuture.first, uri->hostData.ipFuture.afterLast, lower, escapes);
+        upg_canonicalizer_put_c(out, ']');
+        return;
+    }
+
+    upg_canonicalizer_put_range(out, uri->hostText.first, uri->hostText.afterLast, lower, escapes);
+}
+
+static int upg_canonicalizer_param_compare(const void* _a, const void* _b)
+{
+    const UpgSlice* a = _a;
+    const UpgSlice* b = _b;
+
+    // the parameters are the same up to the first difference, so they have
+    // escapes in the same places up to there too
+    guint in_escape = 0;
+    gint raw = 0;
+    for (gsize i = 0; i < MIN(a->len, b->len); i++) {
+        guchar ca = a->data[i];
+        guchar cb = b->data[i];
+        if (raw == 0 && ca != cb) {
+            raw = ca < cb ? -1 : 1;
+        }
+
+        if (in_escape > 0) {
+            in_escape--;
+            ca = g_ascii_toupper(ca);
+            cb = g_ascii_toupper(cb);
+        } else if (ca == '%') {
+            in_escape = 2;
+        }
+
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
+    }
+
+    if (a->len != b->len) {
+        return a->len < b->len ? -1 : 1;
+    }
+    return raw;
+}
+
+static void upg_canonicalizer_put_query(UpgCanonicalizerOut* out, const UriUriA* uri, UpgCanonicalizerStages stages)
+{
+    const gchar* first = uri->query.first;
+    const gchar* after_last = uri->query.afterLast;
+    gboolean escapes = (stages & UPG_CANONICALIZE_UPPERCASE_ESCAPES) != 0;
+
+    gsize n_params = 1;
+    if (stages & UPG_CANONICALIZE_SORT_QUERY) {
+        for (const gchar* c = first; c < after_last; c++) {
+            n_params += *c == '&';
+        }
+    }
+
+    if (n_params == 1) {
+        upg_canonicalizer_put_range(out, first, after_last, FALSE, escapes);
+        return;
+    }
+
+    UpgSlice stack[UPG_CANONICALIZER_STACK_PARAMS];
+    UpgSlice* params = n_params <= G_N_ELEMENTS(stack) ? stack : g_new(UpgSlice, n_params);
+
+    const gchar* param = first;
+    for (gsize i = 0; i < n_params; i++) {
+        const gchar* end = memchr(param, '&', after_last - param);
+        if (end == NULL) {
+            end = after_last;
+        }
+
+        params[i] = (UpgSlice) { param, end - param };
+        param = end + 1;
+    }
+
+    qsort(params, n_params, sizeof(UpgSlice), upg_canonicalizer_param_compare);
+
+    for (gsize i = 0; i < n_params; i++) {
+        if (i > 0) {
+            upg_canonicalizer_put_c(out, '&');
+        }
+        upg_canonicalizer_put_range(out, params[i].data, params[i].data + params[i].len, FALSE, escapes);
+    }
+
+    if (params != stack) {
+        g_free(params);
+    }
+}
+
+static gsize upg_canonicalizer_put(UpgCanonicalizer* self, UpgUri* _uri, gchar* buf, gsize cap)
+{
+    const UriUriA* uri = upg_uri_get_internal(_uri);
+    UpgCanonicalizerStages stages = self->stages;
+    gboolean escapes = (stages & UPG_CANONICALIZE_UPPERCASE_ESCAPES) != 0;
+    UpgCanonicalizerOut out = { buf, cap, 0 };
+
+    if (uri->scheme.first != NULL) {
+        upg_canonicalizer_put_range(&out, uri->scheme.first, uri->scheme.afterLast, (stages & UPG_CANONICALIZE_LOWERCASE_SCHEME) != 0, FALSE);
+        upg_canonicalizer_put_c(&out, ':');
+    }
+
+    gboolean has_host = uri->hostText.first != NULL || uri->hostData.ip4 != NULL || uri->hostData.ip6 != NULL
+        || uri->hostData.ipFuture.first != NULL;
+    if (has_host) {
+        upg_canonicalizer_put_len(&out, "//", 2);
+
+        if (uri->userInfo.first != NULL && !(stages & UPG_CANONICALIZE_STRIP_USERINFO)) {
+            upg_canonicalizer_put_range(&out, uri->userInfo.first, uri->userInfo.afterLast, FALSE, escapes);
+            upg_canonicalizer_put_c(&out, '@');
+        }
+
+        upg_canonicalizer_put_host(&out, uri, stages);
+
+        if (uri->portText.first != NULL
+            && !((stages & UPG_CANONICALIZE_STRIP_DEFAULT_PORT) && upg_uri_has_default_port(_uri))) {
+            upg_canonicalizer_put_c(&out, ':');
+            upg_canonicalizer_put_len(&out, uri->portText.first, uri->portText.afterLast - uri->portText.first);
+        }
+    }
+
+    if (uri->absolutePath || (uri->pathHead != NULL && has_host)) {
+        upg_canonicalizer_put_c(&out, '/');
+    }
+    for (const UriPathSegmentA* segment = uri->pathHead; segment != NULL; segment = segment == uri->pathTail ? NULL : segment->next) {
+        upg_canonicalizer_put_range(&out, segment->text.first, segment->text.afterLast, FALSE, escapes);
+        if (segment != uri->pathTail) {
+            upg_canonicalizer_put_c(&out, '/');
+        }
+    }
+
+    if (uri->query.first != NULL) {
+        upg_canonicalizer_put_c(&out, '?');
+        upg_canonicalizer_put_query(&out, uri, stages);
+    }
+
+    if (uri->fragment.first != NULL && !(stages & UPG_CANONICALIZE_STRIP_FRAGMENT)) {
+        upg_canonicalizer_put_c(&out, '#');
+        upg_canonicalizer_put_range(&out, uri->fragment.first, uri->fragment.afterLast, FALSE, escapes);
+    }
+
+    if (out.len < out.cap) {
+        out.buf[out.len] = '\0';
+    }
+    return out.len;
+}
+
+/**
+ * upg_canonicalizer_write:
+ * @self: The canonicalizer to use.
+ * @uri: (transfer none) (not nullable): The URI to write.
+ * @buf: (array length=cap) (element-type gchar): Where to write the key.
+ * @cap: The size of @buf, including room for the nul.
+ * @written: (out) (optional): Where to put the length of the key.
+ *
+ * Writes the canonical form of @uri into @buf as a nul-terminated string,
+ * without allocating. This works just like upg_uri_to_string_buf(): if the key
+ * fits, returns %TRUE and puts its length (without the nul) in @written, and
+ * if it doesn't, returns %FALSE and puts the length that's needed in
+ * @written instead.
+ *
+ * Returns: Whether the key fit into @buf.
+ */
+gboolean upg_canonicalizer_write(UpgCanonicalizer* self, UpgUri* uri, gchar* buf, gsize cap, gsize* written)
+{
+    g_return_val_if_fail(UPG_IS_CANONICALIZER(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+    g_return_val_if_fail(buf != NULL || cap == 0, FALSE);
+
+    gsize len = upg_canonicalizer_put(self, uri, buf, cap);
+    if (written != NULL) {
+        *written = len;
+    }
+    return len < cap;
+}
+
+/**
+ * upg_canonicalizer_append:
+ * @self: The canonicalizer to use.
+ * @uri: (transfer none) (not nullable): The URI to write.
+ * @out: (not nullable): The string to append the key to.
+ *
+ * Appends the canonical form of @uri to @out. This only allocates if @out has
+ * to grow.
+ */
+void upg_canonicalizer_append(UpgCanonicalizer* self, UpgUri* uri, GString* out)
+{
+    g_return_if_fail(UPG_IS_CANONICALIZER(self));
+    g_return_if_fail(UPG_IS_URI(uri));
+    g_return_if_fail(out != NULL);
+
+    gsize offset = out->len;
+    gsize len = upg_canonicalizer_put(self, uri, out->str + offset, out->allocated_len - offset);
+
+    if (offset + len >= out->allocated_len) {
+        // g_string_set_size() leaves room for the nul, which is written too
+        g_string_set_size(out, offset + len);
+        upg_canonicalizer_put(self, uri, out->str + offset, len + 1);
+    }
+    out->len = offset + len;
+}
+
+/**
+ * upg_canonicalizer_canonicalize:
+ * @self: The canonicalizer to use.
+ * @uri: (transfer none) (not nullable): The URI to write.
+ *
+ * Makes the canonical form of @uri as a new string. If you're doing this for
+ * lots of URIs, upg_canonicalizer_write() or upg_canonicalizer_append() avoid
+ * allocating each time.
+ *
+ * Returns: (transfer full): The canonical form of @uri.
+ */
+gchar* upg_canonicalizer_canonicalize(UpgCanonicalizer* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_CANONICALIZER(self), NULL);
+    g_return_val_if_fail(UPG_IS_URI(uri), NULL);
+
+    gchar buf[512];
+    gsize len = upg_canonicalizer_put(self, uri, buf, sizeof(buf));
+    if (len < sizeof(buf)) {
+        return g_strndup(buf, len);
+    }
+
+    gchar* out = g_malloc(len + 1);
+    upg_canonicalizer_put(self, uri, out, len + 1);
+    return out;
+}
@@ -0,0 +1,81 @@
+/* upgcanonicalizer.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGCANONICALIZER_H
+#define UPGCANONICALIZER_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+/**
+ * UpgCanonicalizerStages:
+ * @UPG_CANONICALIZE_NONE: Write the URI as it is.
+ * @UPG_CANONICALIZE_LOWERCASE_SCHEME: Lowercase the scheme.
+ * @UPG_CANONICALIZE_LOWERCASE_HOST: Lowercase the host, apart from any
+ *                                   percent-escapes in it.
+ * @UPG_CANONICALIZE_STRIP_DEFAULT_PORT: Leave out the port if it's the default
+ *                                       for the scheme, from
+ *                                       upg_scheme_get_default_port(), or if
+ *                                       it's empty.
+ * @UPG_CANONICALIZE_SORT_QUERY: Sort the query parameters, so that the order
+ *                               they were given in doesn't matter.
+ * @UPG_CANONICALIZE_STRIP_FRAGMENT: Leave out the fragment.
+ * @UPG_CANONICALIZE_UPPERCASE_ESCAPES: Uppercase the hex digits of
+ *                                      percent-escapes, so `%2f` becomes `%2F`.
+ * @UPG_CANONICALIZE_STRIP_USERINFO: Leave out the userinfo.
+ * @UPG_CANONICALIZE_CACHE_KEY: Everything that's usual for a cache key: all of
+ *                              the above but %UPG_CANONICALIZE_STRIP_USERINFO.
+ *
+ * What a #UpgCanonicalizer does to a URI when writing it.
+ */
+typedef enum {
+    UPG_CANONICALIZE_NONE = 0,
+    UPG_CANONICALIZE_LOWERCASE_SCHEME = 1,
+    UPG_CANONICALIZE_LOWERCASE_HOST = 2,
+    UPG_CANONICALIZE_STRIP_DEFAULT_PORT = 4,
+    UPG_CANONICALIZE_SORT_QUERY = 8,
+    UPG_CANONICALIZE_STRIP_FRAGMENT = 16,
+    UPG_CANONICALIZE_UPPERCASE_ESCAPES = 32,
+    UPG_CANONICALIZE_STRIP_USERINFO = 64,
+    UPG_CANONICALIZE_CACHE_KEY = 63,
+} UpgCanonicalizerStages;
+
+GType upg_canonicalizer_stages_get_type(void);
+#define UPG_TYPE_CANONICALIZER_STAGES upg_canonicalizer_stages_get_type()
+
+#define UPG_TYPE_CANONICALIZER upg_canonicalizer_get_type()
+G_DECLARE_FINAL_TYPE(UpgCanonicalizer, upg_canonicalizer, UPG, CANONICALIZER, GObject)
+
+UpgCanonicalizer* upg_canonicalizer_new(UpgCanonicalizerStages stages);
+UpgCanonicalizerStages upg_canonicalizer_get_stages(UpgCanonicalizer* self);
+gboolean upg_canonicalizer_write(UpgCanonicalizer* self, UpgUri* uri, gchar* buf, gsize cap, gsize* written);
+void upg_canonicalizer_append(UpgCanonicalizer* self, UpgUri* uri, GString* out);
+gchar* upg_canonicalizer_canonicalize(UpgCanonicalizer* self, UpgUri* uri);
+
+G_END_DECLS
+
+#endif
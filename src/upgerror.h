@@ -40,6 +40,8 @@
  * @UPG_ERR_PARSE: An error occurred while parsing a URI or reference.
  * @UPG_ERR_NORMALIZE: An error occurred during normalization.
  * @UPG_ERR_REFERENCE: An error occurred applying or subtracting a reference.
+ * @UPG_ERR_LIMIT: The input went over one of the #UpgLimits it was parsed
+ *                 with.
  *
  * The types of errors that can occur in UPG.
  */
@@ -47,6 +49,7 @@ typedef enum {
     UPG_ERR_PARSE,
     UPG_ERR_NORMALIZE,
     UPG_ERR_REFERENCE,
+    UPG_ERR_LIMIT,
 } UpgError;
 
 /**
@@ -0,0 +1,195 @@
+/* upgidna.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upguri.h"
+#include <string.h>
+
+/*
+ * Converting a host to or from its ASCII form means running IDNA over it,
+ * which isn't cheap, and the same hosts come up over and over again. So the
+ * results are kept in an LRU cache, split into shards that each have their
+ * own lock, so that threads converting different hosts rarely wait for each
+ * other. Each shard holds a bounded number of hosts, so the cache can't grow
+ * forever however many different hosts there are.
+ *
+ * Only hosts that fit in a DNS name are cached, so that the key can be put
+ * together on the stack.
+ */
+
+#define UPG_IDNA_SHARDS 16
+#define UPG_IDNA_SHARD_CAPACITY 256
+#define UPG_IDNA_MAX_HOST 255
+
+typedef struct {
+    GList link;
+    gchar* key;
+    gchar* value;
+} UpgIdnaEntry;
+
+typedef struct {
+    GMutex lock;
+    GHashTable* entries;
+    GQueue lru;
+} UpgIdnaShard;
+
+static UpgIdnaShard upg_idna_shards[UPG_IDNA_SHARDS];
+
+static void upg_idna_entry_free(gpointer data)
+{
+    UpgIdnaEntry* entry = data;
+    g_free(entry->key);
+    g_free(entry->value);
+    g_free(entry);
+}
+
+static void upg_idna_shards_init(void)
+{
+    static gsize initialized = 0;
+
+    if (g_once_init_enter(&initialized)) {
+        for (guint i = 0; i < UPG_IDNA_SHARDS; i++) {
+            g_mutex_init(&upg_idna_shards[i].lock);
+            // the key belongs to the entry, which is freed with it
+            upg_idna_shards[i].entries = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, upg_idna_entry_free);
+            g_queue_init(&upg_idna_shards[i].lru);
+        }
+        g_once_init_leave(&initialized, 1);
+    }
+}
+
+/*
+ * upg_idna_convert:
+ * @to_ascii: Which way to convert.
+ * @host: The host, which may be percent-encoded.
+ * @len: The length of @host.
+ *
+ * Does the conversion, without the cache.
+ *
+ * Returns: (transfer full) (nullable): The converted host, or %NULL if it
+ * isn't a valid host.
+ */
+static gchar* upg_idna_convert(gboolean to_ascii, const gchar* host, gsize len)
+{
+    gchar* decoded = g_malloc(len + 1);
+    gsize decoded_len = 0;
+    for (gsize i = 0; i < len; i++) {
+        if (host[i] == '%' && i + 2 < len && g_ascii_isxdigit(host[i + 1]) && g_ascii_isxdigit(host[i + 2])) {
+            decoded[decoded_len++] = (gchar)(g_ascii_xdigit_value(host[i + 1]) << 4 | g_ascii_xdigit_value(host[i + 2]));
+            i += 2;
+        } else {
+            decoded[decoded_len++] = host[i];
+        }
+    }
+    decoded[decoded_len] = '\0';
+
+    gchar* ret = NULL;
+    if (memchr(decoded, '\0', decoded_len) == NULL && g_utf8_validate(decoded, decoded_len, NULL)) {
+        ret = to_ascii ? g_hostname_to_ascii(decoded) : g_hostname_to_unicode(decoded);
+    }
+
+    g_free(decoded);
+    return ret;
+}
+
+static gchar* upg_idna_lookup(gboolean to_ascii, const gchar* host, gsize len)
+{
+    if (len > UPG_IDNA_MAX_HOST) {
+        return upg_idna_convert(to_ascii, host, len);
+    }
+
+    upg_idna_shards_init();
+
+    // the first byte says which way the conversion goes
+    gchar key[UPG_IDNA_MAX_HOST + 2];
+    key[0] = to_ascii ? 'a' : 'u';
+    memcpy(key + 1, host, len);
+    key[len + 1] = '\0';
+
+    UpgIdnaShard* shard = &upg_idna_shards[g_str_hash(key) % UPG_IDNA_SHARDS];
+
+    g_mutex_lock(&shard->lock);
+    UpgIdnaEntry* entry = g_hash_table_lookup(shard->entries, key);
+    if (entry != NULL) {
+        g_queue_unlink(&shard->lru, &entry->link);
+        g_queue_push_head_link(&shard->lru, &entry->link);
+        gchar* ret = g_strdup(entry->value);
+        g_mutex_unlock(&shard->lock);
+        return ret;
+    }
+    g_mutex_unlock(&shard->lock);
+
+    // converting can take a while, so other threads can carry on meanwhile
+    gchar* value = upg_idna_convert(to_ascii, host, len);
+
+    g_mutex_lock(&shard->lock);
+    if (!g_hash_table_contains(shard->entries, key)) {
+        entry = g_new0(UpgIdnaEntry, 1);
+        entry->key = g_strdup(key);
+        entry->value = g_strdup(value);
+        entry->link.data = entry;
+        g_hash_table_insert(shard->entries, entry->key, entry);
+        g_queue_push_head_link(&shard->lru, &entry->link);
+
+        if (shard->lru.length > UPG_IDNA_SHARD_CAPACITY) {
+            GList* oldest = g_queue_pop_tail_link(&shard->lru);
+            g_hash_table_remove(shard->entries, ((UpgIdnaEntry*)oldest->data)->key);
+        }
+    }
+    g_mutex_unlock(&shard->lock);
+
+    return value;
+}
+
+/*
+ * __upg_idna_to_ascii__:
+ * @host: (array length=len): The host to convert, which may have
+ *        percent-encoded UTF-8 in it.
+ * @len: The length of @host.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Converts @host to its ASCII form, with `xn--` labels for anything that
+ * isn't ASCII, going through the cache.
+ *
+ * Returns: (transfer full) (nullable): The ASCII form of @host, or %NULL if it
+ * isn't a valid host.
+ */
+gchar* __upg_idna_to_ascii__(const gchar* host, gsize len)
+{
+    return upg_idna_lookup(TRUE, host, len);
+}
+
+/*
+ * __upg_idna_to_unicode__:
+ * @host: (array length=len): The host to convert, which may have
+ *        percent-encoded UTF-8 in it.
+ * @len: The length of @host.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Converts @host to its Unicode form, decoding `xn--` labels, going through
+ * the cache.
+ *
+ * Returns: (transfer full) (nullable): The UTF-8 form of @host, or %NULL if it
+ * isn't a valid host.
+ */
+gchar* __upg_idna_to_unicode__(const gchar* host, gsize len)
+{
+    return upg_idna_lookup(FALSE, host, len);
+}
@@ -0,0 +1,486 @@
+/* upgparams.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgparams.h"
+#include <string.h>
+
+/**
+ * SECTION:upgparams
+ * @short_description: Reading query and fragment parameters in place
+ * @include: liburiparser-gobject.h
+ * @title: Parameters
+ *
+ * upg_uri_get_query() gives every query parameter at once, as a #GHashTable,
+ * which is a lot of work when only one or two of them are needed. The
+ * functions here look through the query or fragment of a #UpgUri where it
+ * is, and give back #UpgSlice<!-- -->s that point into the URI, so nothing
+ * is allocated.
+ *
+ * Parameters are separated by `&`, and a key is separated from its value by
+ * the first `=`. A parameter without an `=` has no value, which is given as
+ * a slice with %NULL data; an empty parameter, like between the two `&` in
+ * `a&&b`, is skipped. Keys and values are given exactly as they are in the
+ * URI, so they may be percent-encoded; use upg_slice_unescape() to decode
+ * them.
+ *
+ * The slices are only valid until the URI is changed.
+ */
+
+static void upg_param_iter_init_range(UpgParamIter* iter, const UriTextRangeA* range)
+{
+    iter->current = range->first;
+    iter->end = range->first != NULL ? range->afterLast : NULL;
+}
+
+/**
+ * upg_param_iter_init_query:
+ * @iter: (out caller-allocates): The iterator to set up.
+ * @uri: (transfer none) (not nullable): The URI to read.
+ *
+ * Sets up @iter to go through the query parameters of @uri, in order.
+ */
+void upg_param_iter_init_query(UpgParamIter* iter, UpgUri* uri)
+{
+    g_return_if_fail(iter != NULL);
+    g_return_if_fail(UPG_IS_URI(uri));
+
+    upg_param_iter_init_range(iter, &upg_uri_get_internal(uri)->query);
+}
+
+/**
+ * upg_param_iter_init_fragment:
+ * @iter: (out caller-allocates): The iterator to set up.
+ * @uri: (transfer none) (not nullable): The URI to read.
+ *
+ * Sets up @iter to go through the fragment parameters of @uri, in order.
+ */
+void upg_param_iter_init_fragment(UpgParamIter* iter, UpgUri* uri)
+{
+    g_return_if_fail(iter != NULL);
+    g_return_if_fail(UPG_IS_URI(uri));
+
+    upg_param_iter_init_range(iter, &upg_uri_get_internal(uri)->fragment);
+}
+
+/**
+ * upg_param_iter_next:
+ * @iter: The iterator.
+ * @key: (out) (optional): Where to put the key of the next parameter.
+ * @value: (out) (optional): Where to put the value of the next parameter.
+ *
+ * Moves @iter on to the next parameter.
+ *
+ * Returns: %FALSE if there are no more parameters.
+ */
+gboolean upg_param_iter_next(UpgParamIter* iter, UpgSlice* key, UpgSlice* value)
+{
+    g_return_val_if_fail(iter != NULL, FALSE);
+
+    while (iter->current != NULL && iter->current < iter->end && *iter->current == '&')
+        iter->current++;
+
+    if (iter->current == NULL || iter->current >= iter->end)
+        return FALSE;
+
+    const gchar* first = iter->current;
+    const gchar* after_last = memchr(first, '&', iter->end - first);
+    if (after_last == NULL)
+        after_last = iter->end;
+    iter->current = after_last;
+
+    const gchar* equals = memchr(first, '=', after_last - first);
+    if (key != NULL)
+        *key = (UpgSlice) { first, (equals != NULL ? equals : after_last) - first };
+    if (value != NULL)
+        *value = equals != NULL ? (UpgSlice) { equals + 1, after_last - equals - 1 } : (UpgSlice) { NULL, 0 };
+
+    return TRUE;
+}
+
+static gboolean upg_param_find(UpgParamIter* iter, const gchar* key, UpgSlice* value)
+{
+    gsize key_len = strlen(key);
+    UpgSlice current_key;
+    UpgSlice current_value;
+
+    while (upg_param_iter_next(iter, &current_key, &current_value)) {
+        if (current_key.len == key_len && memcmp(current_key.data, key, key_len) == 0) {
+            if (value != NULL)
+                *value = current_value;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * upg_uri_get_query_param:
+ * @self: The URI to read.
+ * @key: (not nullable): The key to look for, as it's written in the URI.
+ * @value: (out) (optional): Where to put the value.
+ *
+ * Finds the first query parameter of @self called @key.
+ *
+ * Returns: Whether there is a parameter called @key.
+ */
+gboolean upg_uri_get_query_param(UpgUri* self, const gchar* key, UpgSlice* value)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), FALSE);
+    g_return_val_if_fail(key != NULL, FALSE);
+
+    UpgParamIter iter;
+    upg_param_iter_init_query(&iter, self);
+    return upg_param_find(&iter, key, value);
+}
+
+/**
+ * upg_uri_get_fragment_param:
+ * @self: The URI to read.
+ * @key: (not nullable): The key to look for, as it's written in the URI.
+ * @value: (out) (optional): Where to put the value.
+ *
+ * Finds the first fragment parameter of @self called @key.
+ *
+ * Returns: Whether there is a parameter called @key.
+ */
+gboolean upg_uri_get_fragment_param(UpgUri* self, const gchar* key, UpgSlice* value)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), FALSE);
+    g_return_val_if_fail(key != NULL, FALSE);
+
+    UpgParamIter iter;
+    upg_param_iter_init_fragment(&iter, self);
+    return upg_param_find(&iter, key, value);
+}
+
+/**
+ * upg_uri_get_query_param_int64:
+ * @self: The URI to read.
+ * @key: (not nullable): The key to look for.
+ * @value: (out) (optional): Where to put the value.
+ *
+ * Finds the first query parameter of @self called @key, and reads its value
+ * like upg_slice_to_int64(). @value isn't touched if this fails.
+ *
+ * Returns: Whether there is a parameter called @key with a valid value.
+ */
+gboolean upg_uri_get_query_param_int64(UpgUri* self, const gchar* key, gint64* value)
+{
+    UpgSlice slice;
+    return upg_uri_get_query_param(self, key, &slice) && upg_slice_to_int64(&slice, value);
+}
+
+/**
+ * upg_uri_get_query_param_double:
+ * @self: The URI to read.
+ * @key: (not nullable): The key to look for.
+ * @value: (out) (optional): Where to put the value.
+ *
+ * Finds the first query parameter of @self called @key, and reads its value
+ * like upg_slice_to_double(). @value isn't touched if this fails.
+ *
+ * Returns: Whether there is a parameter called @key with a valid value.
+ */
+gboolean upg_uri_get_query_param_double(UpgUri* self, const gchar* key, gdouble* value)
+{
+    UpgSlice slice;
+    return upg_uri_get_query_param(self, key, &slice) && upg_slice_to_double(&slice, value);
+}
+
+/**
+ * upg_uri_get_query_param_boolean:
+ * @self: The URI to read.
+ * @key: (not nullable): The key to look for.
+ * @value: (out) (optional): Where to put the value.
+ *
+ * Finds the first query parameter of @self called @key, and reads its value
+ * like upg_slice_to_boolean(). @value isn't touched if this fails.
+ *
+ * Returns: Whether there is a parameter called @key with a valid value.
+ */
+gboolean upg_uri_get_query_param_boolean(UpgUri* self, const gchar* key, gboolean* value)
+{
+    UpgSlice slice;
+    return upg_uri_get_query_param(self, key, &slice) && upg_slice_to_boolean(&slice, value);
+}
+
+/**
+ * upg_slice_unescape:
+ * @slice: (not nullable): The text to decode.
+ * @plus_is_space: Whether to turn `+` into a space, like HTML forms do.
+ * @buf: (array length=cap) (nullable): Where to write the decoded text.
+ * @cap: The size of @buf, in bytes.
+ * @written: (out) (optional): Where to put the length of the decoded text.
+ *
+ * Decodes the percent-encoding in @slice into @buf, followed by a nul byte.
+ * A `%` that isn't followed by two hex digits is left as it is. The decoded
+ * text can have nul bytes in it, so use @written rather than strlen().
+ *
+ * If @buf isn't big enough, nothing useful is written, but @written is still
+ * set to the length that's needed, not counting the nul byte. The decoded text
+ * is never longer than @slice.
+ *
+ * Returns: Whether the text, and its nul byte, fit in @buf.
+ */
+gboolean upg_slice_unescape(const UpgSlice* slice, gboolean plus_is_space, gchar* buf, gsize cap, gsize* written)
+{
+    g_return_val_if_fail(slice != NULL, FALSE);
+    g_return_val_if_fail(buf != NULL || cap == 0, FALSE);
+
+    gsize len = 0;
+    for (gsize i = 0; i < slice->len; i++, len++) {
+        gchar c = slice->data[i];
+
+        if (c == '%' && i + 2 < slice->len && g_ascii_isxdigit(slice->data[i + 1]) && g_ascii_isxdigit(slice->data[i + 2])) {
+            c = (gchar)(g_ascii_xdigit_value(slice->data[i + 1]) << 4 | g_ascii_xdigit_value(slice->data[i + 2]));
+            i += 2;
+        } else if (c == '+' && plus_is_space) {
+            c = ' ';
+        }
+
+        if (len < cap)
+            buf[len] = c;
+    }
+
+    if (written != NULL)
+        *written = len;
+
+    if (len >= cap)
+        return FALSE;
+
+    buf[len] = '\0';
+    return TRUE;
+}
+
+/**
+ * upg_slice_to_int64:
+ * @slice: (not nullable): The text to read.
+ * @value: (out) (optional): Where to put the number.
+ *
+ * Reads @slice as a decimal integer, with an optional `+` or `-` in front.
+ * Nothing else is allowed, not even spaces, and it isn't percent-decoded
+ * first. @value isn't touched if this fails.
+ *
+ * Returns: Whether @slice was a valid number that fits in a #gint64.
+ */
+gboolean upg_slice_to_int64(const UpgSlice* slice, gint64* value)
+{
+    g_return_val_if_fail(slice != NULL, FALSE);
+
+    gsize i = 0;
+    gboolean negative = FALSE;
+    if (slice->len > 0 && (slice->data[0] == '-' || slice->data[0] == '+')) {
+        negative = slice->data[0] == '-';
+        i++;
+    }
+
+    if (i == slice->len)
+        return FALSE;
+
+    // negative numbers go one further than positive ones
+    guint64 limit = negative ? (guint64)G_MAXINT64 + 1 : (guint64)G_MAXINT64;
+    guint64 result = 0;
+    for (; i < slice->len; i++) {
+        if (!g_ascii_isdigit(slice->data[i]))
+            return FALSE;
+
+        guint digit = slice->data[i] - '0';
+        if (result > (limit - digit) / 10)
+            return FALSE;
+        result = result * 10 + digit;
+    }
+
+    if (value != NULL)
+        *value = negative ? (gint64)(0 - result) : (gint64)result;
+    return TRUE;
+}
+
+/**
+ * upg_slice_to_double:
+ * @slice: (not nullable): The text to read.
+ * @value: (out) (optional): Where to put the number.
+ *
+ * Reads @slice as a floating-point number, like g_ascii_strtod(), so the
+ * locale doesn't matter. Nothing else is allowed after the number, and it
+ * isn't percent-decoded first. @value isn't touched if this fails.
+ *
+ * Returns: Whether @slice was a valid number.
+ */
+gboolean upg_slice_to_double(const UpgSlice* slice, gdouble* value)
+{
+    g_return_val_if_fail(slice != NULL, FALSE);
+
+    // g_ascii_strtod() needs a nul at the end, which the slice doesn't have;
+    // no sensible number is this long, so a copy on the stack will do
+    gchar buf[64];
+    if (slice->len == 0 || slice->len >= sizeof(buf) || g_ascii_isspace(slice->data[0]))
+        return FALSE;
+
+    memcpy(buf, slice->data, slice->len);
+    buf[slice->len] = '\0';
+
+    gchar* end = NULL;
+    gdouble result = g_ascii_strtod(buf, &end);
+    if (end != buf + slice->len)
+        return FALSE;
+
+    if (value != NULL)
+        *value = result;
+    return TRUE;
+}
+
+static gboolean upg_slice_is(const UpgSlice* slice, const gchar* str)
+{
+    gsize len = strlen(str);
+    return slice->len == len && g_ascii_strncasecmp(slice->data, str, len) == 0;
+}
+
+/**
+ * upg_slice_to_boolean:
+ * @slice: (not nullable): The text to read.
+ * @value: (out) (optional): Where to put the result.
+ *
+ * Reads @slice as a boolean. `1`, `true`, `yes` and `on` are %TRUE, and `0`,
+ * `false`, `no` and `off` are %FALSE, ignoring case. A parameter that's just
+ * there, with no value or an empty one, like `?verbose`, is %TRUE too. @value
+ * isn't touched if this fails.
+ *
+ * Returns: Whether @slice was a valid boolean.
+ */
+gboolean upg_slice_to_boolean(const UpgSlice* slice, gboolean* value)
+{
+    g_return_val_if_fail(slice != NULL, FALSE);
+
+    gboolean result;
+    if (slice->len == 0 || upg_slice_is(slice, "1") || upg_slice_is(slice, "true") || upg_slice_is(slice, "yes") || upg_slice_is(slice, "on"))
+        result = TRUE;
+    else if (upg_slice_is(slice, "0") || upg_slice_is(slice, "false") || upg_slice_is(slice, "no") || upg_slice_is(slice, "off"))
+        result = FALSE;
+    else
+        return FALSE;
+
+    if (value != NULL)
+        *value = result;
+    return TRUE;
+}
+
+/*
+ * __upg_glob_match__:
+ * @pattern: (not nullable): The glob, where `*` matches any number of bytes
+ *           and `?` matches one.
+ * @text: (array length=len) (element-type guint8): The text to match.
+ * @len: The length of @text.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Matches @text against @pattern, without needing @text to be nul-terminated.
+ *
+ * Returns: Whether all of @text matches @pattern.
+ */
+gboolean __upg_glob_match__(const gchar* pattern, const gchar* text, gsize len)
+{
+    const gchar* star = NULL;
+    gsize star_at = 0;
+    gsize i = 0;
+
+    while (i < len) {
+        if (*pattern == '*') {
+            star = ++pattern;
+            star_at = i;
+        } else if (*pattern != '\0' && (*pattern == '?' || *pattern == text[i])) {
+            pattern++;
+            i++;
+        } else if (star != NULL) {
+            // let the last * take one more byte, and try again from there
+            pattern = star;
+            i = ++star_at;
+        } else {
+            return FALSE;
+        }
+    }
+
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
+
+/*
+ * __upg_slice_dup__:
+ * @data: (array length=len) (element-type guint8): The text to copy.
+ * @len: The length of @data.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Makes a slice that owns a nul-terminated copy of @data, in one allocation,
+ * so that it can be freed with g_free(). It's for keying hash tables with
+ * upg_slice_hash() and upg_slice_equal(), so that other slices can be looked
+ * up without copying them.
+ *
+ * Returns: (transfer full): The new slice.
+ */
+UpgSlice* __upg_slice_dup__(const gchar* data, gsize len)
+{
+    UpgSlice* slice = g_malloc(sizeof(UpgSlice) + len + 1);
+    gchar* text = (gchar*)(slice + 1);
+    memcpy(text, data, len);
+    text[len] = '\0';
+    slice->data = text;
+    slice->len = len;
+    return slice;
+}
+
+/*
+ * __upg_slice_hash__:
+ * @ptr: (not nullable): The #UpgSlice to hash.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * A #GHashFunc for #UpgSlice keys.
+ *
+ * Returns: The hash of the text in @ptr.
+ */
+guint __upg_slice_hash__(gconstpointer ptr)
+{
+    const UpgSlice* slice = ptr;
+    guint hash = 5381;
+    for (gsize i = 0; i < slice->len; i++) {
+        hash = hash * 33 + (guchar)slice->data[i];
+    }
+    return hash;
+}
+
+/*
+ * __upg_slice_equal__:
+ * @a: (not nullable): An #UpgSlice.
+ * @b: (not nullable): Another #UpgSlice.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * A #GEqualFunc for #UpgSlice keys.
+ *
+ * Returns: Whether @a and @b have the same text.
+ */
+gboolean __upg_slice_equal__(gconstpointer _a, gconstpointer _b)
+{
+    const UpgSlice* a = _a;
+    const UpgSlice* b = _b;
+    return a->len == b->len && memcmp(a->data, b->data, a->len) == 0;
+}
@@ -0,0 +1,75 @@
+/* upgparams.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGPARAMS_H
+#define UPGPARAMS_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+/**
+ * UpgParamIter:
+ *
+ * An iterator over the query or fragment parameters of a #UpgUri. Its fields
+ * are private; set it up with upg_param_iter_init_query() or
+ * upg_param_iter_init_fragment().
+ */
+typedef struct {
+    /*< private >*/
+    const gchar* current;
+    const gchar* end;
+} UpgParamIter;
+
+void upg_param_iter_init_query(UpgParamIter* iter, UpgUri* uri);
+void upg_param_iter_init_fragment(UpgParamIter* iter, UpgUri* uri);
+gboolean upg_param_iter_next(UpgParamIter* iter, UpgSlice* key, UpgSlice* value);
+
+gboolean upg_uri_get_query_param(UpgUri* self, const gchar* key, UpgSlice* value);
+gboolean upg_uri_get_fragment_param(UpgUri* self, const gchar* key, UpgSlice* value);
+gboolean upg_uri_get_query_param_int64(UpgUri* self, const gchar* key, gint64* value);
+gboolean upg_uri_get_query_param_double(UpgUri* self, const gchar* key, gdouble* value);
+gboolean upg_uri_get_query_param_boolean(UpgUri* self, const gchar* key, gboolean* value);
+
+gboolean upg_slice_unescape(const UpgSlice* slice, gboolean plus_is_space, gchar* buf, gsize cap, gsize* written);
+gboolean upg_slice_to_int64(const UpgSlice* slice, gint64* value);
+gboolean upg_slice_to_double(const UpgSlice* slice, gdouble* value);
+gboolean upg_slice_to_boolean(const UpgSlice* slice, gboolean* value);
+
+#ifdef LIBURIPARSER_GOBJECT_COMPILATION
+#define upg_glob_match(pattern, text, len) __upg_glob_match__(pattern, text, len)
+gboolean __upg_glob_match__(const gchar* pattern, const gchar* text, gsize len);
+#define upg_slice_dup(data, len) __upg_slice_dup__(data, len)
+UpgSlice* __upg_slice_dup__(const gchar* data, gsize len);
+#define upg_slice_hash __upg_slice_hash__
+guint __upg_slice_hash__(gconstpointer ptr);
+#define upg_slice_equal __upg_slice_equal__
+gboolean __upg_slice_equal__(gconstpointer a, gconstpointer b);
+#endif
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,356 @@
+/* upgparser.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgparser.h"
+#include "upgerror.h"
+#include <string.h>
+
+#define UPG_ARENA_ALIGN (2 * sizeof(gpointer))
+#define UPG_ARENA_ROUND(n) (((n) + UPG_ARENA_ALIGN - 1) & ~(UPG_ARENA_ALIGN - 1))
+#define UPG_ARENA_HEADER UPG_ARENA_ROUND(sizeof(gsize))
+#define UPG_ARENA_MINIMUM 1024
+
+/**
+ * SECTION:upgparser
+ * @short_description: Parsing lots of URIs without allocating
+ * @include: liburiparser-gobject.h
+ * @title: UpgUriParser
+ *
+ * #UpgUriParser is a parser and a #UpgUri that are meant to be used over and
+ * over again. upg_uri_configure_from_string() frees everything a #UpgUri has
+ * and allocates it all again; #UpgUriParser instead keeps its buffers around
+ * between parses and only ever grows them, so once it has seen a URI of a
+ * certain size, parsing another one like it doesn't allocate anything.
+ *
+ * The #UpgUri returned by upg_uri_parser_parse() belongs to the parser. It's
+ * the same object every time, and it's only valid until the next parse; use
+ * upg_uri_copy() if you need to keep it around.
+ */
+struct _UpgUriParser {
+    GObject parent_instance;
+
+    UpgUri* uri;
+    UpgArena arenas[2];
+    guint current;
+};
+
+G_DEFINE_TYPE(UpgUriParser, upg_uri_parser, G_TYPE_OBJECT)
+
+static void upg_uri_parser_dispose(GObject* obj)
+{
+    UpgUriParser* self = UPG_URI_PARSER(obj);
+
+    if (self->uri != NULL) {
+        // someone else might still have a reference, so make sure it isn't
+        // pointing into our arenas when they go away
+        upg_uri_configure_from_string(self->uri, NULL, NULL);
+        g_clear_object(&self->uri);
+    }
+
+    G_OBJECT_CLASS(upg_uri_parser_parent_class)->dispose(obj);
+}
+
+static void upg_uri_parser_finalize(GObject* obj)
+{
+    UpgUriParser* self = UPG_URI_PARSER(obj);
+
+    upg_arena_clear(&self->arenas[0]);
+    upg_arena_clear(&self->arenas[1]);
+
+    G_OBJECT_CLASS(upg_uri_parser_parent_class)->finalize(obj);
+}
+
+static void upg_uri_parser_class_init(UpgUriParserClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->dispose = upg_uri_parser_dispose;
+    glass->finalize = upg_uri_parser_finalize;
+}
+
+static void upg_uri_parser_init(UpgUriParser* self)
+{
+    self->uri = upg_uri_new(NULL, NULL);
+    upg_arena_init(&self->arenas[0], NULL, 0);
+    upg_arena_init(&self->arenas[1], NULL, 0);
+}
+
+/**
+ * upg_uri_parser_new:
+ *
+ * Creates a new #UpgUriParser, with an empty #UpgUri.
+ *
+ * Returns: (transfer full): a new #UpgUriParser.
+ */
+UpgUriParser* upg_uri_parser_new(void)
+{
+    return g_object_new(UPG_TYPE_URI_PARSER, NULL);
+}
+
+/**
+ * upg_uri_parser_parse:
+ * @self: The parser to use.
+ * @uri: (transfer none) (not nullable): The URI to parse.
+ * @len: The length of @uri in bytes, or -1 if it is nul-terminated.
+ * @error: A #GError.
+ *
+ * Parses and normalizes @uri into the #UpgUri belonging to @self, reusing the
+ * memory from earlier parses. This works like upg_uri_configure_from_string(),
+ * and an empty @uri clears the URI in the same way.
+ *
+ * If parsing fails, the URI keeps whatever it had before and @error is set.
+ *
+ * Returns: (transfer none) (nullable): The parsed URI, which is valid until the
+ * next call, or %NULL if @error is set.
+ */
+UpgUri* upg_uri_parser_parse(UpgUriParser* self, const gchar* uri, gssize len, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_URI_PARSER(self), NULL);
+    g_return_val_if_fail(uri != NULL, NULL);
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+    if (len < 0) {
+        len = strlen(uri);
+    }
+
+    if (len == 0) {
+        upg_uri_configure_from_string(self->uri, NULL, NULL);
+        return self->uri;
+    }
+
+    // the URI is still using the current arena, so parse into the other one;
+    // that way a failed parse leaves it untouched
+    UpgArena* spare = &self->arenas[!self->current];
+    upg_arena_reset(spare);
+    upg_arena_reserve(spare, len * 4 + UPG_ARENA_MINIMUM);
+
+    gchar* text = upg_arena_alloc(spare, len);
+    memcpy(text, uri, len);
+
+    UriUriA parsed;
+    if (!upg_uri_parse_range(&parsed, text, text + len, &spare->memory, error)) {
+        return NULL;
+    }
+
+    // a notify handler might parse again, so the arenas have to be swapped
+    // before anyone hears about the new URI
+    guint32 changed = upg_uri_take_internal(self->uri, &parsed, &spare->memory, NULL);
+    self->current = !self->current;
+    upg_uri_notify_changes(self->uri, changed);
+    return self->uri;
+}
+
+/**
+ * upg_uri_parser_get_uri:
+ * @self: The parser to get the URI of.
+ *
+ * Gets the #UpgUri that @self parses into. It's the same object that
+ * upg_uri_parser_parse() returns, so the same rules apply to it.
+ *
+ * Returns: (transfer none): The URI belonging to @self.
+ */
+UpgUri* upg_uri_parser_get_uri(UpgUriParser* self)
+{
+    g_return_val_if_fail(UPG_IS_URI_PARSER(self), NULL);
+
+    return self->uri;
+}
+
+static void* upg_arena_mm_malloc(UriMemoryManager* memory, size_t size)
+{
+    return upg_arena_alloc(memory->userData, size);
+}
+
+static void* upg_arena_mm_calloc(UriMemoryManager* memory, size_t nmemb, size_t size)
+{
+    gsize total;
+    if (!g_size_checked_mul(&total, nmemb, size)) {
+        return NULL;
+    }
+
+    void* ret = upg_arena_alloc(memory->userData, total);
+    memset(ret, 0, total);
+    return ret;
+}
+
+static void* upg_arena_mm_realloc(UriMemoryManager* memory, void* ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return upg_arena_alloc(memory->userData, size);
+    }
+
+    gsize old_size = *(gsize*)((guint8*)ptr - UPG_ARENA_HEADER);
+    if (size <= old_size) {
+        return ptr;
+    }
+
+    void* ret = upg_arena_alloc(memory->userData, size);
+    memcpy(ret, ptr, old_size);
+    return ret;
+}
+
+static void* upg_arena_mm_reallocarray(UriMemoryManager* memory, void* ptr, size_t nmemb, size_t size)
+{
+    gsize total;
+    if (!g_size_checked_mul(&total, nmemb, size)) {
+        return NULL;
+    }
+
+    return upg_arena_mm_realloc(memory, ptr, total);
+}
+
+static void upg_arena_mm_free(UriMemoryManager* memory, void* ptr)
+{
+    (void)memory;
+    (void)ptr;
+}
+
+/*
+ * __upg_arena_init__:
+ * @arena: (out caller-allocates): The arena to set up.
+ * @buffer: (nullable): Memory to start out with, or %NULL.
+ * @capacity: The size of @buffer.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Sets up @arena. If @buffer is given, it is used until it runs out, but it is
+ * never freed; this is useful for stack buffers.
+ */
+void __upg_arena_init__(UpgArena* arena, gpointer buffer, gsize capacity)
+{
+    arena->memory = (UriMemoryManager) {
+        upg_arena_mm_malloc,
+        upg_arena_mm_calloc,
+        upg_arena_mm_realloc,
+        upg_arena_mm_reallocarray,
+        upg_arena_mm_free,
+        arena,
+    };
+
+    // stack buffers might not be aligned like g_malloc() would
+    gsize skew = buffer ? UPG_ARENA_ROUND((gsize)buffer) - (gsize)buffer : 0;
+    arena->buffer = capacity > skew ? (guint8*)buffer + skew : NULL;
+    arena->capacity = capacity > skew ? capacity - skew : 0;
+    arena->used = 0;
+    arena->owned = FALSE;
+    arena->overflow = NULL;
+    arena->overflow_size = 0;
+}
+
+/*
+ * __upg_arena_reserve__:
+ * @arena: The arena to grow.
+ * @capacity: The size that the arena should have.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Makes sure that @arena can fit @capacity bytes without overflowing. This may
+ * only be called right after upg_arena_reset(), since it may move the buffer.
+ */
+void __upg_arena_reserve__(UpgArena* arena, gsize capacity)
+{
+    g_return_if_fail(arena->used == 0);
+
+    if (arena->capacity >= capacity) {
+        return;
+    }
+
+    if (arena->owned) {
+        g_free(arena->buffer);
+    }
+
+    arena->buffer = g_malloc(capacity);
+    arena->capacity = capacity;
+    arena->owned = TRUE;
+}
+
+/*
+ * __upg_arena_alloc__:
+ * @arena: The arena to allocate from.
+ * @size: The number of bytes to allocate.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Allocates @size bytes from @arena. This never fails; if the arena is full,
+ * it falls back to g_malloc() until the next upg_arena_reset().
+ *
+ * Returns: (transfer none): the new memory, aligned like g_malloc().
+ */
+gpointer __upg_arena_alloc__(UpgArena* arena, gsize size)
+{
+    gsize needed = UPG_ARENA_HEADER + UPG_ARENA_ROUND(size);
+    guint8* block;
+
+    if (arena->capacity - arena->used >= needed) {
+        block = arena->buffer + arena->used;
+        arena->used += needed;
+    } else {
+        block = g_malloc(needed);
+        arena->overflow = g_slist_prepend(arena->overflow, block);
+        arena->overflow_size += needed;
+    }
+
+    *(gsize*)block = size;
+    return block + UPG_ARENA_HEADER;
+}
+
+/*
+ * __upg_arena_reset__:
+ * @arena: The arena to reset.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Forgets everything allocated from @arena. If it overflowed since the last
+ * reset, the buffer is grown so that the same allocations would fit next time.
+ */
+void __upg_arena_reset__(UpgArena* arena)
+{
+    if (arena->overflow != NULL) {
+        gsize capacity = MAX(arena->capacity + arena->overflow_size, UPG_ARENA_MINIMUM);
+
+        g_slist_free_full(arena->overflow, g_free);
+        arena->overflow = NULL;
+        arena->overflow_size = 0;
+
+        arena->used = 0;
+        upg_arena_reserve(arena, capacity);
+    }
+
+    arena->used = 0;
+}
+
+/*
+ * __upg_arena_clear__:
+ * @arena: The arena to clear.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Frees everything that @arena owns. It can be used again afterwards, as if it
+ * had been initialized with no buffer.
+ */
+void __upg_arena_clear__(UpgArena* arena)
+{
+    g_slist_free_full(arena->overflow, g_free);
+
+    if (arena->owned) {
+        g_free(arena->buffer);
+    }
+
+    upg_arena_init(arena, NULL, 0);
+}
@@ -0,0 +1,77 @@
+/* upgparser.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGPARSER_H
+#define UPGPARSER_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+#define UPG_TYPE_URI_PARSER upg_uri_parser_get_type()
+G_DECLARE_FINAL_TYPE(UpgUriParser, upg_uri_parser, UPG, URI_PARSER, GObject)
+
+UpgUriParser* upg_uri_parser_new(void);
+UpgUri* upg_uri_parser_parse(UpgUriParser* self, const gchar* uri, gssize len, GError** error);
+UpgUri* upg_uri_parser_get_uri(UpgUriParser* self);
+
+#ifdef LIBURIPARSER_GOBJECT_COMPILATION
+#include <uriparser/Uri.h>
+
+/*
+ * UpgArena:
+ *
+ * > This is an internal type! Do not use!
+ *
+ * A bump allocator that liburiparser can allocate through. Freeing is a no-op;
+ * everything is released at once by upg_arena_reset(), which also folds any
+ * overflow into a single bigger buffer for next time.
+ */
+typedef struct {
+    UriMemoryManager memory;
+    guint8* buffer;
+    gsize capacity;
+    gsize used;
+    gboolean owned;
+    GSList* overflow;
+    gsize overflow_size;
+} UpgArena;
+
+#define upg_arena_init(arena, buffer, capacity) __upg_arena_init__(arena, buffer, capacity)
+#define upg_arena_reserve(arena, capacity) __upg_arena_reserve__(arena, capacity)
+#define upg_arena_alloc(arena, size) __upg_arena_alloc__(arena, size)
+#define upg_arena_reset(arena) __upg_arena_reset__(arena)
+#define upg_arena_clear(arena) __upg_arena_clear__(arena)
+void __upg_arena_init__(UpgArena* arena, gpointer buffer, gsize capacity);
+void __upg_arena_reserve__(UpgArena* arena, gsize capacity);
+gpointer __upg_arena_alloc__(UpgArena* arena, gsize size);
+void __upg_arena_reset__(UpgArena* arena);
+void __upg_arena_clear__(UpgArena* arena);
+#endif
+
+G_END_DECLS
+
+#endif
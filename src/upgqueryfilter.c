@@ -0,0 +1,447 @@
+/* upgqueryfilter.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgqueryfilter.h"
+#include "upgparams.h"
+#include <string.h>
+
+#define UPG_QUERY_FILTER_MAX_HOST 255
+#define UPG_QUERY_FILTER_MAX_KEY 256
+#define UPG_QUERY_FILTER_NO_ACTION (-1)
+
+/**
+ * SECTION:upgqueryfilter
+ * @short_description: Taking unwanted parameters out of queries
+ * @include: liburiparser-gobject.h
+ * @title: UpgQueryFilter
+ *
+ * #UpgQueryFilter takes query parameters out of URIs according to a set of
+ * rules, like removing `utm_*` and `fbclid` tracking parameters everywhere,
+ * or only keeping a few known parameters for one host. It goes through the
+ * query once and keeps the parameters that are left in the order they were
+ * in, which isn't possible going through upg_uri_get_query().
+ *
+ * Each rule has a pattern that the (percent-decoded) key of a parameter is
+ * matched against:
+ *
+ * - a plain key, like `fbclid`, matches only that key;
+ * - a key followed by `*`, like `utm_*`, matches every key starting with it;
+ * - anything else with `*` or `?` in it, like `*clid`, is a glob, where `*`
+ *   matches any number of bytes and `?` matches one.
+ *
+ * Plain keys and prefixes are put together into a trie, so matching a key
+ * against them looks at each byte of the key once however many rules there
+ * are; globs are tried one after another. If more than one rule matches, a
+ * plain key wins over a prefix, a longer prefix wins over a shorter one, and
+ * either wins over a glob. Globs are tried in the order they were added.
+ *
+ * Rules can be given for all hosts, or for one host. The rules for the host
+ * of a URI are tried first, then that host's default from
+ * upg_query_filter_set_default() if it has one, then the rules for all hosts,
+ * and finally the default for all hosts, which starts off as
+ * %UPG_QUERY_FILTER_KEEP. Setting a host's default to
+ * %UPG_QUERY_FILTER_REMOVE makes its rules an allow-list.
+ *
+ * Once all the rules are added, a filter can be used from several threads at
+ * once, as long as no more rules are added.
+ */
+
+typedef struct {
+    guint first_child;
+    guint next_sibling;
+    guchar byte;
+    gint8 exact;
+    gint8 prefix;
+} UpgQueryFilterNode;
+
+typedef struct {
+    gchar* pattern;
+    gint8 action;
+} UpgQueryFilterGlob;
+
+typedef struct {
+    GArray* nodes;
+    GArray* globs;
+    gint8 fallback;
+} UpgQueryFilterRules;
+
+struct _UpgQueryFilter {
+    GObject parent_instance;
+
+    UpgQueryFilterRules* any_host;
+    GHashTable* hosts;
+};
+
+G_DEFINE_TYPE(UpgQueryFilter, upg_query_filter, G_TYPE_OBJECT)
+
+/**
+ * upg_query_filter_action_get_type:
+ *
+ * Returns the #GType corresponding to #UpgQueryFilterAction, setting it up if
+ * necessary.
+ *
+ * Returns: the #GType
+ */
+GType upg_query_filter_action_get_type(void)
+{
+    static volatile gsize gtype_id = 0;
+    static const GEnumValue values[] = {
+        { UPG_QUERY_FILTER_KEEP, "UPG_QUERY_FILTER_KEEP", "keep" },
+        { UPG_QUERY_FILTER_REMOVE, "UPG_QUERY_FILTER_REMOVE", "remove" },
+        { 0, NULL, NULL }
+    };
+
+    if (g_once_init_enter(&gtype_id)) {
+        GType new_type = g_enum_register_static(g_intern_static_string("UpgQueryFilterAction"), values);
+        g_once_init_leave(&gtype_id, new_type);
+    }
+
+    return (GType)gtype_id;
+}
+
+static UpgQueryFilterRules* upg_query_filter_rules_new(void)
+{
+    UpgQueryFilterRules* rules = g_new0(UpgQueryFilterRules, 1);
+    rules->nodes = g_array_new(FALSE, FALSE, sizeof(UpgQueryFilterNode));
+    rules->globs = g_array_new(FALSE, FALSE, sizeof(UpgQueryFilterGlob));
+    rules->fallback = UPG_QUERY_FILTER_NO_ACTION;
+
+    UpgQueryFilterNode root = { 0, 0, 0, UPG_QUERY_FILTER_NO_ACTION, UPG_QUERY_FILTER_NO_ACTION };
+    g_array_append_val(rules->nodes, root);
+    return rules;
+}
+
+static void upg_query_filter_rules_free(gpointer ptr)
+{
+    UpgQueryFilterRules* rules = ptr;
+
+    for (guint i = 0; i < rules->globs->len; i++) {
+        g_free(g_array_index(rules->globs, UpgQueryFilterGlob, i).pattern);
+    }
+    g_array_unref(rules->globs);
+    g_array_unref(rules->nodes);
+    g_free(rules);
+}
+
+// the root is never anyone's child, so 0 can mean "none" for the links
+static guint upg_query_filter_rules_child(const UpgQueryFilterRules* rules, guint node, guchar byte)
+{
+    const UpgQueryFilterNode* nodes = (const UpgQueryFilterNode*)rules->nodes->data;
+    for (guint child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling) {
+        if (nodes[child].byte == byte) {
+            return child;
+        }
+    }
+    return 0;
+}
+
+static void upg_query_filter_rules_insert(UpgQueryFilterRules* rules, const gchar* key, gsize len, gboolean prefix, gint8 action)
+{
+    guint node = 0;
+    for (gsize i = 0; i < len; i++) {
+        guint child = upg_query_filter_rules_child(rules, node, (guchar)key[i]);
+        if (child == 0) {
+            UpgQueryFilterNode new_node = { 0, 0, (guchar)key[i], UPG_QUERY_FILTER_NO_ACTION, UPG_QUERY_FILTER_NO_ACTION };
+            child = rules->nodes->len;
+            new_node.next_sibling = g_array_index(rules->nodes, UpgQueryFilterNode, node).first_child;
+            g_array_append_val(rules->nodes, new_node);
+            g_array_index(rules->nodes, UpgQueryFilterNode, node).first_child = child;
+        }
+        node = child;
+    }
+
+    if (prefix) {
+        g_array_index(rules->nodes, UpgQueryFilterNode, node).prefix = action;
+    } else {
+        g_array_index(rules->nodes, UpgQueryFilterNode, node).exact = action;
+    }
+}
+
+static gint8 upg_query_filter_rules_match(const UpgQueryFilterRules* rules, const gchar* key, gsize len)
+{
+    const UpgQueryFilterNode* nodes = (const UpgQueryFilterNode*)rules->nodes->data;
+    gint8 prefix = nodes[0].prefix;
+    guint node = 0;
+    gsize i = 0;
+
+    for (; i < len; i++) {
+        node = upg_query_filter_rules_child(rules, node, (guchar)key[i]);
+        if (node == 0) {
+            break;
+        }
+        if (nodes[node].prefix != UPG_QUERY_FILTER_NO_ACTION) {
+            prefix = nodes[node].prefix;
+        }
+    }
+
+    if (i == len && nodes[node].exact != UPG_QUERY_FILTER_NO_ACTION) {
+        return nodes[node].exact;
+    }
+    if (prefix != UPG_QUERY_FILTER_NO_ACTION) {
+        return prefix;
+    }
+
+    for (guint g = 0; g < rules->globs->len; g++) {
+        const UpgQueryFilterGlob* glob = &g_array_index(rules->globs, UpgQueryFilterGlob, g);
+        if (upg_glob_match(glob->pattern, key, len)) {
+            return glob->action;
+        }
+    }
+
+    return UPG_QUERY_FILTER_NO_ACTION;
+}
+
+static void upg_query_filter_finalize(GObject* obj)
+{
+    UpgQueryFilter* self = UPG_QUERY_FILTER(obj);
+
+    upg_query_filter_rules_free(self->any_host);
+    g_hash_table_unref(self->hosts);
+
+    G_OBJECT_CLASS(upg_query_filter_parent_class)->finalize(obj);
+}
+
+static void upg_query_filter_class_init(UpgQueryFilterClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_query_filter_finalize;
+}
+
+static void upg_query_filter_init(UpgQueryFilter* self)
+{
+    self->any_host = upg_query_filter_rules_new();
+    self->any_host->fallback = UPG_QUERY_FILTER_KEEP;
+    self->hosts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, upg_query_filter_rules_free);
+}
+
+/**
+ * upg_query_filter_new:
+ *
+ * Creates a new #UpgQueryFilter without any rules, which keeps everything.
+ *
+ * Returns: (transfer full): a new #UpgQueryFilter.
+ */
+UpgQueryFilter* upg_query_filter_new(void)
+{
+    return g_object_new(UPG_TYPE_QUERY_FILTER, NULL);
+}
+
+static UpgQueryFilterRules* upg_query_filter_rules_for(UpgQueryFilter* self, const gchar* host)
+{
+    if (host == NULL) {
+        return self->any_host;
+    }
+
+    gchar* lower = g_ascii_strdown(host, -1);
+    UpgQueryFilterRules* rules = g_hash_table_lookup(self->hosts, lower);
+    if (rules == NULL) {
+        rules = upg_query_filter_rules_new();
+        g_hash_table_insert(self->hosts, lower, rules);
+    } else {
+        g_free(lower);
+    }
+    return rules;
+}
+
+/**
+ * upg_query_filter_add_rule:
+ * @self: The filter to add to.
+ * @host: (nullable): The host the rule is for, or %NULL for all hosts.
+ * @pattern: (not nullable): The pattern to match keys against; see the
+ *           section description.
+ * @action: What to do with parameters whose key matches @pattern.
+ *
+ * Adds a rule to @self. If there's already a rule with the same plain key or
+ * prefix for @host, it's replaced.
+ */
+void upg_query_filter_add_rule(UpgQueryFilter* self, const gchar* host, const gchar* pattern, UpgQueryFilterAction action)
+{
+    g_return_if_fail(UPG_IS_QUERY_FILTER(self));
+    g_return_if_fail(pattern != NULL);
+    g_return_if_fail(action == UPG_QUERY_FILTER_KEEP || action == UPG_QUERY_FILTER_REMOVE);
+
+    UpgQueryFilterRules* rules = upg_query_filter_rules_for(self, host);
+    gsize len = strlen(pattern);
+    const gchar* wildcard = strpbrk(pattern, "*?");
+
+    if (wildcard == NULL) {
+        upg_query_filter_rules_insert(rules, pattern, len, FALSE, action);
+    } else if (wildcard == pattern + len - 1 && *wildcard == '*') {
+        upg_query_filter_rules_insert(rules, pattern, len - 1, TRUE, action);
+    } else {
+        UpgQueryFilterGlob glob = { g_strdup(pattern), action };
+        g_array_append_val(rules->globs, glob);
+    }
+}
+
+/**
+ * upg_query_filter_set_default:
+ * @self: The filter to change.
+ * @host: (nullable): The host to set the default for, or %NULL for all hosts.
+ * @action: What to do with parameters that none of the rules match.
+ *
+ * Sets what happens to parameters that none of the rules for @host match.
+ * For a single host, the rules for all hosts aren't tried after this.
+ */
+void upg_query_filter_set_default(UpgQueryFilter* self, const gchar* host, UpgQueryFilterAction action)
+{
+    g_return_if_fail(UPG_IS_QUERY_FILTER(self));
+    g_return_if_fail(action == UPG_QUERY_FILTER_KEEP || action == UPG_QUERY_FILTER_REMOVE);
+
+    upg_query_filter_rules_for(self, host)->fallback = action;
+}
+
+static const UpgQueryFilterRules* upg_query_filter_find_host(UpgQueryFilter* self, const gchar* host, gsize len)
+{
+    if (host == NULL || len > UPG_QUERY_FILTER_MAX_HOST || g_hash_table_size(self->hosts) == 0) {
+        return NULL;
+    }
+
+    gchar lower[UPG_QUERY_FILTER_MAX_HOST + 1];
+    for (gsize i = 0; i < len; i++) {
+        lower[i] = g_ascii_tolower(host[i]);
+    }
+    lower[len] = '\0';
+
+    return g_hash_table_lookup(self->hosts, lower);
+}
+
+static UpgQueryFilterAction upg_query_filter_decide(UpgQueryFilter* self, const UpgQueryFilterRules* host_rules, const gchar* key, gsize len)
+{
+    gint8 action = UPG_QUERY_FILTER_NO_ACTION;
+
+    if (host_rules != NULL) {
+        action = upg_query_filter_rules_match(host_rules, key, len);
+        if (action == UPG_QUERY_FILTER_NO_ACTION) {
+            action = host_rules->fallback;
+        }
+    }
+
+    if (action == UPG_QUERY_FILTER_NO_ACTION) {
+        action = upg_query_filter_rules_match(self->any_host, key, len);
+    }
+
+    if (action == UPG_QUERY_FILTER_NO_ACTION) {
+        action = self->any_host->fallback;
+    }
+
+    return action;
+}
+
+/**
+ * upg_query_filter_lookup:
+ * @self: The filter to use.
+ * @host: (nullable): The host the parameter is for, or %NULL to only use the
+ *        rules for all hosts.
+ * @key: (array length=len) (element-type guint8): The decoded key.
+ * @len: The length of @key, or -1 if it's nul-terminated.
+ *
+ * Finds out what @self would do with a parameter with @key in a URI with
+ * @host.
+ *
+ * Returns: What @self would do.
+ */
+UpgQueryFilterAction upg_query_filter_lookup(UpgQueryFilter* self, const gchar* host, const gchar* key, gssize len)
+{
+    g_return_val_if_fail(UPG_IS_QUERY_FILTER(self), UPG_QUERY_FILTER_KEEP);
+    g_return_val_if_fail(key != NULL, UPG_QUERY_FILTER_KEEP);
+
+    gsize klen = len < 0 ? strlen(key) : (gsize)len;
+    const UpgQueryFilterRules* host_rules = host != NULL ? upg_query_filter_find_host(self, host, strlen(host)) : NULL;
+    return upg_query_filter_decide(self, host_rules, key, klen);
+}
+
+/**
+ * upg_query_filter_apply:
+ * @self: The filter to use.
+ * @uri: (transfer none) (not nullable): The URI to filter the query of.
+ *
+ * Takes the parameters that @self removes out of the query of @uri, keeping
+ * the rest in the same order. Empty parameters, like between the two `&` in
+ * `a&&b`, are taken out too. If nothing is left, the query is unset.
+ *
+ * Keys are percent-decoded, with `+` as a space, before they're matched; the
+ * parameters that are kept are left as they were.
+ *
+ * Returns: Whether the query of @uri changed.
+ */
+gboolean upg_query_filter_apply(UpgQueryFilter* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_QUERY_FILTER(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+
+    const UriUriA* internal = upg_uri_get_internal(uri);
+    if (internal->query.first == NULL) {
+        return FALSE;
+    }
+
+    const UpgQueryFilterRules* host_rules = NULL;
+    if (internal->hostText.first != NULL) {
+        host_rules = upg_query_filter_find_host(self, internal->hostText.first, internal->hostText.afterLast - internal->hostText.first);
+    }
+
+    // what's kept is never longer than the query; the ? in front stops
+    // upg_uri_set_query_str() from eating a ? that starts the first parameter
+    gsize query_len = internal->query.afterLast - internal->query.first;
+    gchar stack[1024];
+    gchar* out = query_len + 2 <= sizeof(stack) ? stack : g_malloc(query_len + 2);
+    gsize out_len = 0;
+    out[out_len++] = '?';
+
+    UpgParamIter iter;
+    UpgSlice key;
+    UpgSlice value;
+    upg_param_iter_init_query(&iter, uri);
+    while (upg_param_iter_next(&iter, &key, &value)) {
+        gchar decoded[UPG_QUERY_FILTER_MAX_KEY];
+        gsize decoded_len;
+        UpgQueryFilterAction action;
+
+        if (memchr(key.data, '%', key.len) == NULL && memchr(key.data, '+', key.len) == NULL) {
+            action = upg_query_filter_decide(self, host_rules, key.data, key.len);
+        } else if (upg_slice_unescape(&key, TRUE, decoded, sizeof(decoded), &decoded_len)) {
+            action = upg_query_filter_decide(self, host_rules, decoded, decoded_len);
+        } else {
+            action = upg_query_filter_decide(self, host_rules, key.data, key.len);
+        }
+
+        if (action != UPG_QUERY_FILTER_KEEP) {
+            continue;
+        }
+
+        const gchar* end = value.data != NULL ? value.data + value.len : key.data + key.len;
+        if (out_len > 1) {
+            out[out_len++] = '&';
+        }
+        memcpy(out + out_len, key.data, end - key.data);
+        out_len += end - key.data;
+    }
+    out[out_len] = '\0';
+
+    gboolean changed = out_len - 1 != query_len;
+    if (changed) {
+        upg_uri_set_query_str(uri, out_len > 1 ? out : NULL);
+    }
+
+    if (out != stack) {
+        g_free(out);
+    }
+    return changed;
+}
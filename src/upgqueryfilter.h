@@ -0,0 +1,60 @@
+/* upgqueryfilter.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGQUERYFILTER_H
+#define UPGQUERYFILTER_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+/**
+ * UpgQueryFilterAction:
+ * @UPG_QUERY_FILTER_KEEP: Keep the parameter.
+ * @UPG_QUERY_FILTER_REMOVE: Take the parameter out of the query.
+ *
+ * What a #UpgQueryFilter does with a query parameter.
+ */
+typedef enum {
+    UPG_QUERY_FILTER_KEEP = 0,
+    UPG_QUERY_FILTER_REMOVE = 1,
+} UpgQueryFilterAction;
+
+GType upg_query_filter_action_get_type(void);
+#define UPG_TYPE_QUERY_FILTER_ACTION upg_query_filter_action_get_type()
+
+#define UPG_TYPE_QUERY_FILTER upg_query_filter_get_type()
+G_DECLARE_FINAL_TYPE(UpgQueryFilter, upg_query_filter, UPG, QUERY_FILTER, GObject)
+
+UpgQueryFilter* upg_query_filter_new(void);
+void upg_query_filter_add_rule(UpgQueryFilter* self, const gchar* host, const gchar* pattern, UpgQueryFilterAction action);
+void upg_query_filter_set_default(UpgQueryFilter* self, const gchar* host, UpgQueryFilterAction action);
+UpgQueryFilterAction upg_query_filter_lookup(UpgQueryFilter* self, const gchar* host, const gchar* key, gssize len);
+gboolean upg_query_filter_apply(UpgQueryFilter* self, UpgUri* uri);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,644 @@
+/* upgresolver.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgresolver.h"
+#include "upgerror.h"
+#include <string.h>
+#include <uriparser/Uri.h>
+
+/**
+ * SECTION:upgresolver
+ * @short_description: Resolving lots of references against one base
+ * @include: liburiparser-gobject.h
+ * @title: UpgBaseResolver
+ *
+ * #UpgBaseResolver does the same thing as upg_uri_apply_reference(), but is
+ * meant for when there are a lot of references to resolve against the same
+ * base, like all the links on a web page. The base is normalized and written
+ * out once, when the resolver is made, and the results can be had as strings
+ * (or as views into a buffer the resolver owns) without making a #UpgUri for
+ * each.
+ *
+ * References that only replace the end of the base, like `#section`,
+ * `?page=2` and `/about`, are put together by copying the start of the base;
+ * anything else goes through uriparser, like upg_uri_apply_reference() does.
+ * Either way, the result is the same.
+ *
+ * The resolver can also go the other way: upg_base_resolver_subtract() and
+ * upg_base_resolver_subtract_many() find the shortest reference that gets
+ * from the base to each of a set of URIs, like
+ * upg_uri_subtract_to_reference(), which is handy for writing out relative
+ * links.
+ *
+ * Later changes to the base #UpgUri don't affect the resolver.
+ */
+
+/*
+ * UpgUriSpans:
+ *
+ * Where the parts of a textual URI start. The scheme ends just before
+ * @scheme_end, and is there if @scheme_end isn't 0; the authority is there if
+ * @path_start is past @scheme_end. The query and fragment include their '?' and
+ * '#', and are empty if they aren't there.
+ */
+typedef struct {
+    gsize scheme_end;
+    gsize path_start;
+    gsize query_start;
+    gsize fragment_start;
+} UpgUriSpans;
+
+struct _UpgBaseResolver {
+    GObject parent_instance;
+
+    UriUriA base;
+    gchar* text;
+    UpgUriSpans spans;
+    const gchar* dir;
+    gsize dir_len;
+    gsize dir_depth;
+    GString* scratch;
+};
+
+G_DEFINE_TYPE(UpgBaseResolver, upg_base_resolver, G_TYPE_OBJECT)
+
+static void upg_base_resolver_finalize(GObject* obj)
+{
+    UpgBaseResolver* self = UPG_BASE_RESOLVER(obj);
+
+    uriFreeUriMembersA(&self->base);
+    g_free(self->text);
+    g_string_free(self->scratch, TRUE);
+
+    G_OBJECT_CLASS(upg_base_resolver_parent_class)->finalize(obj);
+}
+
+static void upg_base_resolver_class_init(UpgBaseResolverClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_base_resolver_finalize;
+}
+
+static void upg_base_resolver_init(UpgBaseResolver* self)
+{
+    self->scratch = g_string_new(NULL);
+}
+
+static void upg_uri_spans_find(const gchar* text, UpgUriSpans* spans)
+{
+    const gchar* current = text;
+    if (g_ascii_isalpha(*current)) {
+        const gchar* end = current + 1;
+        while (g_ascii_isalnum(*end) || *end == '+' || *end == '-' || *end == '.')
+            end++;
+
+        if (*end == ':')
+            current = end + 1;
+    }
+    spans->scheme_end = current - text;
+
+    if (current[0] == '/' && current[1] == '/')
+        current += strcspn(current + 2, "/?#") + 2;
+    spans->path_start = current - text;
+
+    current += strcspn(current, "?#");
+    spans->query_start = current - text;
+
+    current += strcspn(current, "#");
+    spans->fragment_start = current - text;
+}
+
+static gboolean upg_is_pchar(gchar c)
+{
+    return g_ascii_isalnum(c) || (c != '\0' && strchr("-._~!$&'()*+,;=:@", c) != NULL);
+}
+
+/*
+ * upg_reference_tail_is_simple:
+ * @str: The text after the '?' or '#' of a reference.
+ * @query: Whether @str starts in the query (as opposed to the fragment).
+ *
+ * Checks that @str is a valid query and/or fragment that normalization
+ * wouldn't change; that is, there are no percent-encodings. Empty components
+ * are left to uriparser.
+ *
+ * Returns: Whether @str can be copied into the result as it is.
+ */
+static gboolean upg_reference_tail_is_simple(const gchar* str, gboolean query)
+{
+    if (*str == '\0' || *str == '#')
+        return FALSE;
+
+    for (; *str != '\0'; str++) {
+        if (upg_is_pchar(*str) || *str == '/' || *str == '?')
+            continue;
+
+        if (*str == '#' && query && str[1] != '\0') {
+            query = FALSE;
+            continue;
+        }
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * upg_reference_path_is_simple:
+ * @str: A reference starting with a single '/'.
+ *
+ * Like upg_reference_tail_is_simple(), but for an absolute-path reference;
+ * dot segments, which would need removing, aren't simple either.
+ *
+ * Returns: Whether @str can be copied into the result as it is.
+ */
+static gboolean upg_reference_path_is_simple(const gchar* str)
+{
+    if (str[1] == '/' || str[1] == '\0' || str[1] == '?' || str[1] == '#')
+        return FALSE;
+
+    while (*str == '/') {
+        const gchar* segment = ++str;
+        while (upg_is_pchar(*str))
+            str++;
+
+        gsize len = str - segment;
+        if ((len == 1 && segment[0] == '.') || (len == 2 && segment[0] == '.' && segment[1] == '.'))
+            return FALSE;
+    }
+
+    switch (*str) {
+    case '\0':
+        return TRUE;
+    case '?':
+        return upg_reference_tail_is_simple(str + 1, TRUE);
+    case '#':
+        return upg_reference_tail_is_simple(str + 1, FALSE);
+    default:
+        return FALSE;
+    }
+}
+
+/**
+ * upg_base_resolver_new:
+ * @base: (transfer none) (not nullable): The base to resolve against. It must
+ *        have a scheme.
+ * @error: A #GError.
+ *
+ * Creates a new #UpgBaseResolver that resolves references against @base.
+ *
+ * Returns: (transfer full): a new #UpgBaseResolver, or %NULL if @error is set.
+ */
+UpgBaseResolver* upg_base_resolver_new(UpgUri* base, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_URI(base), NULL);
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+    gchar* text = upg_uri_to_string(base);
+    if (text == NULL) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_REFERENCE, "Base URI must be absolute");
+        return NULL;
+    }
+
+    // the setters on UpgUri don't normalize, but the results would be, so do
+    // it here
+    UriUriA parsed;
+    if (!upg_uri_parse_range(&parsed, text, text + strlen(text), NULL, error)) {
+        g_free(text);
+        return NULL;
+    }
+
+    if (parsed.scheme.first == NULL) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_REFERENCE, "Base URI must be absolute");
+        uriFreeUriMembersA(&parsed);
+        g_free(text);
+        return NULL;
+    }
+
+    int chars = 0;
+    int ret;
+    gchar* normalized = NULL;
+    if ((ret = uriToStringCharsRequiredA(&parsed, &chars)) == URI_SUCCESS) {
+        normalized = g_malloc(chars + 1);
+        if ((ret = uriToStringA(normalized, &parsed, chars + 1, NULL)) != URI_SUCCESS) {
+            g_clear_pointer(&normalized, g_free);
+        }
+    }
+    uriFreeUriMembersA(&parsed);
+    g_free(text);
+
+    if (normalized == NULL) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_NORMALIZE, "Failed to write normalized base URI: %s", upg_strurierror(ret));
+        return NULL;
+    }
+
+    // parse it again so that the base points into the text we keep
+    UpgBaseResolver* self = g_object_new(UPG_TYPE_BASE_RESOLVER, NULL);
+    self->text = normalized;
+    if (uriParseSingleUriA(&self->base, normalized, NULL) != URI_SUCCESS) {
+        g_assert_not_reached();
+    }
+
+    upg_uri_spans_find(normalized, &self->spans);
+
+    // the "directory" of the base is what relative paths are merged onto; a
+    // base with an authority and no path acts like it has a path of "/"
+    const gchar* path = normalized + self->spans.path_start;
+    gsize path_len = self->spans.query_start - self->spans.path_start;
+    if (path_len > 0 && path[0] == '/') {
+        self->dir = path;
+        self->dir_len = (gsize)(g_strrstr_len(path, path_len, "/") - path) + 1;
+    } else if (path_len == 0 && self->spans.path_start > self->spans.scheme_end) {
+        self->dir = "/";
+        self->dir_len = 1;
+    }
+
+    for (gsize i = 1; i < self->dir_len; i++) {
+        if (self->dir[i] == '/')
+            self->dir_depth++;
+    }
+
+    return self;
+}
+
+/*
+ * upg_base_resolver_append:
+ * @self: The resolver to use.
+ * @reference: (not nullable): The reference to resolve.
+ * @out: (not nullable): The string to append the result to.
+ * @error: A #GError.
+ *
+ * Resolves @reference and appends the result to @out. If this fails, @out is
+ * left as it was.
+ *
+ * Returns: Whether or not the operation succeeded.
+ */
+static gboolean upg_base_resolver_append(UpgBaseResolver* self, const gchar* reference, GString* out, GError** error)
+{
+    switch (reference[0]) {
+    case '\0':
+        g_string_append_len(out, self->text, self->spans.fragment_start);
+        return TRUE;
+    case '#':
+        if (upg_reference_tail_is_simple(reference + 1, FALSE)) {
+            g_string_append_len(out, self->text, self->spans.fragment_start);
+            g_string_append(out, reference);
+            return TRUE;
+        }
+        break;
+    case '?':
+        if (upg_reference_tail_is_simple(reference + 1, TRUE)) {
+            g_string_append_len(out, self->text, self->spans.query_start);
+            g_string_append(out, reference);
+            return TRUE;
+        }
+        break;
+    case '/':
+        if (upg_reference_path_is_simple(reference)) {
+            g_string_append_len(out, self->text, self->spans.path_start);
+            g_string_append(out, reference);
+            return TRUE;
+        }
+        break;
+    }
+
+    UriUriA parsed;
+    UriUriA applied;
+    gint ret;
+    if ((ret = uriParseSingleUriA(&parsed, reference, NULL)) != URI_SUCCESS) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_PARSE, "Failed to parse reference: %s", upg_strurierror(ret));
+        return FALSE;
+    }
+
+    gboolean success = FALSE;
+    if ((ret = uriAddBaseUriA(&applied, &parsed, &self->base)) != URI_SUCCESS) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_REFERENCE, "Failed to apply reference: %s", upg_strurierror(ret));
+        goto cleanup_parsed;
+    }
+
+    if ((ret = uriNormalizeSyntaxA(&applied)) != URI_SUCCESS) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_NORMALIZE, "Failed to normalize applied URI: %s", upg_strurierror(ret));
+        goto cleanup_applied;
+    }
+
+    // write an internationalized host in its ASCII form, like
+    // upg_base_resolver_resolve() gets from UpgUri; applied only borrows it,
+    // and gets its own host back before it is freed
+    UriTextRangeA host = applied.hostText;
+    gchar* ascii = upg_uriuri_idna_host(&applied);
+    if (ascii != NULL) {
+        applied.hostText = (UriTextRangeA) { ascii, ascii + strlen(ascii) };
+    }
+
+    int chars = 0;
+    if ((ret = uriToStringCharsRequiredA(&applied, &chars)) != URI_SUCCESS) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_REFERENCE, "Failed to write applied URI: %s", upg_strurierror(ret));
+        goto cleanup_host;
+    }
+
+    // g_string_set_size() leaves room for the nul, which uriToStringA() wants
+    gsize start = out->len;
+    g_string_set_size(out, start + chars);
+    if ((ret = uriToStringA(out->str + start, &applied, chars + 1, NULL)) != URI_SUCCESS) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_REFERENCE, "Failed to write applied URI: %s", upg_strurierror(ret));
+        g_string_truncate(out, start);
+        goto cleanup_host;
+    }
+    success = TRUE;
+
+cleanup_host:
+    applied.hostText = host;
+    g_free(ascii);
+cleanup_applied:
+    uriFreeUriMembersA(&applied);
+cleanup_parsed:
+    uriFreeUriMembersA(&parsed);
+    return success;
+}
+
+/**
+ * upg_base_resolver_resolve_view:
+ * @self: The resolver to use.
+ * @reference: (transfer none) (not nullable): The reference to resolve.
+ * @len: (out) (optional): Where to put the length of the result.
+ * @error: A #GError.
+ *
+ * Resolves @reference against the base of @self, without making a new string.
+ * The result belongs to @self and is only valid until @self is used again.
+ *
+ * Returns: (transfer none): The resolved URI, or %NULL if @error is set.
+ */
+const gchar* upg_base_resolver_resolve_view(UpgBaseResolver* self, const gchar* reference, gsize* len, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_BASE_RESOLVER(self), NULL);
+    g_return_val_if_fail(reference != NULL, NULL);
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+    g_string_truncate(self->scratch, 0);
+    if (!upg_base_resolver_append(self, reference, self->scratch, error))
+        return NULL;
+
+    if (len != NULL)
+        *len = self->scratch->len;
+
+    return self->scratch->str;
+}
+
+/**
+ * upg_base_resolver_resolve_to_string:
+ * @self: The resolver to use.
+ * @reference: (transfer none) (not nullable): The reference to resolve.
+ * @error: A #GError.
+ *
+ * Resolves @reference against the base of @self.
+ *
+ * Returns: (transfer full): The resolved URI, or %NULL if @error is set.
+ */
+gchar* upg_base_resolver_resolve_to_string(UpgBaseResolver* self, const gchar* reference, GError** error)
+{
+    gsize len = 0;
+    const gchar* view = upg_base_resolver_resolve_view(self, reference, &len, error);
+    if (view == NULL)
+        return NULL;
+
+    return g_strndup(view, len);
+}
+
+/**
+ * upg_base_resolver_resolve:
+ * @self: The resolver to use.
+ * @reference: (transfer none) (not nullable): The reference to resolve.
+ * @error: A #GError.
+ *
+ * Resolves @reference against the base of @self, like
+ * upg_uri_apply_reference().
+ *
+ * Returns: (transfer full): The resolved URI, or %NULL if @error is set.
+ */
+UpgUri* upg_base_resolver_resolve(UpgBaseResolver* self, const gchar* reference, GError** error)
+{
+    gsize len = 0;
+    const gchar* view = upg_base_resolver_resolve_view(self, reference, &len, error);
+    if (view == NULL)
+        return NULL;
+
+    gchar* text = g_strndup(view, len);
+    UriUriA parsed;
+    if (!upg_uri_parse_range(&parsed, text, text + len, NULL, error)) {
+        g_free(text);
+        return NULL;
+    }
+
+    UpgUri* uri = upg_uri_new(NULL, NULL);
+    upg_uri_take_internal(uri, &parsed, NULL, text);
+    return uri;
+}
+
+/**
+ * upg_base_resolver_resolve_many:
+ * @self: The resolver to use.
+ * @references: (array length=n_references) (transfer none): The references to
+ *              resolve.
+ * @n_references: The number of references in @references.
+ * @out: (not nullable): The string to append the results to.
+ * @offsets: (array length=n_references) (out caller-allocates): Where to put
+ *           the offset of each result into @out.
+ *
+ * Resolves each of @references, appending the results to @out one after
+ * another, each followed by a nul byte. The result for `references[i]` starts
+ * at `out->str + offsets[i]`; if it couldn't be resolved, `offsets[i]` is
+ * %UPG_BASE_RESOLVER_FAILED instead, and nothing was appended for it.
+ *
+ * Offsets are used instead of pointers because @out may be reallocated as it
+ * grows.
+ *
+ * Returns: The number of references that were resolved.
+ */
+gsize upg_base_resolver_resolve_many(UpgBaseResolver* self, const gchar* const* references, gsize n_references, GString* out, gsize* offsets)
+{
+    g_return_val_if_fail(UPG_IS_BASE_RESOLVER(self), 0);
+    g_return_val_if_fail(references != NULL || n_references == 0, 0);
+    g_return_val_if_fail(out != NULL, 0);
+    g_return_val_if_fail(offsets != NULL || n_references == 0, 0);
+
+    gsize resolved = 0;
+    for (gsize i = 0; i < n_references; i++) {
+        gsize start = out->len;
+        if (references[i] == NULL || !upg_base_resolver_append(self, references[i], out, NULL)) {
+            offsets[i] = UPG_BASE_RESOLVER_FAILED;
+            continue;
+        }
+
+        g_string_append_c(out, '\0');
+        offsets[i] = start;
+        resolved++;
+    }
+
+    return resolved;
+}
+
+/*
+ * upg_base_resolver_append_subtracted:
+ * @self: The resolver to use.
+ * @target: (not nullable): The textual URI to make a reference to.
+ * @out: (not nullable): The string to append the reference to.
+ *
+ * Appends the shortest reference that gets from the base of @self to @target
+ * that this can find. When there's no relative reference that works, like
+ * when the schemes differ, that's @target itself.
+ */
+static void upg_base_resolver_append_subtracted(UpgBaseResolver* self, const gchar* target, GString* out)
+{
+    UpgUriSpans spans;
+    upg_uri_spans_find(target, &spans);
+
+    if (spans.scheme_end == 0 || spans.scheme_end != self->spans.scheme_end
+        || memcmp(target, self->text, spans.scheme_end) != 0) {
+        g_string_append(out, target);
+        return;
+    }
+
+    if (spans.path_start != self->spans.path_start || memcmp(target, self->text, spans.path_start) != 0) {
+        // same scheme but a different authority, so a network-path reference
+        g_string_append(out, spans.path_start > spans.scheme_end ? target + spans.scheme_end : target);
+        return;
+    }
+
+    const gchar* path = target + spans.path_start;
+    gsize path_len = spans.query_start - spans.path_start;
+    gsize query_len = spans.fragment_start - spans.query_start;
+    gsize base_path_len = self->spans.query_start - self->spans.path_start;
+    gsize base_query_len = self->spans.fragment_start - self->spans.query_start;
+
+    if (path_len == base_path_len && memcmp(path, self->text + self->spans.path_start, path_len) == 0) {
+        if (query_len == base_query_len && memcmp(target + spans.query_start, self->text + self->spans.query_start, query_len) == 0) {
+            g_string_append(out, target + spans.fragment_start);
+            return;
+        }
+
+        if (query_len > 0) {
+            g_string_append(out, target + spans.query_start);
+            return;
+        }
+
+        // the base's query can only be dropped by giving a path
+    }
+
+    if (self->dir == NULL || path_len == 0 || path[0] != '/') {
+        g_string_append(out, target);
+        return;
+    }
+
+    // find how many directories the base and the target have in common
+    gsize depth = 0;
+    gsize matched = 1;
+    for (;;) {
+        const gchar* slash = memchr(self->dir + matched, '/', self->dir_len - matched);
+        if (slash == NULL)
+            break;
+
+        gsize segment_end = slash - self->dir + 1;
+        if (segment_end > path_len || memcmp(self->dir + matched, path + matched, segment_end - matched) != 0)
+            break;
+
+        depth++;
+        matched = segment_end;
+    }
+
+    gsize start = out->len;
+    gsize ups = self->dir_depth - depth;
+    for (gsize i = 0; i < ups; i++)
+        g_string_append(out, "../");
+
+    const gchar* rest = path + matched;
+    gsize rest_len = path_len - matched;
+    if (ups == 0) {
+        // an empty reference, or one that starts with "/" or looks like it
+        // has a scheme, would mean something else
+        const gchar* slash = memchr(rest, '/', rest_len);
+        gsize first_len = slash != NULL ? (gsize)(slash - rest) : rest_len;
+        if (rest_len == 0 || rest[0] == '/' || memchr(rest, ':', first_len) != NULL)
+            g_string_append(out, "./");
+    }
+    g_string_append_len(out, rest, rest_len);
+
+    if (out->len - start > path_len && !(path_len > 1 && path[1] == '/')) {
+        g_string_truncate(out, start);
+        g_string_append_len(out, path, path_len);
+    }
+
+    g_string_append(out, target + spans.query_start);
+}
+
+/**
+ * upg_base_resolver_subtract:
+ * @self: The resolver to use.
+ * @target: (transfer none) (not nullable): The URI to make a reference to.
+ *
+ * Makes the shortest reference that, applied to the base of @self, gives
+ * @target; see upg_uri_subtract_to_reference(). If @target has a different
+ * scheme than the base, the reference is just @target.
+ *
+ * Returns: (transfer full): The reference.
+ */
+gchar* upg_base_resolver_subtract(UpgBaseResolver* self, UpgUri* target)
+{
+    g_return_val_if_fail(UPG_IS_BASE_RESOLVER(self), NULL);
+    g_return_val_if_fail(UPG_IS_URI(target), NULL);
+
+    g_string_truncate(self->scratch, 0);
+    upg_uri_append_to_gstring(target, self->scratch);
+
+    GString* out = g_string_sized_new(self->scratch->len);
+    upg_base_resolver_append_subtracted(self, self->scratch->str, out);
+    return g_string_free(out, FALSE);
+}
+
+/**
+ * upg_base_resolver_subtract_many:
+ * @self: The resolver to use.
+ * @targets: (array length=n_targets) (transfer none): The URIs to make
+ *           references to.
+ * @n_targets: The number of URIs in @targets.
+ * @out: (not nullable): The string to append the references to.
+ * @offsets: (array length=n_targets) (out caller-allocates): Where to put the
+ *           offset of each reference into @out.
+ *
+ * Like upg_base_resolver_subtract(), but for every URI in @targets. The
+ * references are appended to @out one after another, each followed by a nul
+ * byte, and the one for `targets[i]` starts at `out->str + offsets[i]`.
+ */
+void upg_base_resolver_subtract_many(UpgBaseResolver* self, UpgUri** targets, gsize n_targets, GString* out, gsize* offsets)
+{
+    g_return_if_fail(UPG_IS_BASE_RESOLVER(self));
+    g_return_if_fail(targets != NULL || n_targets == 0);
+    g_return_if_fail(out != NULL);
+    g_return_if_fail(offsets != NULL || n_targets == 0);
+
+    for (gsize i = 0; i < n_targets; i++) {
+        g_string_truncate(self->scratch, 0);
+        upg_uri_append_to_gstring(targets[i], self->scratch);
+
+        offsets[i] = out->len;
+        upg_base_resolver_append_subtracted(self, self->scratch->str, out);
+        g_string_append_c(out, '\0');
+    }
+}
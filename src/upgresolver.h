@@ -0,0 +1,55 @@
+/* upgresolver.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGRESOLVER_H
+#define UPGRESOLVER_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+/**
+ * UPG_BASE_RESOLVER_FAILED:
+ *
+ * The offset upg_base_resolver_resolve_many() gives a reference that couldn't
+ * be resolved.
+ */
+#define UPG_BASE_RESOLVER_FAILED G_MAXSIZE
+
+#define UPG_TYPE_BASE_RESOLVER upg_base_resolver_get_type()
+G_DECLARE_FINAL_TYPE(UpgBaseResolver, upg_base_resolver, UPG, BASE_RESOLVER, GObject)
+
+UpgBaseResolver* upg_base_resolver_new(UpgUri* base, GError** error);
+const gchar* upg_base_resolver_resolve_view(UpgBaseResolver* self, const gchar* reference, gsize* len, GError** error);
+gchar* upg_base_resolver_resolve_to_string(UpgBaseResolver* self, const gchar* reference, GError** error);
+UpgUri* upg_base_resolver_resolve(UpgBaseResolver* self, const gchar* reference, GError** error);
+gsize upg_base_resolver_resolve_many(UpgBaseResolver* self, const gchar* const* references, gsize n_references, GString* out, gsize* offsets);
+gchar* upg_base_resolver_subtract(UpgBaseResolver* self, UpgUri* target);
+void upg_base_resolver_subtract_many(UpgBaseResolver* self, UpgUri** targets, gsize n_targets, GString* out, gsize* offsets);
+
+G_END_DECLS
+
+#endif
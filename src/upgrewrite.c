@@ -0,0 +1,720 @@
+/* upgrewrite.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgrewrite.h"
+#include "upgerror.h"
+#include "upgparams.h"
+#include <string.h>
+
+#define UPG_REWRITE_NONE G_MAXUINT
+
+/**
+ * SECTION:upgrewrite
+ * @short_description: Rewriting URIs by rule
+ * @include: liburiparser-gobject.h
+ * @title: UpgRewriteEngine
+ *
+ * #UpgRewriteEngine holds a list of rewrite rules, each matching a host and a
+ * path, and rewrites URIs with the first rule that matches them. Rules are
+ * numbered from 0 in the order they're added, and when more than one matches,
+ * the one with the lowest number wins, so the result doesn't depend on how
+ * the rules are stored.
+ *
+ * The host of a rule is one of:
+ *
+ * - %NULL or `*`, which matches every URI;
+ * - a host like `example.com`, which matches only that host;
+ * - `*.` followed by a host, like `*.example.com`, which matches every host
+ *   under it (but not `example.com` itself).
+ *
+ * Hosts are matched without regard to case. The path of a rule starts with a
+ * `/`, and is matched segment by segment:
+ *
+ * - a plain path like `/a/b` matches only that path;
+ * - a path whose last segment is just `*` matches the path before that
+ *   segment and everything below it, so `/a/` followed by `*` matches `/a`,
+ *   `/a/` and `/a/b/c`, and `/` followed by `*` matches every path; %NULL is
+ *   the same as the latter;
+ * - otherwise, segments can have `*` and `?` in them, which match any number
+ *   of bytes or one byte within that segment.
+ *
+ * A URI without a path is matched as if its path was `/`.
+ *
+ * Hosts are kept in a trie of labels, from the top-level domain down, and
+ * plain paths and prefixes in a trie of segments under each host, so finding
+ * a match only looks at as many nodes as the URI has host labels and path
+ * segments, however many rules there are. Paths with wildcards are tried one
+ * after another, but only those that would win over the best match so far.
+ * Nothing is allocated while matching.
+ *
+ * The target of a rule is a URI reference, which is parsed when the rule is
+ * added. When a rule is applied, the parts that the target has are put into
+ * the URI with the setters on #UpgUri, without parsing it again:
+ *
+ * - the scheme, if the target has one;
+ * - the userinfo, host and port, if the target has a host;
+ * - the path, if the target has one; for rules whose path ends in a `*`
+ *   segment, whatever came after the matched prefix is added to the end of
+ *   it, so with a rule for `/old/` followed by `*` and a target of `/new/`,
+ *   `/old/a/b` becomes `/new/a/b`;
+ * - the query and the fragment, if the target has them.
+ *
+ * Each rule counts how many times it's been applied; see
+ * upg_rewrite_engine_get_hits(). Once all the rules are added, an engine can
+ * be used from several threads at once.
+ */
+
+typedef enum {
+    UPG_REWRITE_EXACT,
+    UPG_REWRITE_PREFIX,
+    UPG_REWRITE_GLOB,
+} UpgRewriteKind;
+
+typedef struct {
+    UpgRewriteKind kind;
+    gchar** segments;
+    gsize n_segments;
+    gboolean rest;
+
+    gchar* scheme;
+    gboolean has_authority;
+    gchar* userinfo;
+    gchar* host;
+    guint16 port;
+    gchar** path;
+    gchar* query;
+    gchar* fragment;
+
+    guint64 hits;
+} UpgRewriteRule;
+
+typedef struct _UpgRewritePathNode UpgRewritePathNode;
+struct _UpgRewritePathNode {
+    GHashTable* children;
+    guint exact;
+    guint prefix;
+};
+
+typedef struct {
+    UpgRewritePathNode* root;
+    GArray* globs;
+} UpgRewritePaths;
+
+typedef struct _UpgRewriteHostNode UpgRewriteHostNode;
+struct _UpgRewriteHostNode {
+    GHashTable* children;
+    UpgRewritePaths* exact;
+    UpgRewritePaths* wildcard;
+};
+
+struct _UpgRewriteEngine {
+    GObject parent_instance;
+
+    UpgRewriteHostNode* hosts;
+    UpgRewritePaths* any_host;
+    GPtrArray* rules;
+};
+
+G_DEFINE_TYPE(UpgRewriteEngine, upg_rewrite_engine, G_TYPE_OBJECT)
+
+// the tries are keyed by slices, so that a URI's segments and host labels can
+// be looked up where they are; labels are compared without regard to case
+static guint upg_rewrite_label_hash(gconstpointer ptr)
+{
+    const UpgSlice* slice = ptr;
+    guint hash = 5381;
+    for (gsize i = 0; i < slice->len; i++) {
+        hash = hash * 33 + (guchar)g_ascii_tolower(slice->data[i]);
+    }
+    return hash;
+}
+
+static gboolean upg_rewrite_label_equal(gconstpointer _a, gconstpointer _b)
+{
+    const UpgSlice* a = _a;
+    const UpgSlice* b = _b;
+    if (a->len != b->len) {
+        return FALSE;
+    }
+
+    for (gsize i = 0; i < a->len; i++) {
+        if (g_ascii_tolower(a->data[i]) != g_ascii_tolower(b->data[i])) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static UpgRewritePathNode* upg_rewrite_path_node_new(void)
+{
+    UpgRewritePathNode* node = g_new0(UpgRewritePathNode, 1);
+    node->exact = UPG_REWRITE_NONE;
+    node->prefix = UPG_REWRITE_NONE;
+    return node;
+}
+
+static void upg_rewrite_path_node_free(gpointer ptr)
+{
+    UpgRewritePathNode* node = ptr;
+    if (node->children != NULL) {
+        g_hash_table_unref(node->children);
+    }
+    g_free(node);
+}
+
+static UpgRewritePaths* upg_rewrite_paths_new(void)
+{
+    UpgRewritePaths* paths = g_new0(UpgRewritePaths, 1);
+    paths->root = upg_rewrite_path_node_new();
+    paths->globs = g_array_new(FALSE, FALSE, sizeof(guint));
+    return paths;
+}
+
+static void upg_rewrite_paths_free(UpgRewritePaths* paths)
+{
+    if (paths == NULL) {
+        return;
+    }
+
+    upg_rewrite_path_node_free(paths->root);
+    g_array_unref(paths->globs);
+    g_free(paths);
+}
+
+static UpgRewriteHostNode* upg_rewrite_host_node_new(void)
+{
+    return g_new0(UpgRewriteHostNode, 1);
+}
+
+static void upg_rewrite_host_node_free(gpointer ptr)
+{
+    UpgRewriteHostNode* node = ptr;
+    if (node->children != NULL) {
+        g_hash_table_unref(node->children);
+    }
+    upg_rewrite_paths_free(node->exact);
+    upg_rewrite_paths_free(node->wildcard);
+    g_free(node);
+}
+
+static void upg_rewrite_rule_free(gpointer ptr)
+{
+    UpgRewriteRule* rule = ptr;
+
+    g_strfreev(rule->segments);
+    g_free(rule->scheme);
+    g_free(rule->userinfo);
+    g_free(rule->host);
+    g_strfreev(rule->path);
+    g_free(rule->query);
+    g_free(rule->fragment);
+    g_free(rule);
+}
+
+static void upg_rewrite_engine_finalize(GObject* obj)
+{
+    UpgRewriteEngine* self = UPG_REWRITE_ENGINE(obj);
+
+    upg_rewrite_host_node_free(self->hosts);
+    upg_rewrite_paths_free(self->any_host);
+    g_ptr_array_unref(self->rules);
+
+    G_OBJECT_CLASS(upg_rewrite_engine_parent_class)->finalize(obj);
+}
+
+static void upg_rewrite_engine_class_init(UpgRewriteEngineClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_rewrite_engine_finalize;
+}
+
+static void upg_rewrite_engine_init(UpgRewriteEngine* self)
+{
+    self->hosts = upg_rewrite_host_node_new();
+    self->any_host = upg_rewrite_paths_new();
+    self->rules = g_ptr_array_new_with_free_func(upg_rewrite_rule_free);
+}
+
+/**
+ * upg_rewrite_engine_new:
+ *
+ * Creates a new #UpgRewriteEngine without any rules.
+ *
+ * Returns: (transfer full): a new #UpgRewriteEngine.
+ */
+UpgRewriteEngine* upg_rewrite_engine_new(void)
+{
+    return g_object_new(UPG_TYPE_REWRITE_ENGINE, NULL);
+}
+
+static gboolean upg_rewrite_rule_set_pattern(UpgRewriteRule* rule, const gchar* path, GError** error)
+{
+    if (path == NULL) {
+        path = "/*";
+    }
+
+    if (*path != '/') {
+        g_set_error(error, UPG_ERROR, UPG_ERR_PARSE, "Rewrite rule paths must start with a slash: %s", path);
+        return FALSE;
+    }
+
+    // a path of "/" has a single empty segment, just like in a URI
+    if (path[1] == '\0') {
+        rule->segments = g_new0(gchar*, 2);
+        rule->segments[0] = g_strdup("");
+    } else {
+        rule->segments = g_strsplit(path + 1, "/", -1);
+    }
+
+    gsize n = g_strv_length(rule->segments);
+    if (n > 0 && strcmp(rule->segments[n - 1], "*") == 0) {
+        g_free(rule->segments[n - 1]);
+        rule->segments[--n] = NULL;
+        rule->rest = TRUE;
+    }
+    rule->n_segments = n;
+
+    rule->kind = rule->rest ? UPG_REWRITE_PREFIX : UPG_REWRITE_EXACT;
+    for (gsize i = 0; i < n; i++) {
+        if (strpbrk(rule->segments[i], "*?") != NULL) {
+            rule->kind = UPG_REWRITE_GLOB;
+        }
+    }
+
+    return TRUE;
+}
+
+static gchar* upg_rewrite_range_dup(UriTextRangeA range)
+{
+    return range.first != NULL ? g_strndup(range.first, range.afterLast - range.first) : NULL;
+}
+
+static gboolean upg_rewrite_rule_set_target(UpgRewriteRule* rule, const gchar* target, GError** error)
+{
+    UriUriA parsed;
+    if (!upg_uri_parse_range(&parsed, target, target + strlen(target), NULL, error)) {
+        return FALSE;
+    }
+
+    rule->has_authority = parsed.hostText.first != NULL || parsed.hostData.ip4 != NULL || parsed.hostData.ip6 != NULL
+        || parsed.hostData.ipFuture.first != NULL;
+
+    if (!rule->has_authority && parsed.pathHead != NULL && !parsed.absolutePath) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_REFERENCE, "Rewrite targets must not have a relative path: %s", target);
+        uriFreeUriMembersA(&parsed);
+        return FALSE;
+    }
+
+    rule->scheme = upg_rewrite_range_dup(parsed.scheme);
+    if (rule->has_authority) {
+        rule->userinfo = upg_rewrite_range_dup(parsed.userInfo);
+        rule->host = upg_rewrite_range_dup(parsed.hostText);
+
+        guint port = 0;
+        for (const gchar* c = parsed.portText.first; c != NULL && c < parsed.portText.afterLast; c++) {
+            port = MIN(port * 10 + (*c - '0'), G_MAXUINT16 + 1);
+        }
+        if (port > G_MAXUINT16) {
+            g_set_error(error, UPG_ERROR, UPG_ERR_PARSE, "Rewrite target has a port that's too big: %s", target);
+            uriFreeUriMembersA(&parsed);
+            return FALSE;
+        }
+        rule->port = (guint16)port;
+    }
+
+    if (parsed.pathHead != NULL || parsed.absolutePath) {
+        gsize n = 0;
+        for (const UriPathSegmentA* segment = parsed.pathHead; segment != NULL; segment = segment->next) {
+            n++;
+        }
+
+        // a bare "/" may come without any segments at all
+        rule->path = g_new0(gchar*, MAX(n, 1) + 1);
+        gsize i = 0;
+        for (const UriPathSegmentA* segment = parsed.pathHead; segment != NULL; segment = segment->next) {
+            rule->path[i++] = segment->text.first != NULL ? upg_rewrite_range_dup(segment->text) : g_strdup("");
+        }
+        if (i == 0) {
+            rule->path[0] = g_strdup("");
+        }
+    }
+
+    rule->query = upg_rewrite_range_dup(parsed.query);
+    rule->fragment = upg_rewrite_range_dup(parsed.fragment);
+
+    uriFreeUriMembersA(&parsed);
+    return TRUE;
+}
+
+static UpgRewritePaths* upg_rewrite_engine_paths_for(UpgRewriteEngine* self, const gchar* host)
+{
+    if (host == NULL || strcmp(host, "*") == 0) {
+        return self->any_host;
+    }
+
+    gboolean wildcard = g_str_has_prefix(host, "*.");
+    if (wildcard) {
+        host += 2;
+    }
+
+    gsize len = strlen(host);
+    if (len > 0 && host[len - 1] == '.') {
+        len--;
+    }
+
+    UpgRewriteHostNode* node = self->hosts;
+    const gchar* end = host + len;
+    for (;;) {
+        const gchar* label = end;
+        while (label > host && label[-1] != '.') {
+            label--;
+        }
+
+        if (node->children == NULL) {
+            node->children = g_hash_table_new_full(upg_rewrite_label_hash, upg_rewrite_label_equal, g_free, upg_rewrite_host_node_free);
+        }
+
+        UpgSlice key = { label, end - label };
+        UpgRewriteHostNode* child = g_hash_table_lookup(node->children, &key);
+        if (child == NULL) {
+            child = upg_rewrite_host_node_new();
+            g_hash_table_insert(node->children, upg_slice_dup(label, end - label), child);
+        }
+        node = child;
+
+        if (label == host) {
+            break;
+        }
+        end = label - 1;
+    }
+
+    UpgRewritePaths** paths = wildcard ? &node->wildcard : &node->exact;
+    if (*paths == NULL) {
+        *paths = upg_rewrite_paths_new();
+    }
+    return *paths;
+}
+
+static void upg_rewrite_paths_insert(UpgRewritePaths* paths, const UpgRewriteRule* rule, guint index)
+{
+    // rules are added in order, so the globs stay sorted
+    if (rule->kind == UPG_REWRITE_GLOB) {
+        g_array_append_val(paths->globs, index);
+        return;
+    }
+
+    UpgRewritePathNode* node = paths->root;
+    for (gsize i = 0; i < rule->n_segments; i++) {
+        if (node->children == NULL) {
+            node->children = g_hash_table_new_full(upg_slice_hash, upg_slice_equal, g_free, upg_rewrite_path_node_free);
+        }
+
+        UpgSlice key = { rule->segments[i], strlen(rule->segments[i]) };
+        UpgRewritePathNode* child = g_hash_table_lookup(node->children, &key);
+        if (child == NULL) {
+            child = upg_rewrite_path_node_new();
+            g_hash_table_insert(node->children, upg_slice_dup(key.data, key.len), child);
+        }
+        node = child;
+    }
+
+    // an earlier rule for the same host and path keeps winning
+    guint* slot = rule->kind == UPG_REWRITE_PREFIX ? &node->prefix : &node->exact;
+    *slot = MIN(*slot, index);
+}
+
+/**
+ * upg_rewrite_engine_add_rule:
+ * @self: The engine to add to.
+ * @host: (nullable): The host to match, or %NULL for every host; see the
+ *        section description.
+ * @path: (nullable): The path to match, or %NULL for every path.
+ * @target: (not nullable): The URI reference to rewrite to.
+ * @error: A #GError.
+ *
+ * Adds a rule to the end of @self, after every rule that's already there.
+ *
+ * Returns: The number of the new rule, or -1 if @path or @target isn't valid,
+ * in which case @error is set.
+ */
+gint upg_rewrite_engine_add_rule(UpgRewriteEngine* self, const gchar* host, const gchar* path, const gchar* target, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_REWRITE_ENGINE(self), -1);
+    g_return_val_if_fail(target != NULL, -1);
+    g_return_val_if_fail(error == NULL || *error == NULL, -1);
+    g_return_val_if_fail(self->rules->len < G_MAXINT, -1);
+
+    if (host != NULL && strcmp(host, "*") != 0 && strchr(g_str_has_prefix(host, "*.") ? host + 2 : host, '*') != NULL) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_PARSE, "Rewrite rule hosts can only start with *.: %s", host);
+        return -1;
+    }
+
+    UpgRewriteRule* rule = g_new0(UpgRewriteRule, 1);
+    if (!upg_rewrite_rule_set_pattern(rule, path, error) || !upg_rewrite_rule_set_target(rule, target, error)) {
+        upg_rewrite_rule_free(rule);
+        return -1;
+    }
+
+    guint index = self->rules->len;
+    g_ptr_array_add(self->rules, rule);
+    upg_rewrite_paths_insert(upg_rewrite_engine_paths_for(self, host), rule, index);
+    return (gint)index;
+}
+
+/**
+ * upg_rewrite_engine_get_n_rules:
+ * @self: The engine.
+ *
+ * Gets how many rules have been added to @self.
+ *
+ * Returns: The number of rules.
+ */
+guint upg_rewrite_engine_get_n_rules(UpgRewriteEngine* self)
+{
+    g_return_val_if_fail(UPG_IS_REWRITE_ENGINE(self), 0);
+
+    return self->rules->len;
+}
+
+static gboolean upg_rewrite_rule_glob_match(const UpgRewriteRule* rule, const UpgSlice* segments, gsize n)
+{
+    if (rule->rest ? n < rule->n_segments : n != rule->n_segments) {
+        return FALSE;
+    }
+
+    for (gsize i = 0; i < rule->n_segments; i++) {
+        if (!upg_glob_match(rule->segments[i], segments[i].data, segments[i].len)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void upg_rewrite_paths_match(const UpgRewritePaths* paths, GPtrArray* rules, const UpgSlice* segments, gsize n, guint* best)
+{
+    if (paths == NULL) {
+        return;
+    }
+
+    const UpgRewritePathNode* node = paths->root;
+    *best = MIN(*best, node->prefix);
+
+    gsize i = 0;
+    for (; i < n && node->children != NULL; i++) {
+        const UpgRewritePathNode* child = g_hash_table_lookup(node->children, &segments[i]);
+        if (child == NULL) {
+            break;
+        }
+        node = child;
+        *best = MIN(*best, node->prefix);
+    }
+
+    if (i == n) {
+        *best = MIN(*best, node->exact);
+    }
+
+    for (guint g = 0; g < paths->globs->len; g++) {
+        guint index = g_array_index(paths->globs, guint, g);
+        if (index >= *best) {
+            break;
+        }
+        if (upg_rewrite_rule_glob_match(g_ptr_array_index(rules, index), segments, n)) {
+            *best = index;
+            break;
+        }
+    }
+}
+
+static guint upg_rewrite_engine_find(UpgRewriteEngine* self, UpgUri* uri)
+{
+    static const UpgSlice root = { "", 0 };
+
+    gsize n = 0;
+    const UpgSlice* segments = upg_uri_get_path_segments(uri, &n);
+    if (n == 0) {
+        segments = &root;
+        n = 1;
+    }
+
+    guint best = UPG_REWRITE_NONE;
+    upg_rewrite_paths_match(self->any_host, self->rules, segments, n, &best);
+
+    const UriUriA* internal = upg_uri_get_internal(uri);
+    const gchar* first = internal->hostText.first;
+    const gchar* end = internal->hostText.afterLast;
+    if (first == NULL) {
+        return best;
+    }
+    if (end > first && end[-1] == '.') {
+        end--;
+    }
+
+    // walk down from the top-level domain; every node on the way can have
+    // wildcard rules for the hosts under it
+    const UpgRewriteHostNode* node = self->hosts;
+    while (node->children != NULL) {
+        const gchar* label = end;
+        while (label > first && label[-1] != '.') {
+            label--;
+        }
+
+        UpgSlice key = { label, end - label };
+        node = g_hash_table_lookup(node->children, &key);
+        if (node == NULL) {
+            break;
+        }
+
+        if (label == first) {
+            upg_rewrite_paths_match(node->exact, self->rules, segments, n, &best);
+            break;
+        }
+
+        upg_rewrite_paths_match(node->wildcard, self->rules, segments, n, &best);
+        end = label - 1;
+    }
+
+    return best;
+}
+
+/**
+ * upg_rewrite_engine_match:
+ * @self: The engine to use.
+ * @uri: (transfer none) (not nullable): The URI to match.
+ *
+ * Finds the rule that upg_rewrite_engine_apply() would use for @uri, without
+ * changing @uri or counting a hit.
+ *
+ * Returns: The number of the first rule that matches @uri, or -1 if none do.
+ */
+gint upg_rewrite_engine_match(UpgRewriteEngine* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_REWRITE_ENGINE(self), -1);
+    g_return_val_if_fail(UPG_IS_URI(uri), -1);
+
+    guint index = upg_rewrite_engine_find(self, uri);
+    return index == UPG_REWRITE_NONE ? -1 : (gint)index;
+}
+
+/**
+ * upg_rewrite_engine_apply:
+ * @self: The engine to use.
+ * @uri: (transfer none) (not nullable): The URI to rewrite.
+ *
+ * Rewrites @uri with the first rule in @self that matches it, if any, and
+ * counts a hit for that rule.
+ *
+ * Returns: The number of the rule that was used, or -1 if none match, in
+ * which case @uri isn't changed.
+ */
+gint upg_rewrite_engine_apply(UpgRewriteEngine* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_REWRITE_ENGINE(self), -1);
+    g_return_val_if_fail(UPG_IS_URI(uri), -1);
+
+    guint index = upg_rewrite_engine_find(self, uri);
+    if (index == UPG_REWRITE_NONE) {
+        return -1;
+    }
+
+    UpgRewriteRule* rule = g_ptr_array_index(self->rules, index);
+    // GLib has no 64-bit atomics, but a 32-bit count would wrap on 32-bit
+    // platforms, which a busy proxy can manage
+    __atomic_fetch_add(&rule->hits, 1, __ATOMIC_RELAXED);
+
+    // the rest of the path points into @uri, so it's copied before the path
+    // is replaced
+    GList* path = NULL;
+    if (rule->path != NULL) {
+        gsize n = 0;
+        const UpgSlice* segments = upg_uri_get_path_segments(uri, &n);
+        gsize rest_at = rule->rest ? rule->n_segments : n;
+        gsize n_target = g_strv_length(rule->path);
+
+        for (gsize i = 0; i < n_target; i++) {
+            // "/new/" and a rest of "a" make "/new/a", not "/new//a"
+            if (i == n_target - 1 && rest_at < n && rule->path[i][0] == '\0') {
+                break;
+            }
+            path = g_list_prepend(path, g_strdup(rule->path[i]));
+        }
+        for (gsize i = rest_at; i < n; i++) {
+            path = g_list_prepend(path, g_strndup(segments[i].data, segments[i].len));
+        }
+        path = g_list_reverse(path);
+    }
+
+    g_object_freeze_notify(G_OBJECT(uri));
+
+    if (rule->scheme != NULL) {
+        upg_uri_set_scheme(uri, rule->scheme);
+    }
+    if (rule->has_authority) {
+        upg_uri_set_userinfo(uri, rule->userinfo);
+        upg_uri_set_host(uri, rule->host);
+        upg_uri_set_port(uri, rule->port);
+    }
+    if (rule->path != NULL) {
+        upg_uri_set_path(uri, path);
+        g_list_free_full(path, g_free);
+    }
+    if (rule->query != NULL) {
+        upg_uri_set_query_str(uri, rule->query);
+    }
+    if (rule->fragment != NULL) {
+        upg_uri_set_fragment(uri, rule->fragment);
+    }
+
+    g_object_thaw_notify(G_OBJECT(uri));
+    return (gint)index;
+}
+
+/**
+ * upg_rewrite_engine_get_hits:
+ * @self: The engine.
+ * @rule: The number of a rule in @self.
+ *
+ * Gets how many times @rule has been applied by upg_rewrite_engine_apply().
+ *
+ * Returns: The number of hits.
+ */
+guint64 upg_rewrite_engine_get_hits(UpgRewriteEngine* self, guint rule)
+{
+    g_return_val_if_fail(UPG_IS_REWRITE_ENGINE(self), 0);
+    g_return_val_if_fail(rule < self->rules->len, 0);
+
+    UpgRewriteRule* data = g_ptr_array_index(self->rules, rule);
+    return __atomic_load_n(&data->hits, __ATOMIC_RELAXED);
+}
+
+/**
+ * upg_rewrite_engine_reset_hits:
+ * @self: The engine.
+ *
+ * Sets the hit count of every rule in @self back to 0.
+ */
+void upg_rewrite_engine_reset_hits(UpgRewriteEngine* self)
+{
+    g_return_if_fail(UPG_IS_REWRITE_ENGINE(self));
+
+    for (guint i = 0; i < self->rules->len; i++) {
+        UpgRewriteRule* rule = g_ptr_array_index(self->rules, i);
+        __atomic_store_n(&rule->hits, 0, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,47 @@
+/* upgrewrite.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGREWRITE_H
+#define UPGREWRITE_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+#define UPG_TYPE_REWRITE_ENGINE upg_rewrite_engine_get_type()
+G_DECLARE_FINAL_TYPE(UpgRewriteEngine, upg_rewrite_engine, UPG, REWRITE_ENGINE, GObject)
+
+UpgRewriteEngine* upg_rewrite_engine_new(void);
+gint upg_rewrite_engine_add_rule(UpgRewriteEngine* self, const gchar* host, const gchar* path, const gchar* target, GError** error);
+guint upg_rewrite_engine_get_n_rules(UpgRewriteEngine* self);
+gint upg_rewrite_engine_match(UpgRewriteEngine* self, UpgUri* uri);
+gint upg_rewrite_engine_apply(UpgRewriteEngine* self, UpgUri* uri);
+guint64 upg_rewrite_engine_get_hits(UpgRewriteEngine* self, guint rule);
+void upg_rewrite_engine_reset_hits(UpgRewriteEngine* self);
+
+G_END_DECLS
+
+#endif
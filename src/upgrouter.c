@@ -0,0 +1,433 @@
+/* upgrouter.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgrouter.h"
+#include "upgerror.h"
+#include "upgparams.h"
+#include <string.h>
+
+/**
+ * SECTION:upgrouter
+ * @short_description: Matching paths against templates
+ * @include: liburiparser-gobject.h
+ * @title: UpgRouter
+ *
+ * #UpgRouter matches the path of a URI against a set of templates, like
+ * `/users/{id}/posts/{post}`, each with a value, and gives back the value of
+ * the one that matches along with what its variables matched. It's meant for
+ * routing requests in an HTTP server, but it doesn't know about methods; keep
+ * a router for each method, or put something that handles every method in
+ * the values.
+ *
+ * A template starts with a `/`, and each of its segments is one of:
+ *
+ * - text, like `users`, which matches a segment that's exactly the same;
+ * - a variable, like `{id}`, which matches any segment that isn't empty;
+ * - `*`, only at the end, which matches the rest of the path, even if there's
+ *   nothing left.
+ *
+ * Templates are matched against the path segments from
+ * upg_uri_get_path_segments(), so `/users/5` and `/users/5/` are different
+ * paths, and a URI without a path is matched as if its path was `/`.
+ *
+ * The templates are put together into a trie of segments, where each node
+ * can have children for text, one for a variable and one for `*`, so a
+ * lookup only depends on how many segments are in the path, not how many
+ * templates there are. Nothing is allocated during a lookup; the
+ * #UpgRouteMatch is filled in with slices of the URI.
+ *
+ * When more than one template matches, the one with the highest priority
+ * wins. If they have the same priority, the more specific one wins: going
+ * from the start of the path, the first segment where they differ is
+ * compared, and text beats a variable, which beats `*`. Adding the same
+ * template twice (even with different variable names) replaces the first.
+ */
+
+typedef struct {
+    gpointer value;
+    gint priority;
+    gchar** names;
+    guint n_names;
+} UpgRouterRoute;
+
+typedef struct _UpgRouterNode UpgRouterNode;
+struct _UpgRouterNode {
+    GHashTable* texts;
+    UpgRouterNode* variable;
+    UpgRouterRoute* route;
+    UpgRouterRoute* wildcard;
+    gint max_priority;
+};
+
+struct _UpgRouter {
+    GObject parent_instance;
+
+    UpgRouterNode* root;
+    GDestroyNotify value_destroy;
+    guint size;
+};
+
+G_DEFINE_TYPE(UpgRouter, upg_router, G_TYPE_OBJECT)
+
+static UpgRouterNode* upg_router_node_new(void)
+{
+    UpgRouterNode* node = g_new0(UpgRouterNode, 1);
+    node->max_priority = G_MININT;
+    return node;
+}
+
+static void upg_router_route_free(UpgRouterRoute* route, GDestroyNotify value_destroy)
+{
+    if (route == NULL) {
+        return;
+    }
+
+    if (value_destroy != NULL) {
+        value_destroy(route->value);
+    }
+    g_strfreev(route->names);
+    g_free(route);
+}
+
+static void upg_router_node_free(UpgRouterNode* node, GDestroyNotify value_destroy)
+{
+    if (node->texts != NULL) {
+        GHashTableIter iter;
+        gpointer child;
+        g_hash_table_iter_init(&iter, node->texts);
+        while (g_hash_table_iter_next(&iter, NULL, &child)) {
+            upg_router_node_free(child, value_destroy);
+        }
+        g_hash_table_unref(node->texts);
+    }
+
+    if (node->variable != NULL) {
+        upg_router_node_free(node->variable, value_destroy);
+    }
+
+    upg_router_route_free(node->route, value_destroy);
+    upg_router_route_free(node->wildcard, value_destroy);
+    g_free(node);
+}
+
+static void upg_router_finalize(GObject* obj)
+{
+    UpgRouter* self = UPG_ROUTER(obj);
+
+    upg_router_node_free(self->root, self->value_destroy);
+
+    G_OBJECT_CLASS(upg_router_parent_class)->finalize(obj);
+}
+
+static void upg_router_class_init(UpgRouterClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_router_finalize;
+}
+
+static void upg_router_init(UpgRouter* self)
+{
+    self->root = upg_router_node_new();
+}
+
+/**
+ * upg_router_new:
+ * @value_destroy: (nullable): A function to free values with, or %NULL.
+ *
+ * Creates a new #UpgRouter without any routes.
+ *
+ * Returns: (transfer full): a new #UpgRouter.
+ */
+UpgRouter* upg_router_new(GDestroyNotify value_destroy)
+{
+    UpgRouter* self = g_object_new(UPG_TYPE_ROUTER, NULL);
+    self->value_destroy = value_destroy;
+    return self;
+}
+
+static gboolean upg_router_is_variable(const gchar* segment, gsize len)
+{
+    return len >= 3 && segment[0] == '{' && segment[len - 1] == '}';
+}
+
+/**
+ * upg_router_add:
+ * @self: The router to add to.
+ * @path_template: (not nullable): The template to match paths against; see
+ *                 the section description.
+ * @priority: The priority of the route; higher numbers win.
+ * @value: (nullable): The value to give back when the route matches.
+ * @error: A #GError.
+ *
+ * Adds a route to @self. If the template is already there, its route is
+ * replaced.
+ *
+ * Returns: Whether the route was added; if @path_template isn't valid, it
+ * isn't, and @error is set. @value isn't freed then.
+ */
+gboolean upg_router_add(UpgRouter* self, const gchar* path_template, gint priority, gpointer value, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_ROUTER(self), FALSE);
+    g_return_val_if_fail(path_template != NULL, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    if (*path_template != '/') {
+        g_set_error(error, UPG_ERROR, UPG_ERR_PARSE, "Route templates must start with a slash: %s", path_template);
+        return FALSE;
+    }
+
+    // a template of "/" has a single empty segment, just like in a URI
+    gchar** segments;
+    if (path_template[1] != '\0') {
+        segments = g_strsplit(path_template + 1, "/", -1);
+    } else {
+        segments = g_new0(gchar*, 2);
+        segments[0] = g_strdup("");
+    }
+
+    guint n_segments = g_strv_length(segments);
+    gboolean wildcard = strcmp(segments[n_segments - 1], "*") == 0;
+    if (wildcard) {
+        n_segments--;
+    }
+
+    // check everything before changing the trie, so a bad template leaves it
+    // as it was
+    gchar* names[UPG_ROUTER_MAX_VARIABLES + 1] = { NULL };
+    guint n_names = 0;
+    const gchar* problem = NULL;
+    for (guint i = 0; i < n_segments && problem == NULL; i++) {
+        const gchar* segment = segments[i];
+        gsize len = strlen(segment);
+
+        if (strcmp(segment, "*") == 0) {
+            problem = "* can only be at the end";
+            continue;
+        }
+
+        if (!upg_router_is_variable(segment, len)) {
+            continue;
+        }
+
+        if (memchr(segment + 1, '{', len - 2) != NULL || memchr(segment + 1, '}', len - 2) != NULL) {
+            problem = "Variable names can't have braces";
+            continue;
+        }
+
+        for (guint j = 0; j < n_names; j++) {
+            if (strlen(names[j]) == len - 2 && strncmp(names[j], segment + 1, len - 2) == 0) {
+                problem = "Variable names must be unique";
+            }
+        }
+
+        if (n_names == UPG_ROUTER_MAX_VARIABLES) {
+            problem = "Too many variables";
+        } else if (problem == NULL) {
+            names[n_names++] = g_strndup(segment + 1, len - 2);
+        }
+    }
+
+    if (problem != NULL) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_PARSE, "%s in route template %s", problem, path_template);
+        for (guint i = 0; i < n_names; i++) {
+            g_free(names[i]);
+        }
+        g_strfreev(segments);
+        return FALSE;
+    }
+
+    UpgRouterNode* node = self->root;
+    node->max_priority = MAX(node->max_priority, priority);
+    for (guint i = 0; i < n_segments; i++) {
+        const gchar* segment = segments[i];
+        gsize len = strlen(segment);
+        UpgRouterNode* child;
+
+        if (upg_router_is_variable(segment, len)) {
+            if (node->variable == NULL) {
+                node->variable = upg_router_node_new();
+            }
+            child = node->variable;
+        } else {
+            if (node->texts == NULL) {
+                node->texts = g_hash_table_new_full(upg_slice_hash, upg_slice_equal, g_free, NULL);
+            }
+
+            UpgSlice key = { segment, len };
+            child = g_hash_table_lookup(node->texts, &key);
+            if (child == NULL) {
+                child = upg_router_node_new();
+                g_hash_table_insert(node->texts, upg_slice_dup(segment, len), child);
+            }
+        }
+
+        node = child;
+        node->max_priority = MAX(node->max_priority, priority);
+    }
+    g_strfreev(segments);
+
+    UpgRouterRoute* route = g_new0(UpgRouterRoute, 1);
+    route->value = value;
+    route->priority = priority;
+    route->names = g_new0(gchar*, n_names + 1);
+    memcpy(route->names, names, n_names * sizeof(gchar*));
+    route->n_names = n_names;
+
+    UpgRouterRoute** slot = wildcard ? &node->wildcard : &node->route;
+    if (*slot != NULL) {
+        upg_router_route_free(*slot, self->value_destroy);
+    } else {
+        self->size++;
+    }
+    *slot = route;
+
+    return TRUE;
+}
+
+/**
+ * upg_router_get_size:
+ * @self: The router.
+ *
+ * Gets how many routes are in @self.
+ *
+ * Returns: The number of routes.
+ */
+guint upg_router_get_size(UpgRouter* self)
+{
+    g_return_val_if_fail(UPG_IS_ROUTER(self), 0);
+
+    return self->size;
+}
+
+typedef struct {
+    const UpgSlice* segments;
+    gsize n_segments;
+    UpgSlice captures[UPG_ROUTER_MAX_VARIABLES];
+    UpgRouteMatch* best;
+    gboolean found;
+} UpgRouterSearch;
+
+static void upg_router_consider(UpgRouterSearch* search, const UpgRouterRoute* route, gsize rest_at)
+{
+    // the search goes from the most specific to the least, so only a higher
+    // priority can take over
+    if (route == NULL || (search->found && route->priority <= search->best->priority)) {
+        return;
+    }
+
+    UpgRouteMatch* best = search->best;
+    best->value = route->value;
+    best->priority = route->priority;
+    best->n_variables = route->n_names;
+    best->names = (const gchar* const*)route->names;
+    memcpy(best->variables, search->captures, route->n_names * sizeof(UpgSlice));
+    best->rest = rest_at < search->n_segments ? &search->segments[rest_at] : NULL;
+    best->n_rest = search->n_segments - rest_at;
+    search->found = TRUE;
+}
+
+static void upg_router_search(UpgRouterSearch* search, const UpgRouterNode* node, gsize i, guint n_captures)
+{
+    if (search->found && node->max_priority <= search->best->priority) {
+        return;
+    }
+
+    if (i == search->n_segments) {
+        upg_router_consider(search, node->route, i);
+    } else {
+        const UpgSlice* segment = &search->segments[i];
+
+        if (node->texts != NULL) {
+            const UpgRouterNode* child = g_hash_table_lookup(node->texts, segment);
+            if (child != NULL) {
+                upg_router_search(search, child, i + 1, n_captures);
+            }
+        }
+
+        if (node->variable != NULL && segment->len > 0) {
+            search->captures[n_captures] = *segment;
+            upg_router_search(search, node->variable, i + 1, n_captures + 1);
+        }
+    }
+
+    upg_router_consider(search, node->wildcard, i);
+}
+
+/**
+ * upg_router_lookup:
+ * @self: The router to use.
+ * @uri: (transfer none) (not nullable): The URI to route.
+ * @match: (out caller-allocates) (optional): Where to put what matched.
+ *
+ * Finds the route in @self that best matches the path of @uri.
+ *
+ * Returns: Whether any route matched; if not, @match isn't changed.
+ */
+gboolean upg_router_lookup(UpgRouter* self, UpgUri* uri, UpgRouteMatch* match)
+{
+    static const UpgSlice root = { "", 0 };
+
+    g_return_val_if_fail(UPG_IS_ROUTER(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+
+    UpgRouteMatch scratch;
+    UpgRouterSearch search;
+    search.segments = upg_uri_get_path_segments(uri, &search.n_segments);
+    if (search.n_segments == 0) {
+        search.segments = &root;
+        search.n_segments = 1;
+    }
+    search.best = &scratch;
+    search.found = FALSE;
+
+    upg_router_search(&search, self->root, 0, 0);
+
+    if (search.found && match != NULL) {
+        *match = scratch;
+    }
+    return search.found;
+}
+
+/**
+ * upg_route_match_get:
+ * @match: (not nullable): What upg_router_lookup() found.
+ * @name: (not nullable): The name of a variable in the route's template.
+ * @value: (out) (optional): Where to put the segment that it matched.
+ *
+ * Looks up a variable in @match by its name.
+ *
+ * Returns: Whether the route has a variable called @name.
+ */
+gboolean upg_route_match_get(const UpgRouteMatch* match, const gchar* name, UpgSlice* value)
+{
+    g_return_val_if_fail(match != NULL, FALSE);
+    g_return_val_if_fail(name != NULL, FALSE);
+
+    for (guint i = 0; i < match->n_variables; i++) {
+        if (strcmp(match->names[i], name) == 0) {
+            if (value != NULL) {
+                *value = match->variables[i];
+            }
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
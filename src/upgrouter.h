@@ -0,0 +1,79 @@
+/* upgrouter.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGROUTER_H
+#define UPGROUTER_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+/**
+ * UPG_ROUTER_MAX_VARIABLES:
+ *
+ * The most variables a template for #UpgRouter can have.
+ */
+#define UPG_ROUTER_MAX_VARIABLES 16
+
+/**
+ * UpgRouteMatch:
+ * @value: The value of the route that matched.
+ * @priority: The priority of the route that matched.
+ * @n_variables: The number of variables in the route.
+ * @names: (array length=n_variables): The names of the variables, in the order
+ *         they're in the template. They belong to the router.
+ * @variables: (array length=n_variables): The path segments that each
+ *             variable matched.
+ * @rest: (array length=n_rest) (nullable): The path segments that a `*` at
+ *        the end of the template matched, if it has one.
+ * @n_rest: The number of segments in @rest.
+ *
+ * What upg_router_lookup() found. The slices point into the URI that was
+ * looked up, and are only valid until it's changed; they aren't
+ * percent-decoded, so use upg_slice_unescape() if you need that.
+ */
+typedef struct {
+    gpointer value;
+    gint priority;
+    guint n_variables;
+    const gchar* const* names;
+    UpgSlice variables[UPG_ROUTER_MAX_VARIABLES];
+    const UpgSlice* rest;
+    gsize n_rest;
+} UpgRouteMatch;
+
+#define UPG_TYPE_ROUTER upg_router_get_type()
+G_DECLARE_FINAL_TYPE(UpgRouter, upg_router, UPG, ROUTER, GObject)
+
+UpgRouter* upg_router_new(GDestroyNotify value_destroy);
+gboolean upg_router_add(UpgRouter* self, const gchar* path_template, gint priority, gpointer value, GError** error);
+guint upg_router_get_size(UpgRouter* self);
+gboolean upg_router_lookup(UpgRouter* self, UpgUri* uri, UpgRouteMatch* match);
+gboolean upg_route_match_get(const UpgRouteMatch* match, const gchar* name, UpgSlice* value);
+
+G_END_DECLS
+
+#endif
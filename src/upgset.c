@@ -0,0 +1,418 @@
+/* upgset.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgset.h"
+#include "upgparser.h"
+#include <string.h>
+
+/**
+ * SECTION:upgset
+ * @short_description: A compact set of URIs
+ * @include: liburiparser-gobject.h
+ * @title: UpgUriSet
+ *
+ * #UpgUriSet keeps track of which URIs have been seen, like a #GHashTable
+ * using upg_uri_hash() and upg_uri_equal() would, but without keeping a
+ * #UpgUri around for each one. It's meant for large sets, like the frontier of
+ * a web crawler.
+ *
+ * Every URI is kept as text, one after another in a single growing buffer,
+ * and the table itself is a flat array that remembers the hash and location of
+ * each; looking a URI up only compares text when the hashes are the same.
+ * Nothing can be removed from a set.
+ *
+ * Every URI is kept in its normalized form, the one upg_uri_new() and
+ * upg_uri_to_string() would give, so `HTTP://Example.com/%7euser` and
+ * `http://example.com/~user` are the same URI whether they're given as text
+ * or as a #UpgUri, and even if a #UpgUri was changed with its setters. The
+ * URIs are parsed with a #UpgUriParser that belongs to the set, so this
+ * doesn't allocate once the set has seen a few URIs. Text that isn't a valid
+ * URI is kept as it is.
+ */
+
+typedef struct {
+    guint64 hash; /* 0 if the slot is empty */
+    gsize offset;
+    gsize len;
+} UpgSetSlot;
+
+struct _UpgUriSet {
+    GObject parent_instance;
+
+    UpgSetSlot* slots;
+    gsize n_slots;
+    gsize size;
+    gchar* keys;
+    gsize keys_len;
+    gsize keys_capacity;
+    UpgUriParser* parser;
+    GString* text;
+    GString* key;
+};
+
+G_DEFINE_TYPE(UpgUriSet, upg_uri_set, G_TYPE_OBJECT)
+
+static void upg_uri_set_finalize(GObject* obj)
+{
+    UpgUriSet* self = UPG_URI_SET(obj);
+
+    g_free(self->slots);
+    g_free(self->keys);
+    g_object_unref(self->parser);
+    g_string_free(self->text, TRUE);
+    g_string_free(self->key, TRUE);
+
+    G_OBJECT_CLASS(upg_uri_set_parent_class)->finalize(obj);
+}
+
+static void upg_uri_set_class_init(UpgUriSetClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_uri_set_finalize;
+}
+
+static void upg_uri_set_init(UpgUriSet* self)
+{
+    self->parser = upg_uri_parser_new();
+    self->text = g_string_new(NULL);
+    self->key = g_string_new(NULL);
+}
+
+/**
+ * upg_uri_set_new:
+ * @expected_size: How many URIs the set is expected to hold, or 0 if you don't
+ *                 know.
+ *
+ * Creates a new, empty #UpgUriSet, with room for @expected_size URIs before it
+ * has to grow.
+ *
+ * Returns: (transfer full): a new #UpgUriSet.
+ */
+UpgUriSet* upg_uri_set_new(gsize expected_size)
+{
+    UpgUriSet* self = g_object_new(UPG_TYPE_URI_SET, NULL);
+
+    // keep the table at most three quarters full
+    self->n_slots = 16;
+    while (self->n_slots / 4 * 3 < expected_size) {
+        self->n_slots *= 2;
+    }
+    self->slots = g_new0(UpgSetSlot, self->n_slots);
+
+    return self;
+}
+
+static guint64 upg_uri_set_hash(const gchar* uri, gsize len)
+{
+    guint64 hash = upg_hash_bytes(uri, len);
+    return hash != 0 ? hash : 1;
+}
+
+/*
+ * upg_uri_set_normalize:
+ * @self: The set.
+ * @uri: The URI, as text.
+ * @len: The length of @uri.
+ *
+ * Puts the normalized form of @uri into the key string of @self, or @uri
+ * itself if it doesn't parse.
+ *
+ * Returns: (transfer none): The key string of @self.
+ */
+static GString* upg_uri_set_normalize(UpgUriSet* self, const gchar* uri, gsize len)
+{
+    g_string_truncate(self->key, 0);
+
+    UpgUri* parsed = upg_uri_parser_parse(self->parser, uri, len, NULL);
+    if (parsed != NULL) {
+        upg_uri_append_to_gstring(parsed, self->key);
+    } else {
+        g_string_append_len(self->key, uri, len);
+    }
+
+    return self->key;
+}
+
+/*
+ * upg_uri_set_normalize_uri:
+ * @self: The set.
+ * @uri: The URI.
+ *
+ * Like upg_uri_set_normalize(), but for a #UpgUri, which might not be
+ * normalized if it was changed after it was parsed.
+ *
+ * Returns: (transfer none): The key string of @self.
+ */
+static GString* upg_uri_set_normalize_uri(UpgUriSet* self, UpgUri* uri)
+{
+    g_string_truncate(self->text, 0);
+    upg_uri_append_to_gstring(uri, self->text);
+    return upg_uri_set_normalize(self, self->text->str, self->text->len);
+}
+
+/*
+ * upg_uri_set_find:
+ * @self: The set to look in.
+ * @hash: The hash of @uri, from upg_uri_set_hash().
+ * @uri: The URI to look for.
+ * @len: The length of @uri.
+ *
+ * Finds the slot that has @uri in it, or the empty slot that it would go in.
+ *
+ * Returns: (transfer none): The slot.
+ */
+static UpgSetSlot* upg_uri_set_find(UpgUriSet* self, guint64 hash, const gchar* uri, gsize len)
+{
+    gsize mask = self->n_slots - 1;
+    for (gsize i = hash & mask;; i = (i + 1) & mask) {
+        UpgSetSlot* slot = &self->slots[i];
+        if (slot->hash == 0) {
+            return slot;
+        }
+
+        if (slot->hash == hash && slot->len == len && memcmp(self->keys + slot->offset, uri, len) == 0) {
+            return slot;
+        }
+    }
+}
+
+static void upg_uri_set_grow(UpgUriSet* self)
+{
+    UpgSetSlot* old = self->slots;
+    gsize old_n_slots = self->n_slots;
+
+    self->n_slots *= 2;
+    self->slots = g_new0(UpgSetSlot, self->n_slots);
+
+    // the hashes are stored, so there's no need to look at the text again
+    gsize mask = self->n_slots - 1;
+    for (gsize i = 0; i < old_n_slots; i++) {
+        if (old[i].hash == 0) {
+            continue;
+        }
+
+        gsize j = old[i].hash & mask;
+        while (self->slots[j].hash != 0) {
+            j = (j + 1) & mask;
+        }
+        self->slots[j] = old[i];
+    }
+
+    g_free(old);
+}
+
+static gboolean upg_uri_set_add_hashed(UpgUriSet* self, guint64 hash, const gchar* uri, gsize len)
+{
+    UpgSetSlot* slot = upg_uri_set_find(self, hash, uri, len);
+    if (slot->hash != 0) {
+        return FALSE;
+    }
+
+    if (self->keys_len + len + 1 > self->keys_capacity) {
+        self->keys_capacity = MAX(self->keys_capacity * 2, self->keys_len + len + 1);
+        self->keys_capacity = MAX(self->keys_capacity, 4096);
+        self->keys = g_realloc(self->keys, self->keys_capacity);
+    }
+
+    *slot = (UpgSetSlot) { hash, self->keys_len, len };
+    memcpy(self->keys + self->keys_len, uri, len);
+    self->keys[self->keys_len + len] = '\0';
+    self->keys_len += len + 1;
+
+    if (++self->size > self->n_slots / 4 * 3) {
+        upg_uri_set_grow(self);
+    }
+
+    return TRUE;
+}
+
+/**
+ * upg_uri_set_add_string:
+ * @self: The set to add to.
+ * @uri: (array length=len) (element-type guint8): The URI to add, as text.
+ * @len: The length of @uri, or -1 if it's nul-terminated.
+ *
+ * Adds @uri to @self, if it isn't already there. @uri can't have a nul byte in
+ * it, which a valid URI can't anyway. It's normalized first, so it's the same
+ * as the #UpgUri that upg_uri_new() would make from it.
+ *
+ * Returns: %TRUE if @uri was added, and %FALSE if it was already there.
+ */
+gboolean upg_uri_set_add_string(UpgUriSet* self, const gchar* uri, gssize len)
+{
+    g_return_val_if_fail(UPG_IS_URI_SET(self), FALSE);
+    g_return_val_if_fail(uri != NULL, FALSE);
+
+    gsize ulen = len < 0 ? strlen(uri) : (gsize)len;
+    g_return_val_if_fail(len < 0 || memchr(uri, '\0', ulen) == NULL, FALSE);
+
+    GString* key = upg_uri_set_normalize(self, uri, ulen);
+    return upg_uri_set_add_hashed(self, upg_uri_set_hash(key->str, key->len), key->str, key->len);
+}
+
+/**
+ * upg_uri_set_add:
+ * @self: The set to add to.
+ * @uri: (transfer none) (not nullable): The URI to add.
+ *
+ * Adds @uri to @self, if it isn't already there. @uri isn't kept; only its
+ * normalized text is.
+ *
+ * Returns: %TRUE if @uri was added, and %FALSE if it was already there.
+ */
+gboolean upg_uri_set_add(UpgUriSet* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_URI_SET(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+
+    GString* key = upg_uri_set_normalize_uri(self, uri);
+    return upg_uri_set_add_hashed(self, upg_uri_set_hash(key->str, key->len), key->str, key->len);
+}
+
+/**
+ * upg_uri_set_contains_string:
+ * @self: The set to look in.
+ * @uri: (array length=len) (element-type guint8): The URI to look for, as
+ *       text.
+ * @len: The length of @uri, or -1 if it's nul-terminated.
+ *
+ * Checks if @uri, once it's normalized, is in @self.
+ *
+ * Returns: Whether @uri is in @self.
+ */
+gboolean upg_uri_set_contains_string(UpgUriSet* self, const gchar* uri, gssize len)
+{
+    g_return_val_if_fail(UPG_IS_URI_SET(self), FALSE);
+    g_return_val_if_fail(uri != NULL, FALSE);
+
+    gsize ulen = len < 0 ? strlen(uri) : (gsize)len;
+    GString* key = upg_uri_set_normalize(self, uri, ulen);
+    return upg_uri_set_find(self, upg_uri_set_hash(key->str, key->len), key->str, key->len)->hash != 0;
+}
+
+/**
+ * upg_uri_set_contains:
+ * @self: The set to look in.
+ * @uri: (transfer none) (not nullable): The URI to look for.
+ *
+ * Checks if @uri is in @self.
+ *
+ * Returns: Whether @uri is in @self.
+ */
+gboolean upg_uri_set_contains(UpgUriSet* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_URI_SET(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+
+    GString* key = upg_uri_set_normalize_uri(self, uri);
+    return upg_uri_set_find(self, upg_uri_set_hash(key->str, key->len), key->str, key->len)->hash != 0;
+}
+
+/**
+ * upg_uri_set_union:
+ * @self: The set to add to.
+ * @other: (transfer none) (not nullable): The set to add from.
+ *
+ * Adds every URI in @other to @self. The hashes @other has already worked out
+ * are reused.
+ */
+void upg_uri_set_union(UpgUriSet* self, UpgUriSet* other)
+{
+    g_return_if_fail(UPG_IS_URI_SET(self));
+    g_return_if_fail(UPG_IS_URI_SET(other));
+
+    if (self == other) {
+        return;
+    }
+
+    for (gsize i = 0; i < other->n_slots; i++) {
+        const UpgSetSlot* slot = &other->slots[i];
+        if (slot->hash != 0) {
+            upg_uri_set_add_hashed(self, slot->hash, other->keys + slot->offset, slot->len);
+        }
+    }
+}
+
+/**
+ * upg_uri_set_get_size:
+ * @self: The set.
+ *
+ * Gets the number of URIs in @self.
+ *
+ * Returns: The number of URIs in @self.
+ */
+gsize upg_uri_set_get_size(UpgUriSet* self)
+{
+    g_return_val_if_fail(UPG_IS_URI_SET(self), 0);
+
+    return self->size;
+}
+
+/**
+ * upg_uri_set_iter_init:
+ * @iter: (out caller-allocates): The iterator to set up.
+ * @set: (transfer none) (not nullable): The set to iterate over.
+ *
+ * Sets up @iter to go through every URI in @set, in the order they were
+ * added. Adding to @set while iterating is fine; the new URIs will come up
+ * too.
+ */
+void upg_uri_set_iter_init(UpgUriSetIter* iter, UpgUriSet* set)
+{
+    g_return_if_fail(iter != NULL);
+    g_return_if_fail(UPG_IS_URI_SET(set));
+
+    iter->set = set;
+    iter->offset = 0;
+}
+
+/**
+ * upg_uri_set_iter_next:
+ * @iter: The iterator.
+ * @uri: (out) (optional) (transfer none): Where to put the next URI.
+ * @len: (out) (optional): Where to put the length of the next URI.
+ *
+ * Moves @iter on to the next URI. The URI is nul-terminated, and belongs to
+ * the set; it's only valid until something is added to the set.
+ *
+ * Returns: %FALSE if there are no more URIs.
+ */
+gboolean upg_uri_set_iter_next(UpgUriSetIter* iter, const gchar** uri, gsize* len)
+{
+    g_return_val_if_fail(iter != NULL, FALSE);
+
+    UpgUriSet* set = iter->set;
+    if (iter->offset >= set->keys_len) {
+        return FALSE;
+    }
+
+    const gchar* current = set->keys + iter->offset;
+    gsize current_len = strlen(current);
+    iter->offset += current_len + 1;
+
+    if (uri != NULL) {
+        *uri = current;
+    }
+    if (len != NULL) {
+        *len = current_len;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,61 @@
+/* upgset.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGSET_H
+#define UPGSET_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+#define UPG_TYPE_URI_SET upg_uri_set_get_type()
+G_DECLARE_FINAL_TYPE(UpgUriSet, upg_uri_set, UPG, URI_SET, GObject)
+
+/**
+ * UpgUriSetIter:
+ *
+ * An iterator over a #UpgUriSet. Its fields are private; set it up with
+ * upg_uri_set_iter_init().
+ */
+typedef struct {
+    /*< private >*/
+    UpgUriSet* set;
+    gsize offset;
+} UpgUriSetIter;
+
+UpgUriSet* upg_uri_set_new(gsize expected_size);
+gboolean upg_uri_set_add(UpgUriSet* self, UpgUri* uri);
+gboolean upg_uri_set_add_string(UpgUriSet* self, const gchar* uri, gssize len);
+gboolean upg_uri_set_contains(UpgUriSet* self, UpgUri* uri);
+gboolean upg_uri_set_contains_string(UpgUriSet* self, const gchar* uri, gssize len);
+void upg_uri_set_union(UpgUriSet* self, UpgUriSet* other);
+gsize upg_uri_set_get_size(UpgUriSet* self);
+void upg_uri_set_iter_init(UpgUriSetIter* iter, UpgUriSet* set);
+gboolean upg_uri_set_iter_next(UpgUriSetIter* iter, const gchar** uri, gsize* len);
+
+G_END_DECLS
+
+#endif
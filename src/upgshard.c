@@ -0,0 +1,83 @@
+/* upgshard.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgshard.h"
+#include <string.h>
+
+/**
+ * SECTION:upgshard
+ * @short_description: Splitting URIs between workers by host
+ * @include: liburiparser-gobject.h
+ * @title: Sharding
+ *
+ * When work is split up between several workers, it's often useful for all of
+ * the URIs on one host to go to the same worker, say so that only one of them
+ * has to worry about how often it's allowed to contact that host.
+ * upg_uri_get_shard() picks a shard for a URI from upg_uri_hash_authority(),
+ * so URIs with the same scheme, host and port always get the same one, on
+ * any machine.
+ *
+ * The shard is picked with a jump consistent hash, which means that when the
+ * number of shards goes from N to N + 1, only about 1 / (N + 1) of the hosts
+ * move, and all of those move to the new shard.
+ */
+
+/**
+ * upg_jump_consistent_hash:
+ * @key: The key to find a bucket for.
+ * @n_buckets: How many buckets there are. Must be more than 0.
+ *
+ * Maps @key onto one of @n_buckets buckets, using the jump consistent hash
+ * from Lamping and Veach. It uses no memory, and gives the same result
+ * everywhere.
+ *
+ * Returns: The bucket for @key, from 0 to @n_buckets - 1.
+ */
+guint32 upg_jump_consistent_hash(guint64 key, guint32 n_buckets)
+{
+    g_return_val_if_fail(n_buckets > 0, 0);
+
+    gint64 bucket = -1;
+    gint64 next = 0;
+    while (next < n_buckets) {
+        bucket = next;
+        key = key * G_GUINT64_CONSTANT(2862933555777941757) + 1;
+        next = (gint64)((bucket + 1) * ((gdouble)(G_GINT64_CONSTANT(1) << 31) / (gdouble)((key >> 33) + 1)));
+    }
+
+    return (guint32)bucket;
+}
+
+/**
+ * upg_uri_get_shard:
+ * @self: The URI to find a shard for.
+ * @n_shards: How many shards there are. Must be more than 0.
+ *
+ * Picks which of @n_shards shards @self belongs to, by its scheme, host and
+ * effective port; see the section description.
+ *
+ * Returns: The shard for @self, from 0 to @n_shards - 1.
+ */
+guint32 upg_uri_get_shard(UpgUri* self, guint32 n_shards)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), 0);
+    g_return_val_if_fail(n_shards > 0, 0);
+
+    return upg_jump_consistent_hash(upg_uri_hash_authority(self), n_shards);
+}
@@ -0,0 +1,195 @@
+/* upgsort.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgsort.h"
+#include <string.h>
+
+/* below this many, sorting by comparison is quicker than another radix pass */
+#define UPG_SORT_SMALL 32
+
+/**
+ * SECTION:upgsort
+ * @short_description: Sorting lots of URIs
+ * @include: liburiparser-gobject.h
+ * @title: Sorting
+ *
+ * upg_uri_sort() puts an array of URIs in the same order as upg_uri_compare()
+ * would, but much faster when there are a lot of them.
+ *
+ * Each URI is written out once as a key that sorts correctly byte by byte.
+ * The URIs are then radix sorted on the first eight bytes of their keys, and
+ * only those that tie on all eight are looked at again, eight bytes further
+ * along. Small groups are sorted by comparing the rest of their keys.
+ */
+
+typedef struct {
+    guint64 prefix;
+    gsize offset;
+    gsize len;
+    UpgUri* uri;
+} UpgSortItem;
+
+static guint64 upg_sort_load_prefix(const gchar* keys, const UpgSortItem* item, gsize depth)
+{
+    guint64 prefix = 0;
+    for (gsize i = 0; i < 8; i++) {
+        prefix <<= 8;
+        if (depth + i < item->len) {
+            prefix |= (guint8)keys[item->offset + depth + i];
+        }
+    }
+    return prefix;
+}
+
+static gint upg_sort_item_compare(const UpgSortItem* a, const UpgSortItem* b, const gchar* keys, gsize depth)
+{
+    gsize len_a = a->len - MIN(a->len, depth);
+    gsize len_b = b->len - MIN(b->len, depth);
+    gint ret = memcmp(keys + a->offset + depth, keys + b->offset + depth, MIN(len_a, len_b));
+    if (ret != 0) {
+        return ret;
+    }
+
+    return (len_a > len_b) - (len_a < len_b);
+}
+
+static void upg_sort_small(UpgSortItem* items, gsize n, const gchar* keys, gsize depth)
+{
+    for (gsize i = 1; i < n; i++) {
+        UpgSortItem item = items[i];
+        gsize j = i;
+        while (j > 0 && upg_sort_item_compare(&items[j - 1], &item, keys, depth) > 0) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
+    }
+}
+
+/*
+ * upg_sort_range:
+ * @items: The items to sort.
+ * @temp: Scratch space for at least @n items.
+ * @n: The number of items.
+ * @keys: The text of the keys.
+ * @depth: How many bytes of the keys are known to be the same already.
+ *
+ * Sorts @items by their keys from @depth on. Only the smaller groups of ties
+ * are sorted by recursing, and the biggest one by looping, so the recursion
+ * is never deeper than log2(@n) however long a prefix the keys share.
+ */
+static void upg_sort_range(UpgSortItem* items, UpgSortItem* temp, gsize n, const gchar* keys, gsize depth)
+{
+    while (n >= UPG_SORT_SMALL) {
+        for (gsize i = 0; i < n; i++) {
+            items[i].prefix = upg_sort_load_prefix(keys, &items[i], depth);
+        }
+
+        // least significant byte first, skipping bytes that are all the same
+        for (guint shift = 0; shift < 64; shift += 8) {
+            gsize counts[256] = { 0 };
+            for (gsize i = 0; i < n; i++) {
+                counts[(items[i].prefix >> shift) & 0xff]++;
+            }
+
+            if (counts[(items[0].prefix >> shift) & 0xff] == n) {
+                continue;
+            }
+
+            gsize total = 0;
+            for (guint b = 0; b < 256; b++) {
+                gsize count = counts[b];
+                counts[b] = total;
+                total += count;
+            }
+
+            for (gsize i = 0; i < n; i++) {
+                temp[counts[(items[i].prefix >> shift) & 0xff]++] = items[i];
+            }
+            memcpy(items, temp, n * sizeof(UpgSortItem));
+        }
+
+        // keys never start with each other, so if one in a tie is done, they
+        // all are, and they're the same
+        gsize largest_start = 0;
+        gsize largest_n = 0;
+        gsize start = 0;
+        for (gsize i = 1; i <= n; i++) {
+            if (i < n && items[i].prefix == items[start].prefix) {
+                continue;
+            }
+
+            if (i - start > 1 && items[start].len > depth + 8) {
+                if (i - start > largest_n) {
+                    if (largest_n > 0) {
+                        upg_sort_range(items + largest_start, temp, largest_n, keys, depth + 8);
+                    }
+                    largest_start = start;
+                    largest_n = i - start;
+                } else {
+                    upg_sort_range(items + start, temp, i - start, keys, depth + 8);
+                }
+            }
+            start = i;
+        }
+
+        items += largest_start;
+        n = largest_n;
+        depth += 8;
+    }
+
+    upg_sort_small(items, n, keys, depth);
+}
+
+/**
+ * upg_uri_sort:
+ * @uris: (array length=n_uris) (inout): The URIs to sort.
+ * @n_uris: The number of URIs in @uris.
+ *
+ * Sorts @uris in place, into the order given by upg_uri_compare(). URIs that
+ * are the same may end up in any order.
+ */
+void upg_uri_sort(UpgUri** uris, gsize n_uris)
+{
+    g_return_if_fail(uris != NULL || n_uris == 0);
+
+    if (n_uris < 2) {
+        return;
+    }
+
+    GString* keys = g_string_new(NULL);
+    UpgSortItem* items = g_new(UpgSortItem, n_uris);
+    for (gsize i = 0; i < n_uris; i++) {
+        items[i].offset = keys->len;
+        upg_uri_append_sort_key(uris[i], keys);
+        items[i].len = keys->len - items[i].offset;
+        items[i].uri = uris[i];
+    }
+
+    UpgSortItem* temp = g_new(UpgSortItem, n_uris);
+    upg_sort_range(items, temp, n_uris, keys->str, 0);
+
+    for (gsize i = 0; i < n_uris; i++) {
+        uris[i] = items[i].uri;
+    }
+
+    g_free(temp);
+    g_free(items);
+    g_string_free(keys, TRUE);
+}
@@ -0,0 +1,300 @@
+/* upgsurt.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgsurt.h"
+#include <string.h>
+
+/**
+ * SECTION:upgsurt
+ * @short_description: Sort-friendly URI keys for web archives
+ * @include: liburiparser-gobject.h
+ * @title: SURTs
+ *
+ * A SURT (Sort-friendly URI Reordering Transform) is a URI with its host
+ * labels turned around, so that `http://www.example.com/path?q` becomes
+ * `com,example,www)/path?q`. Sorting by SURT puts everything from a site,
+ * and its subdomains, next to each other; web archive indexes like CDX files
+ * are ordered that way.
+ *
+ * The SURT is written straight from the parsed parts of the URI: the host is
+ * walked backwards label by label, and the path segments and query are copied
+ * across, so nothing is split into separate strings along the way. The host
+ * and scheme are lowercased, but the path and query are left alone. The
+ * userinfo and fragment aren't part of a SURT.
+ *
+ * URIs without a host, like `mailto:` ones or `file:///etc/passwd`, don't have
+ * a SURT form, and are written out as they are.
+ */
+
+/**
+ * upg_surt_flags_get_type:
+ *
+ * Returns the #GType corresponding to #UpgSurtFlags, setting it up if
+ * necessary.
+ *
+ * Returns: the #GType
+ */
+GType upg_surt_flags_get_type(void)
+{
+    static volatile gsize gtype_id = 0;
+    static const GFlagsValue values[] = {
+        { UPG_SURT_DEFAULT, "UPG_SURT_DEFAULT", "default" },
+        { UPG_SURT_STRIP_WWW, "UPG_SURT_STRIP_WWW", "strip-www" },
+        { UPG_SURT_STRIP_DEFAULT_PORT, "UPG_SURT_STRIP_DEFAULT_PORT", "strip-default-port" },
+        { UPG_SURT_SORT_QUERY, "UPG_SURT_SORT_QUERY", "sort-query" },
+        { UPG_SURT_WITH_SCHEME, "UPG_SURT_WITH_SCHEME", "with-scheme" },
+        { 0, NULL, NULL }
+    };
+
+    if (g_once_init_enter(&gtype_id)) {
+        GType new_type = g_flags_register_static(g_intern_static_string("UpgSurtFlags"), values);
+        g_once_init_leave(&gtype_id, new_type);
+    }
+
+    return (GType)gtype_id;
+}
+
+static void upg_surt_append_lower(GString* out, const gchar* first, const gchar* after_last)
+{
+    for (const gchar* c = first; c < after_last; c++) {
+        g_string_append_c(out, g_ascii_tolower(*c));
+    }
+}
+
+static gboolean upg_surt_is_www(const gchar* first, const gchar* after_last)
+{
+    if (after_last - first < 3 || g_ascii_strncasecmp(first, "www", 3) != 0)
+        return FALSE;
+
+    for (const gchar* c = first + 3; c < after_last; c++) {
+        if (!g_ascii_isdigit(*c))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void upg_surt_append_host(const UriUriA* uri, UpgSurtFlags flags, GString* out)
+{
+    const gchar* first = uri->hostText.first;
+    const gchar* after_last = uri->hostText.afterLast;
+
+    if (uri->hostData.ip6 != NULL || uri->hostData.ipFuture.first != NULL) {
+        g_string_append_c(out, '[');
+        upg_surt_append_lower(out, first, after_last);
+        g_string_append_c(out, ']');
+        return;
+    }
+
+    if (after_last > first && after_last[-1] == '.')
+        after_last--;
+
+    // no top-level domain starts with a digit, so this catches IPv4 addresses
+    // that were set with upg_uri_set_host() and weren't parsed as such
+    const gchar* last_label = after_last;
+    while (last_label > first && last_label[-1] != '.')
+        last_label--;
+
+    if (uri->hostData.ip4 != NULL || (last_label < after_last && g_ascii_isdigit(*last_label))) {
+        upg_surt_append_lower(out, first, after_last);
+        return;
+    }
+
+    if (flags & UPG_SURT_STRIP_WWW) {
+        const gchar* dot = memchr(first, '.', after_last - first);
+        if (dot != NULL && upg_surt_is_www(first, dot))
+            first = dot + 1;
+    }
+
+    const gchar* end = after_last;
+    for (;;) {
+        const gchar* label = end;
+        while (label > first && label[-1] != '.')
+            label--;
+
+        upg_surt_append_lower(out, label, end);
+        if (label == first)
+            break;
+
+        g_string_append_c(out, ',');
+        end = label - 1;
+    }
+}
+
+static gint upg_surt_slice_compare(gconstpointer _a, gconstpointer _b)
+{
+    const UpgSlice* a = _a;
+    const UpgSlice* b = _b;
+
+    gint ret = memcmp(a->data, b->data, MIN(a->len, b->len));
+    if (ret != 0)
+        return ret;
+
+    return a->len < b->len ? -1 : a->len > b->len ? 1 : 0;
+}
+
+static void upg_surt_append_query(const UriUriA* uri, UpgSurtFlags flags, GString* out, GArray** scratch)
+{
+    const gchar* first = uri->query.first;
+    const gchar* after_last = uri->query.afterLast;
+
+    g_string_append_c(out, '?');
+    if (!(flags & UPG_SURT_SORT_QUERY) || memchr(first, '&', after_last - first) == NULL) {
+        g_string_append_len(out, first, after_last - first);
+        return;
+    }
+
+    if (*scratch == NULL)
+        *scratch = g_array_new(FALSE, FALSE, sizeof(UpgSlice));
+    g_array_set_size(*scratch, 0);
+
+    const gchar* param = first;
+    for (;;) {
+        const gchar* end = memchr(param, '&', after_last - param);
+        if (end == NULL)
+            end = after_last;
+
+        UpgSlice slice = { param, end - param };
+        g_array_append_val(*scratch, slice);
+
+        if (end == after_last)
+            break;
+        param = end + 1;
+    }
+
+    g_array_sort(*scratch, upg_surt_slice_compare);
+
+    for (guint i = 0; i < (*scratch)->len; i++) {
+        const UpgSlice* slice = &g_array_index(*scratch, UpgSlice, i);
+        if (i > 0)
+            g_string_append_c(out, '&');
+        g_string_append_len(out, slice->data, slice->len);
+    }
+}
+
+static void upg_surt_append(UpgUri* self, UpgSurtFlags flags, GString* out, GArray** scratch)
+{
+    const UriUriA* uri = upg_uri_get_internal(self);
+
+    if (uri->hostText.first == NULL || uri->hostText.first == uri->hostText.afterLast) {
+        upg_uri_append_to_gstring(self, out);
+        return;
+    }
+
+    if (flags & UPG_SURT_WITH_SCHEME) {
+        upg_surt_append_lower(out, uri->scheme.first, uri->scheme.afterLast);
+        g_string_append(out, "://(");
+    }
+
+    upg_surt_append_host(uri, flags, out);
+    if (flags & UPG_SURT_WITH_SCHEME)
+        g_string_append_c(out, ',');
+
+    if (uri->portText.first != uri->portText.afterLast
+        && !((flags & UPG_SURT_STRIP_DEFAULT_PORT) && upg_uri_has_default_port(self))) {
+        g_string_append_c(out, ':');
+        g_string_append_len(out, uri->portText.first, uri->portText.afterLast - uri->portText.first);
+    }
+
+    g_string_append_c(out, ')');
+
+    if (uri->pathHead == NULL)
+        g_string_append_c(out, '/');
+    for (const UriPathSegmentA* segment = uri->pathHead; segment != NULL; segment = segment == uri->pathTail ? NULL : segment->next) {
+        g_string_append_c(out, '/');
+        g_string_append_len(out, segment->text.first, segment->text.afterLast - segment->text.first);
+    }
+
+    if (uri->query.first != uri->query.afterLast)
+        upg_surt_append_query(uri, flags, out, scratch);
+}
+
+/**
+ * upg_uri_to_surt:
+ * @self: The URI to make a SURT of.
+ * @flags: How to make the SURT.
+ *
+ * Makes the SURT form of @self; see the section description.
+ *
+ * Returns: (transfer full): The SURT of @self.
+ */
+gchar* upg_uri_to_surt(UpgUri* self, UpgSurtFlags flags)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), NULL);
+
+    GString* out = g_string_new(NULL);
+    upg_uri_append_surt(self, flags, out);
+    return g_string_free(out, FALSE);
+}
+
+/**
+ * upg_uri_append_surt:
+ * @self: The URI to make a SURT of.
+ * @flags: How to make the SURT.
+ * @out: (not nullable): The string to append the SURT to.
+ *
+ * Appends the SURT form of @self to @out, like upg_uri_to_surt().
+ */
+void upg_uri_append_surt(UpgUri* self, UpgSurtFlags flags, GString* out)
+{
+    g_return_if_fail(UPG_IS_URI(self));
+    g_return_if_fail(out != NULL);
+
+    GArray* scratch = NULL;
+    upg_surt_append(self, flags, out, &scratch);
+    if (scratch != NULL)
+        g_array_unref(scratch);
+}
+
+/**
+ * upg_uri_to_surt_many:
+ * @uris: (array length=n_uris) (transfer none): The URIs to make SURTs of.
+ * @n_uris: The number of URIs in @uris.
+ * @flags: How to make the SURTs.
+ * @out: (not nullable): The string to append the SURTs to.
+ * @offsets: (array length=n_uris) (out caller-allocates): Where to put the
+ *           offset of each SURT into @out.
+ *
+ * Makes the SURT of each of @uris, appending them to @out one after another,
+ * each followed by a nul byte. The SURT for `uris[i]` starts at
+ * `out->str + offsets[i]`.
+ *
+ * Offsets are used instead of pointers because @out may be reallocated as it
+ * grows.
+ */
+void upg_uri_to_surt_many(UpgUri** uris, gsize n_uris, UpgSurtFlags flags, GString* out, gsize* offsets)
+{
+    g_return_if_fail(uris != NULL || n_uris == 0);
+    g_return_if_fail(out != NULL);
+    g_return_if_fail(offsets != NULL || n_uris == 0);
+
+    for (gsize i = 0; i < n_uris; i++) {
+        g_return_if_fail(UPG_IS_URI(uris[i]));
+    }
+
+    GArray* scratch = NULL;
+    for (gsize i = 0; i < n_uris; i++) {
+        offsets[i] = out->len;
+        upg_surt_append(uris[i], flags, out, &scratch);
+        g_string_append_c(out, '\0');
+    }
+
+    if (scratch != NULL)
+        g_array_unref(scratch);
+}
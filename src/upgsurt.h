@@ -0,0 +1,65 @@
+/* upgsurt.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGSURT_H
+#define UPGSURT_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+/**
+ * UpgSurtFlags:
+ * @UPG_SURT_DEFAULT: Make plain SURTs, like `com,example,www)/path?b&a`.
+ * @UPG_SURT_STRIP_WWW: Leave out a first host label of `www`, or `www`
+ *                      followed by digits.
+ * @UPG_SURT_STRIP_DEFAULT_PORT: Leave out the port if it's the default for the
+ *                               scheme, from upg_scheme_get_default_port().
+ * @UPG_SURT_SORT_QUERY: Sort the query parameters, so that the order they
+ *                       were given in doesn't matter.
+ * @UPG_SURT_WITH_SCHEME: Start with the scheme, like
+ *                        `http://(com,example,www,)/path`.
+ *
+ * Options for upg_uri_to_surt().
+ */
+typedef enum {
+    UPG_SURT_DEFAULT = 0,
+    UPG_SURT_STRIP_WWW = 1,
+    UPG_SURT_STRIP_DEFAULT_PORT = 2,
+    UPG_SURT_SORT_QUERY = 4,
+    UPG_SURT_WITH_SCHEME = 8,
+} UpgSurtFlags;
+
+GType upg_surt_flags_get_type(void);
+#define UPG_TYPE_SURT_FLAGS upg_surt_flags_get_type()
+
+gchar* upg_uri_to_surt(UpgUri* self, UpgSurtFlags flags);
+void upg_uri_append_surt(UpgUri* self, UpgSurtFlags flags, GString* out);
+void upg_uri_to_surt_many(UpgUri** uris, gsize n_uris, UpgSurtFlags flags, GString* out, gsize* offsets);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,564 @@
+/* upgtrie.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgtrie.h"
+#include "upgparams.h"
+#include <string.h>
+#include <uriparser/Uri.h>
+
+/**
+ * SECTION:upgtrie
+ * @short_description: Finding which of many URIs are above or below another
+ * @include: liburiparser-gobject.h
+ * @title: UpgUriTrie
+ *
+ * #UpgUriTrie holds a set of URIs, each with a value, and answers the same
+ * question as upg_uri_is_parent_of() against all of them at once: which
+ * registered URIs contain this one (upg_uri_trie_ancestors() and
+ * upg_uri_trie_longest_prefix()), and which does this one contain
+ * (upg_uri_trie_descendants())?
+ *
+ * URIs are arranged by their host and port (and scheme and userinfo, with
+ * %UPG_HIERARCHY_STRICT), and then by their path segments, so a lookup only
+ * has to look at as many nodes as there are segments in the path, no matter
+ * how many URIs are in the trie. Just like with upg_uri_is_parent_of(), an
+ * empty segment ends the path, so `https://example.com/a/` and
+ * `https://example.com/a` are the same prefix.
+ *
+ * The flags and the default port are given when the trie is made, and apply
+ * to every lookup. %UPG_HIERARCHY_IGNOREPORT leaves ports out altogether.
+ *
+ * Inserting, removing and looking up URIs don't allocate anything beyond the
+ * nodes that are added: the nodes are keyed by slices, so the parts of a URI
+ * are looked up where they are. Nodes that are left without a value or
+ * children are freed when a URI is removed.
+ */
+
+typedef struct _UpgTrieNode UpgTrieNode;
+struct _UpgTrieNode {
+    GHashTable* children;
+    gpointer value;
+    gboolean has_value;
+};
+
+struct _UpgUriTrie {
+    GObject parent_instance;
+
+    GHashTable* roots;
+    guint16 default_port;
+    UpgHierarchyFlags flags;
+    GDestroyNotify value_destroy;
+    guint size;
+    GString* scratch;
+};
+
+G_DEFINE_TYPE(UpgUriTrie, upg_uri_trie, G_TYPE_OBJECT)
+
+static void upg_trie_node_free(gpointer ptr);
+
+static UpgTrieNode* upg_trie_node_new(void)
+{
+    // the children are only made when the node gets some, since most nodes
+    // are leaves
+    return g_new0(UpgTrieNode, 1);
+}
+
+static void upg_trie_node_free(gpointer ptr)
+{
+    UpgTrieNode* node = ptr;
+
+    // the destroy function for values is on the trie, which has cleared them
+    // out before getting here
+    g_assert(!node->has_value);
+
+    if (node->children != NULL) {
+        g_hash_table_unref(node->children);
+    }
+    g_free(node);
+}
+
+static void upg_trie_node_clear_values(UpgTrieNode* node, GDestroyNotify value_destroy)
+{
+    if (node->has_value && value_destroy != NULL) {
+        value_destroy(node->value);
+    }
+    node->has_value = FALSE;
+    node->value = NULL;
+
+    if (node->children == NULL) {
+        return;
+    }
+
+    GHashTableIter iter;
+    gpointer child;
+    g_hash_table_iter_init(&iter, node->children);
+    while (g_hash_table_iter_next(&iter, NULL, &child)) {
+        upg_trie_node_clear_values(child, value_destroy);
+    }
+}
+
+static void upg_trie_node_collect(UpgTrieNode* node, GPtrArray* out)
+{
+    if (node->has_value) {
+        g_ptr_array_add(out, node->value);
+    }
+
+    if (node->children == NULL) {
+        return;
+    }
+
+    GHashTableIter iter;
+    gpointer child;
+    g_hash_table_iter_init(&iter, node->children);
+    while (g_hash_table_iter_next(&iter, NULL, &child)) {
+        upg_trie_node_collect(child, out);
+    }
+}
+
+static void upg_uri_trie_finalize(GObject* obj)
+{
+    UpgUriTrie* self = UPG_URI_TRIE(obj);
+
+    GHashTableIter iter;
+    gpointer root;
+    g_hash_table_iter_init(&iter, self->roots);
+    while (g_hash_table_iter_next(&iter, NULL, &root)) {
+        upg_trie_node_clear_values(root, self->value_destroy);
+    }
+
+    g_hash_table_unref(self->roots);
+    g_string_free(self->scratch, TRUE);
+
+    G_OBJECT_CLASS(upg_uri_trie_parent_class)->finalize(obj);
+}
+
+static void upg_uri_trie_class_init(UpgUriTrieClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->finalize = upg_uri_trie_finalize;
+}
+
+static void upg_uri_trie_init(UpgUriTrie* self)
+{
+    self->roots = g_hash_table_new_full(upg_slice_hash, upg_slice_equal, g_free, upg_trie_node_free);
+    self->scratch = g_string_new(NULL);
+}
+
+/**
+ * upg_uri_trie_new:
+ * @default_port: The port to use for URIs that don't have one, like in
+ *                upg_uri_is_parent_of(). Unused if it is 0.
+ * @flags: The flags to use for every lookup; see #UpgHierarchyFlags.
+ * @value_destroy: (nullable): A function to free values with, or %NULL.
+ *
+ * Creates a new, empty #UpgUriTrie.
+ *
+ * Returns: (transfer full): a new #UpgUriTrie.
+ */
+UpgUriTrie* upg_uri_trie_new(guint16 default_port, UpgHierarchyFlags flags, GDestroyNotify value_destroy)
+{
+    UpgUriTrie* self = g_object_new(UPG_TYPE_URI_TRIE, NULL);
+    self->default_port = default_port;
+    self->flags = flags;
+    self->value_destroy = value_destroy;
+    return self;
+}
+
+static void upg_uri_trie_key_append(GString* key, gchar tag, UriTextRangeA range)
+{
+    // the tag tells a missing part apart from an empty one
+    if (range.first == NULL) {
+        g_string_append_c(key, '-');
+    } else {
+        g_string_append_c(key, tag);
+        g_string_append_len(key, range.first, range.afterLast - range.first);
+    }
+}
+
+/*
+ * upg_uri_trie_root_key:
+ * @self: The trie.
+ * @uri: The URI to make a key for.
+ * @key: (out caller-allocates): The key.
+ *
+ * Puts everything about @uri that has to match exactly, other than the path,
+ * into the scratch string of @self, straight from the text of @uri.
+ */
+static void upg_uri_trie_root_key(UpgUriTrie* self, UpgUri* uri, UpgSlice* key)
+{
+    const UriUriA* internal = upg_uri_get_internal(uri);
+    GString* scratch = self->scratch;
+    g_string_truncate(scratch, 0);
+
+    if (self->flags & UPG_HIERARCHY_STRICT) {
+        upg_uri_trie_key_append(scratch, 's', internal->scheme);
+        g_string_append_c(scratch, '/');
+        upg_uri_trie_key_append(scratch, 'u', internal->userInfo);
+        g_string_append_c(scratch, '/');
+    }
+
+    upg_uri_trie_key_append(scratch, 'h', internal->hostText);
+
+    if (!(self->flags & UPG_HIERARCHY_IGNOREPORT)) {
+        guint port = upg_uri_get_port(uri);
+        if (port == 0) {
+            port = self->default_port;
+        }
+
+        gchar digits[6];
+        gsize n_digits = 0;
+        do {
+            digits[n_digits++] = '0' + port % 10;
+            port /= 10;
+        } while (port > 0);
+
+        g_string_append_c(scratch, '/');
+        while (n_digits > 0) {
+            g_string_append_c(scratch, digits[--n_digits]);
+        }
+    }
+
+    key->data = scratch->str;
+    key->len = scratch->len;
+}
+
+/*
+ * upg_uri_trie_path_length:
+ * @segments: The path segments of a URI.
+ * @n_segments: The number of segments in @segments.
+ *
+ * Works out how many segments count; like with upg_uri_is_parent_of(), an
+ * empty segment ends the path.
+ *
+ * Returns: The number of segments before the first empty one.
+ */
+static gsize upg_uri_trie_path_length(const UpgSlice* segments, gsize n_segments)
+{
+    gsize len = 0;
+    while (len < n_segments && segments[len].len > 0) {
+        len++;
+    }
+    return len;
+}
+
+static UpgTrieNode* upg_uri_trie_child(UpgTrieNode* node, const UpgSlice* segment)
+{
+    return node->children != NULL ? g_hash_table_lookup(node->children, segment) : NULL;
+}
+
+/**
+ * upg_uri_trie_insert:
+ * @self: The trie to add to.
+ * @prefix: (transfer none) (not nullable): The URI to add.
+ * @value: (nullable): The value to keep with @prefix.
+ *
+ * Adds @prefix to @self with the value @value. If @prefix (or a URI that's the
+ * same for the purpose of @self) was already there, its value is replaced.
+ */
+void upg_uri_trie_insert(UpgUriTrie* self, UpgUri* prefix, gpointer value)
+{
+    g_return_if_fail(UPG_IS_URI_TRIE(self));
+    g_return_if_fail(UPG_IS_URI(prefix));
+
+    UpgSlice key;
+    upg_uri_trie_root_key(self, prefix, &key);
+    UpgTrieNode* node = g_hash_table_lookup(self->roots, &key);
+    if (node == NULL) {
+        node = upg_trie_node_new();
+        g_hash_table_insert(self->roots, upg_slice_dup(key.data, key.len), node);
+    }
+
+    gsize n_segments = 0;
+    const UpgSlice* segments = upg_uri_get_path_segments(prefix, &n_segments);
+    n_segments = upg_uri_trie_path_length(segments, n_segments);
+
+    for (gsize i = 0; i < n_segments; i++) {
+        UpgTrieNode* child = upg_uri_trie_child(node, &segments[i]);
+        if (child == NULL) {
+            if (node->children == NULL) {
+                node->children = g_hash_table_new_full(upg_slice_hash, upg_slice_equal, g_free, upg_trie_node_free);
+            }
+
+            child = upg_trie_node_new();
+            g_hash_table_insert(node->children, upg_slice_dup(segments[i].data, segments[i].len), child);
+        }
+        node = child;
+    }
+
+    if (node->has_value) {
+        if (self->value_destroy != NULL) {
+            self->value_destroy(node->value);
+        }
+    } else {
+        self->size++;
+    }
+
+    node->value = value;
+    node->has_value = TRUE;
+}
+
+/*
+ * upg_uri_trie_find:
+ * @self: The trie to look in.
+ * @uri: The URI to look for.
+ *
+ * Finds the node for @uri, if there is one.
+ *
+ * Returns: (nullable): The node for @uri, or %NULL.
+ */
+static UpgTrieNode* upg_uri_trie_find(UpgUriTrie* self, UpgUri* uri)
+{
+    UpgSlice key;
+    upg_uri_trie_root_key(self, uri, &key);
+    UpgTrieNode* node = g_hash_table_lookup(self->roots, &key);
+
+    gsize n_segments = 0;
+    const UpgSlice* segments = upg_uri_get_path_segments(uri, &n_segments);
+    n_segments = upg_uri_trie_path_length(segments, n_segments);
+
+    for (gsize i = 0; i < n_segments && node != NULL; i++) {
+        node = upg_uri_trie_child(node, &segments[i]);
+    }
+
+    return node;
+}
+
+/*
+ * upg_trie_node_remove:
+ * @self: The trie.
+ * @node: The node to remove from.
+ * @segments: The path segments below @node.
+ * @n_segments: The number of segments in @segments.
+ *
+ * Removes the value at the end of @segments under @node, and then frees any
+ * nodes on the way there that are left with nothing in them.
+ *
+ * Returns: Whether there was a value to remove.
+ */
+static gboolean upg_trie_node_remove(UpgUriTrie* self, UpgTrieNode* node, const UpgSlice* segments, gsize n_segments)
+{
+    if (n_segments == 0) {
+        if (!node->has_value) {
+            return FALSE;
+        }
+
+        if (self->value_destroy != NULL) {
+            self->value_destroy(node->value);
+        }
+        node->value = NULL;
+        node->has_value = FALSE;
+        return TRUE;
+    }
+
+    UpgTrieNode* child = upg_uri_trie_child(node, segments);
+    if (child == NULL || !upg_trie_node_remove(self, child, segments + 1, n_segments - 1)) {
+        return FALSE;
+    }
+
+    if (!child->has_value && child->children == NULL) {
+        g_hash_table_remove(node->children, segments);
+        if (g_hash_table_size(node->children) == 0) {
+            g_clear_pointer(&node->children, g_hash_table_unref);
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * upg_uri_trie_remove:
+ * @self: The trie to remove from.
+ * @prefix: (transfer none) (not nullable): The URI to remove.
+ *
+ * Removes @prefix from @self, freeing its value.
+ *
+ * Returns: Whether @prefix was in @self.
+ */
+gboolean upg_uri_trie_remove(UpgUriTrie* self, UpgUri* prefix)
+{
+    g_return_val_if_fail(UPG_IS_URI_TRIE(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(prefix), FALSE);
+
+    UpgSlice key;
+    upg_uri_trie_root_key(self, prefix, &key);
+    UpgTrieNode* root = g_hash_table_lookup(self->roots, &key);
+    if (root == NULL) {
+        return FALSE;
+    }
+
+    gsize n_segments = 0;
+    const UpgSlice* segments = upg_uri_get_path_segments(prefix, &n_segments);
+    n_segments = upg_uri_trie_path_length(segments, n_segments);
+
+    if (!upg_trie_node_remove(self, root, segments, n_segments)) {
+        return FALSE;
+    }
+
+    if (!root->has_value && root->children == NULL) {
+        g_hash_table_remove(self->roots, &key);
+    }
+    self->size--;
+
+    return TRUE;
+}
+
+/**
+ * upg_uri_trie_get_size:
+ * @self: The trie.
+ *
+ * Gets the number of URIs in @self.
+ *
+ * Returns: The number of URIs in @self.
+ */
+guint upg_uri_trie_get_size(UpgUriTrie* self)
+{
+    g_return_val_if_fail(UPG_IS_URI_TRIE(self), 0);
+
+    return self->size;
+}
+
+/*
+ * upg_uri_trie_walk_ancestors:
+ * @self: The trie to look in.
+ * @uri: The URI to look for.
+ * @func: What to call with the value of each parent of @uri.
+ * @data: The second argument to @func.
+ *
+ * Goes down @self along the path of @uri, calling @func for each node that's
+ * a parent of @uri, shortest path first.
+ */
+static void upg_uri_trie_walk_ancestors(UpgUriTrie* self, UpgUri* uri, GFunc func, gpointer data)
+{
+    UpgSlice key;
+    upg_uri_trie_root_key(self, uri, &key);
+    UpgTrieNode* node = g_hash_table_lookup(self->roots, &key);
+    if (node == NULL) {
+        return;
+    }
+
+    gsize n_segments = 0;
+    const UpgSlice* segments = upg_uri_get_path_segments(uri, &n_segments);
+    n_segments = upg_uri_trie_path_length(segments, n_segments);
+
+    for (gsize i = 0; i <= n_segments && node != NULL; i++) {
+        gboolean is_self = i == n_segments;
+        if (node->has_value && !(is_self && (self->flags & UPG_HIERARCHY_NOTSELF))) {
+            func(node->value, data);
+        }
+
+        if (!is_self) {
+            node = upg_uri_trie_child(node, &segments[i]);
+        }
+    }
+}
+
+typedef struct {
+    gboolean found;
+    gpointer value;
+} UpgTrieDeepest;
+
+static void upg_uri_trie_keep_deepest(gpointer value, gpointer data)
+{
+    UpgTrieDeepest* deepest = data;
+    deepest->found = TRUE;
+    deepest->value = value;
+}
+
+/**
+ * upg_uri_trie_longest_prefix:
+ * @self: The trie to look in.
+ * @uri: (transfer none) (not nullable): The URI to look for.
+ * @value: (out) (optional) (nullable) (transfer none): Where to put the value
+ *         of the prefix.
+ *
+ * Finds the deepest URI in @self that is a parent of @uri, in the sense of
+ * upg_uri_is_parent_of().
+ *
+ * Returns: Whether there was such a URI.
+ */
+gboolean upg_uri_trie_longest_prefix(UpgUriTrie* self, UpgUri* uri, gpointer* value)
+{
+    g_return_val_if_fail(UPG_IS_URI_TRIE(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+
+    UpgTrieDeepest deepest = { FALSE, NULL };
+    upg_uri_trie_walk_ancestors(self, uri, upg_uri_trie_keep_deepest, &deepest);
+    if (deepest.found && value != NULL) {
+        *value = deepest.value;
+    }
+
+    return deepest.found;
+}
+
+static void upg_uri_trie_add_ancestor(gpointer value, gpointer data)
+{
+    g_ptr_array_add(data, value);
+}
+
+/**
+ * upg_uri_trie_ancestors:
+ * @self: The trie to look in.
+ * @uri: (transfer none) (not nullable): The URI to look for.
+ *
+ * Finds every URI in @self that is a parent of @uri, in the sense of
+ * upg_uri_is_parent_of().
+ *
+ * Returns: (transfer container) (element-type gpointer): The values of the
+ * parents, shortest path first.
+ */
+GPtrArray* upg_uri_trie_ancestors(UpgUriTrie* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_URI_TRIE(self), NULL);
+    g_return_val_if_fail(UPG_IS_URI(uri), NULL);
+
+    GPtrArray* ancestors = g_ptr_array_new();
+    upg_uri_trie_walk_ancestors(self, uri, upg_uri_trie_add_ancestor, ancestors);
+    return ancestors;
+}
+
+/**
+ * upg_uri_trie_descendants:
+ * @self: The trie to look in.
+ * @uri: (transfer none) (not nullable): The URI to look for.
+ *
+ * Finds every URI in @self that @uri is a parent of, in the sense of
+ * upg_uri_is_parent_of().
+ *
+ * Returns: (transfer container) (element-type gpointer): The values of the
+ * children, in no particular order.
+ */
+GPtrArray* upg_uri_trie_descendants(UpgUriTrie* self, UpgUri* uri)
+{
+    g_return_val_if_fail(UPG_IS_URI_TRIE(self), NULL);
+    g_return_val_if_fail(UPG_IS_URI(uri), NULL);
+
+    GPtrArray* descendants = g_ptr_array_new();
+    UpgTrieNode* node = upg_uri_trie_find(self, uri);
+    if (node == NULL) {
+        return descendants;
+    }
+
+    upg_trie_node_collect(node, descendants);
+    if (node->has_value && (self->flags & UPG_HIERARCHY_NOTSELF)) {
+        g_ptr_array_remove_index(descendants, 0);
+    }
+
+    return descendants;
+}
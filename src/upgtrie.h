@@ -0,0 +1,47 @@
+/* upgtrie.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGTRIE_H
+#define UPGTRIE_H
+
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+#define UPG_TYPE_URI_TRIE upg_uri_trie_get_type()
+G_DECLARE_FINAL_TYPE(UpgUriTrie, upg_uri_trie, UPG, URI_TRIE, GObject)
+
+UpgUriTrie* upg_uri_trie_new(guint16 default_port, UpgHierarchyFlags flags, GDestroyNotify value_destroy);
+void upg_uri_trie_insert(UpgUriTrie* self, UpgUri* prefix, gpointer value);
+gboolean upg_uri_trie_remove(UpgUriTrie* self, UpgUri* prefix);
+guint upg_uri_trie_get_size(UpgUriTrie* self);
+gboolean upg_uri_trie_longest_prefix(UpgUriTrie* self, UpgUri* uri, gpointer* value);
+GPtrArray* upg_uri_trie_ancestors(UpgUriTrie* self, UpgUri* uri);
+GPtrArray* upg_uri_trie_descendants(UpgUriTrie* self, UpgUri* uri);
+
+G_END_DECLS
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "upguri.h"
 #include "upgerror.h"
+#include "upgparser.h"
 #include <gio/gio.h>
 #include <uriparser/Uri.h>
 
@@ -33,8 +34,11 @@ static void upg_uri_get_property(GObject* obj, guint id, GValue* value, GParamSp
 static gchar* str_from_uritextrange(UriTextRangeA range);
 static UriTextRangeA uritextrange_from_str(const gchar* str);
 static void upg_free_upsl_(UriPathSegmentA** segment, UriPathSegmentA** tail);
-static gboolean upg_uri_set_internal_uri(UpgUri* self, void* internal);
+static gboolean upg_uri_set_internal_uri(UpgUri* self, void* internal, UriMemoryManager* memory);
+static guint32 upg_uri_install_internal_uri(UpgUri* self, const UriUriA* uri, UriMemoryManager* memory, gchar* buffer);
 static gchar* upg_uriuri_to_string(UriUriA* self);
+static void upg_scratch_free(gpointer str);
+static guint32 upg_uriuri_diff(const UriUriA* a, const UriUriA* b);
 
 #define upg_free_utr(p) g_free((gchar*)p.first)
 #define upg_free_upsl(u) upg_free_upsl_(&u.pathHead, &u.pathTail)
@@ -65,7 +69,10 @@ enum {
     MASK_USERINFO = 1 << 7,
 };
 
+#define PROP_BIT(prop) (1u << (prop))
+
 static GParamSpec* params[_N_PROPERTIES_] = { NULL };
+static guint notify_signal_id = 0;
 
 /**
  * SECTION:upguri
@@ -80,8 +87,9 @@ static GParamSpec* params[_N_PROPERTIES_] = { NULL };
  * GObject. There is no way to get the internal UriUriA instance.
  *
  * UpgUri does not currently support many things, but it will probably never
- * support wide-char strings (UriUriW, etc.) You can use #g_utf16_to_utf8 to try
- * and convert a valid UTF-16 string to something UpgUri can handle.
+ * support wide-char strings (UriUriW, etc.) UTF-16 input can be parsed with
+ * upg_uri_new_utf16() or upg_uri_configure_from_utf16(), which narrow it
+ * while copying it in.
  */
 typedef struct {
     GObject parent_instance;
@@ -97,9 +105,21 @@ typedef struct {
     UriTextRangeA original_port;
     UriTextRangeA original_userinfo;
     UriTextRangeA original_scheme;
+    UriMemoryManager* memory;
     gchar* wanted;
+    gchar* buffer;
+    GArray* segments;
+    gboolean segments_valid;
+    union {
+        UriIp4 ip4;
+        UriIp6 ip6;
+    } host_address;
+    guint16 port;
+    UpgLimits limits;
 } UpgUriPrivate;
 
+static void upg_uri_classify_host(UpgUriPrivate* uri);
+
 /**
  * upg_hierarchy_flags_get_type:
  *
@@ -129,6 +149,34 @@ GType upg_hierarchy_flags_get_type(void)
     return (GType)gtype_id;
 }
 
+/**
+ * upg_host_type_get_type:
+ *
+ * Returns the #GType corresponding to #UpgHostType, setting it up if
+ * necessary.
+ *
+ * Returns: the #GType
+ */
+GType upg_host_type_get_type(void)
+{
+    static volatile gsize gtype_id = 0;
+    static const GEnumValue values[] = {
+        { UPG_HOST_NONE, "UPG_HOST_NONE", "none" },
+        { UPG_HOST_REG_NAME, "UPG_HOST_REG_NAME", "reg-name" },
+        { UPG_HOST_IPV4, "UPG_HOST_IPV4", "ipv4" },
+        { UPG_HOST_IPV6, "UPG_HOST_IPV6", "ipv6" },
+        { UPG_HOST_IPVFUTURE, "UPG_HOST_IPVFUTURE", "ipvfuture" },
+        { 0, NULL, NULL }
+    };
+
+    if (g_once_init_enter(&gtype_id)) {
+        GType new_type = g_enum_register_static(g_intern_static_string("UpgHostType"), values);
+        g_once_init_leave(&gtype_id, new_type);
+    }
+
+    return (GType)gtype_id;
+}
+
 G_DEFINE_TYPE_EXTENDED(UpgUri, upg_uri, G_TYPE_OBJECT, 0,
                        G_ADD_PRIVATE(UpgUri) struct dummy;
                        G_IMPLEMENT_INTERFACE(G_TYPE_INITABLE, upg_uri_initable_init) struct dummy;)
@@ -233,6 +281,7 @@ static void upg_uri_class_init(UpgUriClass* klass)
         NULL,
         G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY);
     g_object_class_install_properties(glass, _N_PROPERTIES_, params);
+    notify_signal_id = g_signal_lookup("notify", G_TYPE_OBJECT);
 
     glass->dispose = upg_uri_dispose;
     glass->finalize = upg_uri_finalize;
@@ -314,14 +363,21 @@ static void upg_uri_reset(UpgUri* self)
     uri->internal_uri.query = uri->original_query;
     uri->internal_uri.fragment = uri->original_fragment;
     uri->internal_uri.portText = uri->original_port;
-    uriFreeUriMembersA(&uri->internal_uri);
+    uriFreeUriMembersMmA(&uri->internal_uri, uri->memory);
     memset(&uri->internal_uri, 0, sizeof(UriUriA));
+    uri->memory = NULL;
+    uri->segments_valid = FALSE;
+    uri->port = 0;
 
     g_clear_pointer(&uri->wanted, g_free);
+    g_clear_pointer(&uri->buffer, g_free);
 }
 
 static void upg_uri_finalize(GObject* self)
 {
+    UpgUriPrivate* uri = upg_uri_get_instance_private(UPG_URI(self));
+    g_clear_pointer(&uri->segments, g_array_unref);
+
     G_OBJECT_CLASS(upg_uri_parent_class)->finalize(self);
 }
 
@@ -380,13 +436,13 @@ static void upg_uri_get_property(GObject* obj, guint id, GValue* value, GParamSp
         g_value_take_string(value, upg_uri_get_scheme(self));
         break;
     case PROP_HOST:
-        g_value_set_string(value, upg_uri_get_host(self));
+        g_value_take_string(value, upg_uri_get_host(self));
         break;
     case PROP_PATH:
         g_value_set_pointer(value, upg_uri_get_path(self));
         break;
     case PROP_PATHSTR:
-        g_value_set_string(value, upg_uri_get_path_str(self));
+        g_value_take_string(value, upg_uri_get_path_str(self));
         break;
     case PROP_QUERY:
         g_value_take_boxed(value, upg_uri_get_query(self));
@@ -415,6 +471,11 @@ static void upg_uri_get_property(GObject* obj, guint id, GValue* value, GParamSp
     }
 }
 
+static void upg_scratch_free(gpointer str)
+{
+    g_string_free(str, TRUE);
+}
+
 static char* str_from_uritextrange(UriTextRangeA range)
 {
     if (range.first == NULL || range.afterLast == NULL) {
@@ -438,6 +499,39 @@ static UriTextRangeA uritextrange_from_str(const gchar* str)
     return (UriTextRangeA) { dupd, dupd + len };
 }
 
+static gboolean uritextrange_equal(UriTextRangeA a, UriTextRangeA b)
+{
+    if (a.first == NULL || b.first == NULL) {
+        return a.first == b.first;
+    }
+
+    gsize len = a.afterLast - a.first;
+    return len == (gsize)(b.afterLast - b.first) && memcmp(a.first, b.first, len) == 0;
+}
+
+static gboolean uritextrange_is(UriTextRangeA range, const gchar* str)
+{
+    if (range.first == NULL || str == NULL) {
+        return range.first == NULL && str == NULL;
+    }
+
+    gsize len = range.afterLast - range.first;
+    return strncmp(range.first, str, len) == 0 && str[len] == '\0';
+}
+
+static guint16 upg_port_from_range(UriTextRangeA range)
+{
+    guint port = 0;
+    for (const gchar* current = range.first; current != NULL && current < range.afterLast && g_ascii_isdigit(*current); current++) {
+        port = port * 10 + (*current - '0');
+        // a port that doesn't fit is no port at all, rather than a wrapped one
+        if (port > G_MAXUINT16) {
+            return 0;
+        }
+    }
+    return (guint16)port;
+}
+
 static void upg_free_upsl_(UriPathSegmentA** segment, UriPathSegmentA** tail)
 {
     UriPathSegmentA* current = *segment;
@@ -490,6 +584,199 @@ UpgUri* upg_uri_new(const gchar* uri, GError** error)
     return g_initable_new(UPG_TYPE_URI, NULL, error, "wanted", uri, NULL);
 }
 
+/**
+ * upg_uri_new_full:
+ * @uri: (transfer none) (nullable): The input URI to be parsed, or %NULL.
+ * @limits: (nullable): The limits to parse @uri, and any later URIs, with.
+ * @error: A #GError.
+ *
+ * Creates a new #UpgUri like upg_uri_new(), but refuses @uri with a
+ * %UPG_ERR_LIMIT error if it goes over @limits. The limits are kept, so
+ * upg_uri_configure_from_string() checks them too.
+ *
+ * Returns: (transfer full): a new #UpgUri if the parsing was successful, or
+ * %NULL.
+ */
+UpgUri* upg_uri_new_full(const gchar* uri, const UpgLimits* limits, GError** error)
+{
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+    UpgUri* self = upg_uri_new(NULL, NULL);
+    upg_uri_set_limits(self, limits);
+
+    if (!upg_uri_configure_from_string(self, uri, error)) {
+        g_object_unref(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+/**
+ * upg_uri_set_limits:
+ * @self: The URI to change.
+ * @limits: (nullable): The new limits, or %NULL for none.
+ *
+ * Sets the limits that upg_uri_configure_from_string() checks before parsing
+ * anything into @self. The URI that @self has now isn't checked.
+ */
+void upg_uri_set_limits(UpgUri* self, const UpgLimits* limits)
+{
+    g_return_if_fail(UPG_IS_URI(self));
+
+    UpgUriPrivate* priv = upg_uri_get_instance_private(self);
+    if (limits != NULL)
+        priv->limits = *limits;
+    else
+        memset(&priv->limits, 0, sizeof(UpgLimits));
+}
+
+/**
+ * upg_limits_init_default:
+ * @limits: (out caller-allocates): The limits to fill in.
+ *
+ * Fills in @limits with values that no real URI should go over, but that
+ * keep the work done on a hostile one small: 64 KiB in total, 1024 path
+ * segments and query parameters, and 64 dot segments.
+ */
+void upg_limits_init_default(UpgLimits* limits)
+{
+    g_return_if_fail(limits != NULL);
+
+    limits->max_length = 64 * 1024;
+    limits->max_segments = 1024;
+    limits->max_query_params = 1024;
+    limits->max_dot_segments = 64;
+}
+
+static gboolean upg_is_dot_segment(const gchar* first, const gchar* after_last)
+{
+    guint dots = 0;
+    while (first < after_last) {
+        if (*first == '.') {
+            first++;
+        } else if (after_last - first >= 3 && first[0] == '%' && first[1] == '2' && g_ascii_tolower(first[2]) == 'e') {
+            first += 3;
+        } else {
+            return FALSE;
+        }
+
+        if (++dots > 2)
+            return FALSE;
+    }
+
+    return dots > 0;
+}
+
+/*
+ * upg_limits_check:
+ * @limits: The limits to check against.
+ * @uri: The text of the URI.
+ * @len: The length of @uri.
+ * @error: A #GError.
+ *
+ * Checks @uri against @limits, without parsing it properly; this just finds
+ * where the path and query must be, if @uri is valid, and counts what's in
+ * them. It takes one pass and allocates nothing, so it's cheap to do first.
+ *
+ * Returns: Whether @uri is within @limits; if not, @error is set.
+ */
+static gboolean upg_limits_check(const UpgLimits* limits, const gchar* uri, gsize len, GError** error)
+{
+    if (limits->max_length != 0 && len > limits->max_length) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_LIMIT,
+            "URI is %" G_GSIZE_FORMAT " bytes long, but the limit is %" G_GSIZE_FORMAT, len, limits->max_length);
+        return FALSE;
+    }
+
+    if (limits->max_segments == 0 && limits->max_query_params == 0 && limits->max_dot_segments == 0)
+        return TRUE;
+
+    const gchar* current = uri;
+    const gchar* end = uri + len;
+
+    // skip the scheme, if there is one
+    const gchar* scheme_end = current;
+    while (scheme_end < end && (g_ascii_isalnum(*scheme_end) || *scheme_end == '+' || *scheme_end == '-' || *scheme_end == '.'))
+        scheme_end++;
+    if (scheme_end > current && scheme_end < end && *scheme_end == ':' && g_ascii_isalpha(*current))
+        current = scheme_end + 1;
+
+    // and then the authority
+    if (end - current >= 2 && current[0] == '/' && current[1] == '/') {
+        current += 2;
+        while (current < end && *current != '/' && *current != '?' && *current != '#')
+            current++;
+    }
+
+    guint segments = 0;
+    guint dot_segments = 0;
+    while (current < end && *current != '?' && *current != '#') {
+        if (*current == '/')
+            current++;
+
+        const gchar* segment = current;
+        while (current < end && *current != '/' && *current != '?' && *current != '#')
+            current++;
+
+        segments++;
+        if (upg_is_dot_segment(segment, current))
+            dot_segments++;
+    }
+
+    if (limits->max_segments != 0 && segments > limits->max_segments) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_LIMIT,
+            "URI has %u path segments, but the limit is %u", segments, limits->max_segments);
+        return FALSE;
+    }
+
+    if (limits->max_dot_segments != 0 && dot_segments > limits->max_dot_segments) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_LIMIT,
+            "URI has %u dot segments, but the limit is %u", dot_segments, limits->max_dot_segments);
+        return FALSE;
+    }
+
+    if (limits->max_query_params != 0 && current < end && *current == '?') {
+        guint params = 1;
+        while (++current < end && *current != '#') {
+            if (*current == '&')
+                params++;
+        }
+
+        if (params > limits->max_query_params) {
+            g_set_error(error, UPG_ERROR, UPG_ERR_LIMIT,
+                "URI has %u query parameters, but the limit is %u", params, limits->max_query_params);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+ * upg_uri_configure_from_buffer:
+ * @self: The URI object to reset.
+ * @buffer: (transfer full): The nul-terminated text to parse.
+ * @len: The length of @buffer.
+ * @error: A #GError.
+ *
+ * Parses @buffer into @self, which keeps it for as long as the parsed URI
+ * points into it.
+ *
+ * Returns: Whether or not the operation succeeded.
+ */
+static gboolean upg_uri_configure_from_buffer(UpgUri* self, gchar* buffer, gsize len, GError** error)
+{
+    UriUriA parsed;
+    if (!upg_uri_parse_range(&parsed, buffer, buffer + len, NULL, error)) {
+        g_free(buffer);
+        return FALSE;
+    }
+
+    upg_uri_notify_changes(self, upg_uri_install_internal_uri(self, &parsed, NULL, buffer));
+    return TRUE;
+}
+
 /**
  * upg_uri_configure_from_string:
  * @self: The URI object to reset.
@@ -505,6 +792,9 @@ UpgUri* upg_uri_new(const gchar* uri, GError** error)
  *
  * If @nuri is %NULL, then disposes of the object; i.e. the URI is cleared.
  *
+ * If @self has limits, from upg_uri_new_full() or upg_uri_set_limits(), @nuri
+ * is checked against them first; if it goes over them, @self isn't changed.
+ *
  * Returns: Whether or not the operation succeeded.
  */
 gboolean upg_uri_configure_from_string(UpgUri* self, const gchar* nuri, GError** error)
@@ -513,154 +803,681 @@ gboolean upg_uri_configure_from_string(UpgUri* self, const gchar* nuri, GError**
     g_return_val_if_fail(UPG_IS_URI(self), FALSE);
 
     if (nuri == NULL || *nuri == '\0') {
+        UpgUriPrivate* priv = upg_uri_get_instance_private(self);
+        UriUriA empty;
+        memset(&empty, 0, sizeof(UriUriA));
+        guint32 changed = upg_uriuri_diff(&priv->internal_uri, &empty);
+
         upg_uri_reset(self);
+        upg_uri_notify_changes(self, changed);
         return TRUE;
     }
 
-    char* dupd = g_strdup(nuri);
-
-    UriUriA parsed;
-    int ret = 0;
-    if ((ret = uriParseSingleUriA(&parsed, dupd, NULL)) != URI_SUCCESS) {
-        g_set_error(error, upg_error_quark(), UPG_ERR_PARSE,
-            "Failed to parse URI: %s", upg_strurierror(ret));
-        g_free(dupd);
-        return FALSE;
-    }
-
-    if ((ret = uriNormalizeSyntaxA(&parsed)) != URI_SUCCESS) {
-        g_set_error(error, upg_error_quark(), UPG_ERR_NORMALIZE,
-            "Failed to normalize URI: %s", upg_strurierror(ret));
-        g_free(dupd);
+    gsize len = strlen(nuri);
+    UpgUriPrivate* priv = upg_uri_get_instance_private(self);
+    if (!upg_limits_check(&priv->limits, nuri, len, error)) {
         return FALSE;
     }
 
-    gboolean success = upg_uri_set_internal_uri(self, &parsed);
-    UpgUriPrivate* priv = upg_uri_get_instance_private(self);
-    priv->wanted = dupd;
-    return success;
+    return upg_uri_configure_from_buffer(self, g_strndup(nuri, len), len, error);
 }
 
-/*
- * upg_uri_set_internal_uri:
- * @self: The URI to configure.
- * @uri: (transfer none) (not nullable): The UriUriA object to use.
- *
- * > Avoid this API. It may break in future if the underlying parser is changed,
- * > or something else happens. This function should still be there, if ABI
- * > compatibility is a concern, but make sure to check the return value and
- * > have a backup plan.
- *
- * Sets the internal URI object of @self.
- *
- * Returns: Whether or not the operation succeeded.
+/**
+ * upg_uri_is_valid:
+ * @uri: (array length=len) (nullable): The text to check, or %NULL.
+ * @len: The length of @uri in bytes, or -1 if it is nul-terminated.
+ * @error_offset: (out) (optional): Where to put the offset of the first byte
+ *                that couldn't be parsed.
+ *
+ * Checks whether @uri is a valid URI (or relative reference), without making
+ * a #UpgUri. The URI is parsed into a buffer on the stack and thrown away, so
+ * nothing is copied, normalized or allocated unless the path has about a
+ * hundred segments or more. It's meant for validating lots of input where
+ * only the answer matters. No #UpgLimits are checked.
+ *
+ * %NULL and the empty string are valid, like in upg_uri_new().
+ *
+ * Returns: Whether @uri is valid; if not, @error_offset is set, and if it is,
+ * @error_offset isn't changed.
  */
-static gboolean upg_uri_set_internal_uri(UpgUri* _self, void* uri)
+gboolean upg_uri_is_valid(const gchar* uri, gssize len, gsize* error_offset)
 {
-    g_return_val_if_fail(UPG_IS_URI(_self), FALSE);
+    g_return_val_if_fail(uri != NULL || len <= 0, FALSE);
 
-    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    if (uri == NULL) {
+        return TRUE;
+    }
 
-    upg_uri_reset(_self);
+    if (len < 0) {
+        len = strlen(uri);
+    }
 
-    memcpy(&self->internal_uri, uri, sizeof(UriUriA));
+    // liburiparser allocates a little for each path segment and for IP
+    // addresses, which the stack buffer is plenty for in practice
+    guint8 buffer[4096];
+    UpgArena arena;
+    upg_arena_init(&arena, buffer, sizeof(buffer));
 
-    self->original_scheme = self->internal_uri.scheme;
-    self->original_userinfo = self->internal_uri.userInfo;
-    self->original_hostdata = self->internal_uri.hostData;
-    self->original_host = self->internal_uri.hostText;
-    self->original_segment = self->internal_uri.pathHead;
-    self->original_query = self->internal_uri.query;
-    self->original_fragment = self->internal_uri.fragment;
-    self->original_port = self->internal_uri.portText;
+    UriUriA parsed;
+    const gchar* error_pos = NULL;
+    gboolean valid = uriParseSingleUriExMmA(&parsed, uri, uri + len, &error_pos, &arena.memory) == URI_SUCCESS;
 
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_SCHEME]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_USERINFO]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_HOST]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_PATH]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_PATHSTR]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_QUERY]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_QUERYSTR]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_FRAGMENT]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_FRAGMENTPARAMS]);
+    // everything went into the arena, so this only frees what overflowed it
+    upg_arena_clear(&arena);
 
-    return TRUE;
+    if (!valid && error_offset != NULL) {
+        *error_offset = error_pos != NULL ? (gsize)(error_pos - uri) : (gsize)len;
+    }
+    return valid;
 }
 
 /**
- * upg_uri_to_string:
- * @self: The URI to convert to a string.
+ * upg_uri_new_utf16:
+ * @uri: (array length=len) (nullable): The input URI, as UTF-16, or %NULL.
+ * @len: The length of @uri in code units, or -1 if it is nul-terminated.
+ * @error: A #GError.
  *
- * Converts the in-memory URI object into a string. Returns %NULL if the object
- * doesn't have a URI.
+ * Creates a new #UpgUri by parsing @uri, like upg_uri_new(). See
+ * upg_uri_configure_from_utf16() for how the UTF-16 is handled.
  *
- * Returns: (transfer full): The textual representation of the URI.
+ * Returns: (transfer full): a new #UpgUri if the parsing was successful, or
+ * %NULL.
  */
-gchar* upg_uri_to_string(UpgUri* _self)
+UpgUri* upg_uri_new_utf16(const gunichar2* uri, glong len, GError** error)
 {
-    g_return_val_if_fail(UPG_IS_URI(_self), NULL);
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
 
-    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    UpgUri* self = upg_uri_new(NULL, NULL);
+    if (!upg_uri_configure_from_utf16(self, uri, len, error)) {
+        g_object_unref(self);
+        return NULL;
+    }
 
-    return upg_uriuri_to_string(&self->internal_uri);
+    return self;
 }
 
-/*
- * upg_uriuri_to_string:
- * @self: The URI to convert.
+/**
+ * upg_uri_configure_from_utf16:
+ * @self: The URI object to reset.
+ * @nuri: (array length=len) (nullable): The new URI, as UTF-16, or %NULL.
+ * @len: The length of @nuri in code units, or -1 if it is nul-terminated.
+ * @error: A #GError.
  *
- * Converts @self to a string.
+ * Sets the current URI for the given #UpgUri, like
+ * upg_uri_configure_from_string(), but from UTF-16 text.
  *
- * Returns: (transfer full): @self as a string.
+ * A URI can only have ASCII in it, so each code unit is narrowed to a byte on
+ * the way into the buffer that @self keeps; there's no separate conversion to
+ * UTF-8 first. Anything outside ASCII is a %UPG_ERR_PARSE error, just like it
+ * would have been after converting.
+ *
+ * Returns: Whether or not the operation succeeded.
  */
-static gchar* upg_uriuri_to_string(UriUriA* self)
+gboolean upg_uri_configure_from_utf16(UpgUri* self, const gunichar2* nuri, glong len, GError** error)
 {
-    int len;
-    int ret;
-    if ((ret = uriToStringCharsRequiredA(self, &len)) != URI_SUCCESS) {
-        g_error("Failed to calculate required length of URI string: %s", upg_strurierror(ret));
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+    g_return_val_if_fail(UPG_IS_URI(self), FALSE);
+
+    if (nuri != NULL && len < 0) {
+        for (len = 0; nuri[len] != 0; len++) {
+        }
     }
-    len += 1;
 
-    gchar* out = g_malloc0_n(len, sizeof(char));
-    int written;
-    if ((ret = uriToStringA(out, self, len, &written)) != URI_SUCCESS) {
-        g_error("Failed to convert a UpgUri to a string: %s", upg_strurierror(ret));
+    if (nuri == NULL || len == 0) {
+        return upg_uri_configure_from_string(self, NULL, error);
     }
 
-    if (!g_utf8_validate_len(out, written - 1, NULL)) {
-        g_error("URI converted to a string wasn't valid UTF-8");
+    UpgUriPrivate* priv = upg_uri_get_instance_private(self);
+    // check the length before allocating anything for it
+    if (priv->limits.max_length != 0 && (gsize)len > priv->limits.max_length) {
+        g_set_error(error, UPG_ERROR, UPG_ERR_LIMIT,
+            "URI is %ld code units long, but the limit is %" G_GSIZE_FORMAT, len, priv->limits.max_length);
+        return FALSE;
     }
 
-    return out;
+    gchar* narrow = g_malloc(len + 1);
+    for (glong i = 0; i < len; i++) {
+        if (nuri[i] == 0 || nuri[i] > 0x7f) {
+            g_set_error(error, UPG_ERROR, UPG_ERR_PARSE,
+                "Failed to parse URI: code unit %ld isn't ASCII", i);
+            g_free(narrow);
+            return FALSE;
+        }
+        narrow[i] = (gchar)nuri[i];
+    }
+    narrow[len] = '\0';
+
+    if (!upg_limits_check(&priv->limits, narrow, len, error)) {
+        g_free(narrow);
+        return FALSE;
+    }
+
+    return upg_uri_configure_from_buffer(self, narrow, len, error);
 }
 
-/**
- * upg_uri_set_scheme:
- * @self: The URI to set the scheme of.
- * @nscheme: (transfer none) (nullable): The new scheme.
+/*
+ * __upg_uri_parse_range__:
+ * @out: (out caller-allocates): The UriUriA to parse into.
+ * @first: (not nullable): The start of the text to parse.
+ * @after_last: (not nullable): The end of the text to parse.
+ * @memory: (nullable): The memory manager to allocate with, or %NULL.
+ * @error: A #GError.
  *
- * Sets (or, if @nscheme is %NULL, unsets) the scheme of the URI.
+ * > This is an internal function! Do not use!
+ *
+ * Parses and normalizes the text between @first and @after_last into @out,
+ * allocating through @memory. The text must outlive @out. If this fails, @out
+ * is left empty and @error is set.
+ *
+ * Returns: Whether or not the operation succeeded.
  */
-void upg_uri_set_scheme(UpgUri* _self, const gchar* nscheme)
+gboolean __upg_uri_parse_range__(UriUriA* out, const gchar* first, const gchar* after_last, UriMemoryManager* memory, GError** error)
 {
-    g_return_if_fail(UPG_IS_URI(_self));
+    g_return_val_if_fail(out != NULL, FALSE);
+    g_return_val_if_fail(first != NULL && after_last != NULL, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
 
-    UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    int ret = 0;
+    const gchar* error_pos = NULL;
+    if ((ret = uriParseSingleUriExMmA(out, first, after_last, &error_pos, memory)) != URI_SUCCESS) {
+        if (error_pos != NULL) {
+            g_set_error(error, upg_error_quark(), UPG_ERR_PARSE,
+                "Failed to parse URI: %s at offset %" G_GSIZE_FORMAT, upg_strurierror(ret), (gsize)(error_pos - first));
+        } else {
+            g_set_error(error, upg_error_quark(), UPG_ERR_PARSE,
+                "Failed to parse URI: %s", upg_strurierror(ret));
+        }
+        return FALSE;
+    }
 
-    if (uri->modified & MASK_SCHEME) {
-        upg_free_utr(uri->internal_uri.scheme);
+    if ((ret = uriNormalizeSyntaxExMmA(out, (unsigned int)-1, memory)) != URI_SUCCESS) {
+        g_set_error(error, upg_error_quark(), UPG_ERR_NORMALIZE,
+            "Failed to normalize URI: %s", upg_strurierror(ret));
+        uriFreeUriMembersMmA(out, memory);
+        return FALSE;
     }
-    uri->modified |= MASK_SCHEME;
-    uri->internal_uri.scheme = uritextrange_from_str(nscheme);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_SCHEME]);
-}
 
-/**
- * upg_uri_get_scheme:
- * @self: The URI to get the scheme of.
+    return TRUE;
+}
 
- * Gets the current URI scheme for the given #UpgUri object. If the #UpgUri
+/*
+ * __upg_uri_take_internal__:
+ * @self: The URI to configure.
+ * @uri: (transfer full) (not nullable): The parsed UriUriA to take.
+ * @memory: (nullable): The memory manager @uri was allocated with.
+ * @buffer: (transfer full) (nullable): A g_malloc()ed buffer that @uri points
+ *          into, or %NULL.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Replaces the contents of @self with @uri. @memory must stay alive until @self
+ * is reset or reconfigured; @buffer is freed then.
+ *
+ * Nothing is notified, since a notify handler could use or change whatever the
+ * caller is still setting up. Once it's done, the caller passes the result to
+ * upg_uri_notify_changes(); a URI that was only just made can't be watched, so
+ * that can be skipped.
+ *
+ * Returns: The properties that changed, for upg_uri_notify_changes().
+ */
+guint32 __upg_uri_take_internal__(UpgUri* self, UriUriA* uri, UriMemoryManager* memory, gchar* buffer)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), 0);
+
+    return upg_uri_install_internal_uri(self, uri, memory, buffer);
+}
+
+/*
+ * upg_host_has_non_ascii:
+ * @range: The host text.
+ *
+ * Checks whether @range has percent-encoded bytes outside ASCII, which in a
+ * registered name are UTF-8 for an internationalized domain name.
+ *
+ * Returns: Whether there are any.
+ */
+static gboolean upg_host_has_non_ascii(UriTextRangeA range)
+{
+    for (const gchar* current = range.first; current != NULL && current + 2 < range.afterLast; current++) {
+        if (*current == '%' && g_ascii_xdigit_value(current[1]) >= 8 && g_ascii_isxdigit(current[2])) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * __upg_uriuri_idna_host__:
+ * @uri: A URI that was just parsed.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Works out the ASCII form of an internationalized registered name in @uri,
+ * so that the same host is always written the same way.
+ *
+ * Returns: (transfer full) (nullable): The ASCII host, or %NULL if the host
+ * doesn't need changing or isn't valid.
+ */
+gchar* __upg_uriuri_idna_host__(const UriUriA* uri)
+{
+    if (uri->hostData.ip4 != NULL || uri->hostData.ip6 != NULL || uri->hostData.ipFuture.first != NULL
+        || !upg_host_has_non_ascii(uri->hostText)) {
+        return NULL;
+    }
+
+    return upg_idna_to_ascii(uri->hostText.first, uri->hostText.afterLast - uri->hostText.first);
+}
+
+/*
+ * upg_uri_install_internal_uri:
+ * @self: The URI to configure.
+ * @uri: (transfer none) (not nullable): The UriUriA object to use.
+ * @memory: (nullable): The memory manager @uri was allocated with.
+ * @buffer: (transfer full) (nullable): A g_malloc()ed buffer that @uri points
+ *          into, or %NULL.
+ *
+ * Replaces the contents of @self with @uri, without telling anyone yet, so
+ * that everything is in place before a notify handler can look at @self or
+ * change it again. The result has to be passed to upg_uri_notify_changes().
+ *
+ * If @uri has a host but its host data isn't filled in, because it was put
+ * together or is a registered name, the host is classified like
+ * upg_uri_set_host() does, so that it's written with brackets and has the
+ * right type.
+ *
+ * Returns: A mask of PROP_BIT()s for the properties that changed.
+ */
+static guint32 upg_uri_install_internal_uri(UpgUri* _self, const UriUriA* uri, UriMemoryManager* memory, gchar* buffer)
+{
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+
+    // an internationalized host is stored in its ASCII form, so compare
+    // against that, or parsing the same URI again would look like a change
+    UriUriA incoming = *uri;
+    gchar* ascii = upg_uriuri_idna_host(&incoming);
+    if (ascii != NULL) {
+        incoming.hostText = (UriTextRangeA) { ascii, ascii + strlen(ascii) };
+    }
+    guint32 changed = upg_uriuri_diff(&self->internal_uri, &incoming);
+
+    upg_uri_reset(_self);
+
+    memcpy(&self->internal_uri, uri, sizeof(UriUriA));
+    self->memory = memory;
+    self->buffer = buffer;
+
+    self->original_scheme = self->internal_uri.scheme;
+    self->original_userinfo = self->internal_uri.userInfo;
+    self->original_hostdata = self->internal_uri.hostData;
+    self->original_host = self->internal_uri.hostText;
+    self->original_segment = self->internal_uri.pathHead;
+    self->original_query = self->internal_uri.query;
+    self->original_fragment = self->internal_uri.fragment;
+    self->original_port = self->internal_uri.portText;
+    self->port = upg_port_from_range(self->internal_uri.portText);
+    if (ascii != NULL) {
+        self->modified |= MASK_HOST;
+        self->internal_uri.hostText = incoming.hostText;
+    }
+
+    const UriHostDataA* data = &self->internal_uri.hostData;
+    if (data->ip4 == NULL && data->ip6 == NULL && data->ipFuture.first == NULL) {
+        upg_uri_classify_host(self);
+    }
+
+    return changed;
+}
+
+/*
+ * upg_uri_set_internal_uri:
+ * @self: The URI to configure.
+ * @uri: (transfer none) (not nullable): The UriUriA object to use.
+ * @memory: (nullable): The memory manager @uri was allocated with.
+ *
+ * > Avoid this API. It may break in future if the underlying parser is changed,
+ * > or something else happens. This function should still be there, if ABI
+ * > compatibility is a concern, but make sure to check the return value and
+ * > have a backup plan.
+ *
+ * Sets the internal URI object of @self.
+ *
+ * Returns: Whether or not the operation succeeded.
+ */
+static gboolean upg_uri_set_internal_uri(UpgUri* self, void* uri, UriMemoryManager* memory)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), FALSE);
+
+    upg_uri_notify_changes(self, upg_uri_install_internal_uri(self, uri, memory, NULL));
+    return TRUE;
+}
+
+/*
+ * upg_uriuri_path_equal:
+ * @a: The first URI.
+ * @b: The second URI.
+ *
+ * Checks whether the path segments of @a and @b are the same.
+ *
+ * Returns: Whether the paths are equal.
+ */
+static gboolean upg_uriuri_path_equal(const UriUriA* a, const UriUriA* b)
+{
+    const UriPathSegmentA* current_a = a->pathHead;
+    const UriPathSegmentA* current_b = b->pathHead;
+
+    while (current_a != NULL && current_b != NULL) {
+        if (!uritextrange_equal(current_a->text, current_b->text)) {
+            return FALSE;
+        }
+
+        current_a = current_a->next;
+        current_b = current_b->next;
+    }
+
+    return current_a == current_b;
+}
+
+/*
+ * upg_uriuri_diff:
+ * @a: The old URI.
+ * @b: The new URI.
+ *
+ * Works out which properties would change if @a became @b.
+ *
+ * Returns: A mask of PROP_BIT()s for the properties that differ.
+ */
+static guint32 upg_uriuri_diff(const UriUriA* a, const UriUriA* b)
+{
+    guint32 changed = 0;
+
+    if (!uritextrange_equal(a->scheme, b->scheme))
+        changed |= PROP_BIT(PROP_SCHEME);
+    if (!uritextrange_equal(a->userInfo, b->userInfo))
+        changed |= PROP_BIT(PROP_USERINFO) | PROP_BIT(PROP_USERNAME);
+    if (!uritextrange_equal(a->hostText, b->hostText))
+        changed |= PROP_BIT(PROP_HOST);
+    if (!uritextrange_equal(a->portText, b->portText))
+        changed |= PROP_BIT(PROP_PORT);
+    if (!upg_uriuri_path_equal(a, b))
+        changed |= PROP_BIT(PROP_PATH) | PROP_BIT(PROP_PATHSTR);
+    if (!uritextrange_equal(a->query, b->query))
+        changed |= PROP_BIT(PROP_QUERY) | PROP_BIT(PROP_QUERYSTR);
+    if (!uritextrange_equal(a->fragment, b->fragment))
+        changed |= PROP_BIT(PROP_FRAGMENT) | PROP_BIT(PROP_FRAGMENTPARAMS);
+
+    return changed;
+}
+
+/*
+ * upg_uri_is_watched:
+ * @self: The URI that changed.
+ * @pspec: The property that changed.
+ *
+ * Checks whether anything would notice a notification for @pspec, so that we
+ * don't go through the signal machinery (and let bindings call the getters)
+ * when nobody is listening.
+ *
+ * Returns: Whether @pspec is being watched on @self.
+ */
+static gboolean upg_uri_is_watched(UpgUri* self, GParamSpec* pspec)
+{
+    if (G_OBJECT_GET_CLASS(self)->notify != NULL) {
+        return TRUE;
+    }
+
+    return g_signal_has_handler_pending(self, notify_signal_id, 0, FALSE)
+        || g_signal_has_handler_pending(self, notify_signal_id, g_param_spec_get_name_quark(pspec), FALSE);
+}
+
+/*
+ * __upg_uri_notify_changes__:
+ * @self: The URI that changed.
+ * @changed: A mask of PROP_BIT()s that changed.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Emits #GObject::notify for each property in @changed that someone is
+ * watching. If there is more than one, they're queued up with
+ * g_object_freeze_notify() so that handlers see the finished URI.
+ */
+void __upg_uri_notify_changes__(UpgUri* self, guint32 changed)
+{
+    GParamSpec* pending[_N_PROPERTIES_];
+    guint n_pending = 0;
+
+    for (guint id = 1; changed != 0 && id < _N_PROPERTIES_; id++) {
+        if ((changed & PROP_BIT(id)) && upg_uri_is_watched(self, params[id])) {
+            pending[n_pending++] = params[id];
+        }
+    }
+
+    if (n_pending == 0) {
+        return;
+    }
+
+    if (n_pending == 1) {
+        g_object_notify_by_pspec(G_OBJECT(self), pending[0]);
+        return;
+    }
+
+    g_object_freeze_notify(G_OBJECT(self));
+    for (guint i = 0; i < n_pending; i++) {
+        g_object_notify_by_pspec(G_OBJECT(self), pending[i]);
+    }
+    g_object_thaw_notify(G_OBJECT(self));
+}
+
+/**
+ * upg_uri_to_string:
+ * @self: The URI to convert to a string.
+ *
+ * Converts the in-memory URI object into a string. Returns %NULL if the object
+ * doesn't have a URI.
+ *
+ * Returns: (transfer full): The textual representation of the URI.
+ */
+gchar* upg_uri_to_string(UpgUri* _self)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), NULL);
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+
+    return upg_uriuri_to_string(&self->internal_uri);
+}
+
+/**
+ * upg_uri_to_string_buf:
+ * @self: The URI to convert to a string.
+ * @buf: (array length=cap) (element-type gchar): Where to write the string.
+ * @cap: The size of @buf, including room for the nul.
+ * @written: (out) (optional): Where to put the length of the string.
+ *
+ * Writes @self into @buf as a nul-terminated string, without allocating. If
+ * it fits, returns %TRUE and puts the length of the string (without the nul)
+ * in @written.
+ *
+ * If @buf is too small, returns %FALSE and puts the length that is needed
+ * (again, without the nul) in @written instead. The contents of @buf are
+ * unspecified then.
+ *
+ * Returns: Whether @self fit into @buf.
+ */
+gboolean upg_uri_to_string_buf(UpgUri* _self, gchar* buf, gsize cap, gsize* written)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), FALSE);
+    g_return_val_if_fail(buf != NULL || cap == 0, FALSE);
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+
+    int chars = 0;
+    int ret = cap == 0 ? URI_ERROR_OUTPUT_TOO_LARGE
+                       : uriToStringA(buf, &self->internal_uri, (int)MIN(cap, G_MAXINT), &chars);
+
+    if (ret == URI_SUCCESS) {
+        if (written != NULL) {
+            *written = chars - 1;
+        }
+        return TRUE;
+    }
+
+    if (ret != URI_ERROR_OUTPUT_TOO_LARGE) {
+        g_error("Failed to convert a UpgUri to a string: %s", upg_strurierror(ret));
+    }
+
+    if (written != NULL) {
+        if ((ret = uriToStringCharsRequiredA(&self->internal_uri, &chars)) != URI_SUCCESS) {
+            g_error("Failed to calculate required length of URI string: %s", upg_strurierror(ret));
+        }
+        *written = chars;
+    }
+    return FALSE;
+}
+
+/**
+ * upg_uri_append_to_gstring:
+ * @self: The URI to convert to a string.
+ * @str: (transfer none) (not nullable): The #GString to append to.
+ *
+ * Appends the textual representation of @self to the end of @str. This only
+ * allocates if @str has to grow, so reusing a #GString for lots of URIs avoids
+ * allocating for each of them.
+ */
+void upg_uri_append_to_gstring(UpgUri* _self, GString* str)
+{
+    g_return_if_fail(UPG_IS_URI(_self));
+    g_return_if_fail(str != NULL);
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+
+    int len;
+    int ret;
+    if ((ret = uriToStringCharsRequiredA(&self->internal_uri, &len)) != URI_SUCCESS) {
+        g_error("Failed to calculate required length of URI string: %s", upg_strurierror(ret));
+    }
+
+    gsize offset = str->len;
+    g_string_set_size(str, offset + len);
+
+    // g_string_set_size() leaves room for the nul, which uriToStringA() wants
+    if ((ret = uriToStringA(str->str + offset, &self->internal_uri, len + 1, NULL)) != URI_SUCCESS) {
+        g_error("Failed to convert a UpgUri to a string: %s", upg_strurierror(ret));
+    }
+}
+
+/**
+ * upg_uri_write_to_stream:
+ * @self: The URI to write.
+ * @stream: (transfer none) (not nullable): The stream to write to.
+ * @cancellable: (nullable): A #GCancellable, or %NULL.
+ * @error: A #GError.
+ *
+ * Writes the textual representation of @self to @stream, without making a
+ * string out of it first. Nothing else, like a newline, is written. If you're
+ * writing lots of URIs, use #UpgUriWriter instead.
+ *
+ * Returns: Whether the write succeeded; if not, @error is set.
+ */
+gboolean upg_uri_write_to_stream(UpgUri* self, GOutputStream* stream, GCancellable* cancellable, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), FALSE);
+    g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    gchar buf[1024];
+    gsize len;
+    if (upg_uri_to_string_buf(self, buf, sizeof(buf), &len)) {
+        return g_output_stream_write_all(stream, buf, len, NULL, cancellable, error);
+    }
+
+    gchar* big = g_malloc(len + 1);
+    upg_uri_to_string_buf(self, big, len + 1, NULL);
+    gboolean ret = g_output_stream_write_all(stream, big, len, NULL, cancellable, error);
+    g_free(big);
+    return ret;
+}
+
+/*
+ * upg_scratch_get:
+ *
+ * Gets an empty #GString that belongs to the current thread, for when a URI
+ * has to be turned into text only to be looked at. Don't hold on to it across
+ * calls to anything that might use it too.
+ *
+ * Returns: (transfer none): the scratch string, truncated.
+ */
+static GString* upg_scratch_get(void)
+{
+    static GPrivate scratch = G_PRIVATE_INIT(upg_scratch_free);
+
+    GString* str = g_private_get(&scratch);
+    if (str == NULL) {
+        str = g_string_sized_new(256);
+        g_private_set(&scratch, str);
+    }
+
+    g_string_truncate(str, 0);
+    return str;
+}
+
+/*
+ * upg_uriuri_to_string:
+ * @self: The URI to convert.
+ *
+ * Converts @self to a string.
+ *
+ * Returns: (transfer full): @self as a string.
+ */
+static gchar* upg_uriuri_to_string(UriUriA* self)
+{
+    int len;
+    int ret;
+    if ((ret = uriToStringCharsRequiredA(self, &len)) != URI_SUCCESS) {
+        g_error("Failed to calculate required length of URI string: %s", upg_strurierror(ret));
+    }
+    len += 1;
+
+    gchar* out = g_malloc0_n(len, sizeof(char));
+    int written;
+    if ((ret = uriToStringA(out, self, len, &written)) != URI_SUCCESS) {
+        g_error("Failed to convert a UpgUri to a string: %s", upg_strurierror(ret));
+    }
+
+    if (!g_utf8_validate_len(out, written - 1, NULL)) {
+        g_error("URI converted to a string wasn't valid UTF-8");
+    }
+
+    return out;
+}
+
+/**
+ * upg_uri_set_scheme:
+ * @self: The URI to set the scheme of.
+ * @nscheme: (transfer none) (nullable): The new scheme.
+ *
+ * Sets (or, if @nscheme is %NULL, unsets) the scheme of the URI.
+ */
+void upg_uri_set_scheme(UpgUri* _self, const gchar* nscheme)
+{
+    g_return_if_fail(UPG_IS_URI(_self));
+
+    UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    if (uritextrange_is(uri->internal_uri.scheme, nscheme)) {
+        return;
+    }
+
+    if (uri->modified & MASK_SCHEME) {
+        upg_free_utr(uri->internal_uri.scheme);
+    }
+    uri->modified |= MASK_SCHEME;
+    uri->internal_uri.scheme = uritextrange_from_str(nscheme);
+    upg_uri_notify_changes(_self, PROP_BIT(PROP_SCHEME));
+}
+
+/**
+ * upg_uri_get_scheme:
+ * @self: The URI to get the scheme of.
+
+ * Gets the current URI scheme for the given #UpgUri object. If the #UpgUri
  * hasn't been initialized, returns %NULL.
  *
  * Returns: (transfer full) (nullable): The scheme of the URI.
@@ -724,25 +1541,236 @@ guint8* upg_uri_get_host_data(UpgUri* _self, guint8* protocol)
     g_return_val_if_fail(UPG_IS_URI(_self), NULL);
     g_return_val_if_fail(protocol != NULL, NULL);
 
+    UpgHostType type;
+    const guint8* address = upg_uri_get_host_address(_self, &type);
+    if (address == NULL) {
+        *protocol = 0;
+        return NULL;
+    }
+
+    gsize len = type == UPG_HOST_IPV4 ? 4 : 16;
+    *protocol = type == UPG_HOST_IPV4 ? 4 : 6;
+    guint8* ret = g_malloc(len);
+    memcpy(ret, address, len);
+    return ret;
+}
+
+/**
+ * upg_uri_get_host_type:
+ * @self: The URI to check.
+ *
+ * Gets what kind of host @self has. This is worked out when the URI is parsed
+ * or its host is set, so this is just a few comparisons.
+ *
+ * Returns: The kind of host @self has, or %UPG_HOST_NONE if it has none.
+ */
+UpgHostType upg_uri_get_host_type(UpgUri* _self)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), UPG_HOST_NONE);
+
+    UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    const UriHostDataA* data = &uri->internal_uri.hostData;
+
+    if (data->ip4 != NULL)
+        return UPG_HOST_IPV4;
+    if (data->ip6 != NULL)
+        return UPG_HOST_IPV6;
+    if (data->ipFuture.first != NULL)
+        return UPG_HOST_IPVFUTURE;
+    if (uri->internal_uri.hostText.first != NULL)
+        return UPG_HOST_REG_NAME;
+    return UPG_HOST_NONE;
+}
+
+/**
+ * upg_uri_get_host_address:
+ * @self: The URI to get the address of.
+ * @type: (out) (optional): Where to put the kind of host, like
+ *        upg_uri_get_host_type() gives.
+ *
+ * Gets the binary address of the host of @self, in network byte order, if it
+ * is an IPv4 or IPv6 address. Unlike upg_uri_get_host_data(), nothing is
+ * copied, so this is cheap enough to call for every request.
+ *
+ * Returns: (transfer none) (nullable): The 4 bytes of an IPv4 address, the 16
+ * bytes of an IPv6 address, or %NULL for any other kind of host. It's only
+ * valid until @self is changed.
+ */
+const guint8* upg_uri_get_host_address(UpgUri* _self, UpgHostType* type)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), NULL);
+
     UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    const UriHostDataA* data = &uri->internal_uri.hostData;
+    UpgHostType host_type = upg_uri_get_host_type(_self);
+
+    if (type != NULL)
+        *type = host_type;
+
+    if (host_type == UPG_HOST_IPV4)
+        return data->ip4->data;
+    if (host_type == UPG_HOST_IPV6)
+        return data->ip6->data;
+    return NULL;
+}
+
+static gboolean upg_parse_ipv4(const gchar* first, const gchar* after_last, guint8* out)
+{
+    for (guint octet = 0; octet < 4; octet++) {
+        if (octet > 0) {
+            if (first == after_last || *first != '.')
+                return FALSE;
+            first++;
+        }
+
+        const gchar* start = first;
+        guint value = 0;
+        while (first < after_last && first - start < 3 && g_ascii_isdigit(*first)) {
+            value = value * 10 + (*first - '0');
+            first++;
+        }
+
+        // RFC 3986 doesn't allow leading zeroes, since some read them as octal
+        if (first == start || value > 255 || (first - start > 1 && *start == '0'))
+            return FALSE;
+        out[octet] = value;
+    }
 
+    return first == after_last;
+}
+
+static gboolean upg_is_ipvfuture(const gchar* first, const gchar* after_last)
+{
+    if (first == after_last || g_ascii_tolower(*first) != 'v')
+        return FALSE;
+
+    const gchar* current = first + 1;
+    while (current < after_last && g_ascii_isxdigit(*current))
+        current++;
+
+    return current > first + 1 && current < after_last && *current == '.' && current + 1 < after_last;
+}
+
+/*
+ * upg_uri_classify_host:
+ * @uri: The URI whose host has just been set.
+ *
+ * Fills in the host data of @uri from its host text, like the parser would
+ * have. Addresses are stored in @uri itself, rather than being allocated.
+ */
+static void upg_uri_classify_host(UpgUriPrivate* uri)
+{
     UriHostDataA* data = &uri->internal_uri.hostData;
-    if (data->ip4 != NULL) {
-        *protocol = 4;
-        void* ret = g_malloc0(4);
-        memcpy(ret, data->ip4->data, 4);
-        return ret;
+    const gchar* first = uri->internal_uri.hostText.first;
+    const gchar* after_last = uri->internal_uri.hostText.afterLast;
+
+    *data = (UriHostDataA) { NULL, NULL, { NULL, NULL } };
+    if (first == NULL)
+        return;
+
+    // a reg-name can't have a colon in it, so anything else must be bracketed
+    if (memchr(first, ':', after_last - first) == NULL) {
+        if (upg_parse_ipv4(first, after_last, uri->host_address.ip4.data))
+            data->ip4 = &uri->host_address.ip4;
+        return;
     }
 
-    if (data->ip6 != NULL) {
-        *protocol = 6;
-        void* ret = g_malloc0(16);
-        memcpy(ret, data->ip6->data, 16);
-        return ret;
+    if (upg_is_ipvfuture(first, after_last)) {
+        data->ipFuture = uri->internal_uri.hostText;
+        return;
     }
 
-    *protocol = 0;
-    return NULL;
+    // the host text might not be nul-terminated, so GInetAddress gets a copy;
+    // no IPv6 address is longer than 45 characters. Zone identifiers aren't
+    // allowed in URIs, so GInetAddress mustn't see them
+    gchar text[64];
+    if ((gsize)(after_last - first) >= sizeof(text) || memchr(first, '%', after_last - first) != NULL)
+        return;
+    memcpy(text, first, after_last - first);
+    text[after_last - first] = '\0';
+
+    GInetAddress* address = g_inet_address_new_from_string(text);
+    if (address == NULL)
+        return;
+
+    if (g_inet_address_get_family(address) == G_SOCKET_FAMILY_IPV6) {
+        memcpy(uri->host_address.ip6.data, g_inet_address_to_bytes(address), 16);
+        data->ip6 = &uri->host_address.ip6;
+    }
+    g_object_unref(address);
+}
+
+static gboolean upg_host_needs_idna(UriTextRangeA range, gboolean to_unicode)
+{
+    for (const gchar* current = range.first; current < range.afterLast; current++) {
+        if (*current == '%' || (guchar)*current >= 0x80) {
+            return TRUE;
+        }
+
+        // an xn-- label, which is the only thing that changes going to Unicode
+        if (to_unicode && range.afterLast - current >= 4 && (current == range.first || current[-1] == '.')
+            && g_ascii_strncasecmp(current, "xn--", 4) == 0) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * upg_uri_get_host_ascii:
+ * @self: The URI to get the host of.
+ *
+ * Gets the host of @self in its ASCII form, with IDNA `xn--` labels for any
+ * parts that aren't ASCII. Since hosts are converted like this when URIs are
+ * parsed, this is only different to upg_uri_get_host() after
+ * upg_uri_set_host(). IP addresses are given as they are.
+ *
+ * Conversions are cached for the whole process, so converting the same hosts
+ * again and again is cheap.
+ *
+ * Returns: (transfer full) (nullable): The ASCII host, or %NULL if there's no
+ * host or it isn't a valid one.
+ */
+gchar* upg_uri_get_host_ascii(UpgUri* _self)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), NULL);
+
+    UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    UriTextRangeA host = uri->internal_uri.hostText;
+
+    if (upg_uri_get_host_type(_self) != UPG_HOST_REG_NAME || !upg_host_needs_idna(host, FALSE)) {
+        return str_from_uritextrange(host);
+    }
+
+    return upg_idna_to_ascii(host.first, host.afterLast - host.first);
+}
+
+/**
+ * upg_uri_get_host_unicode:
+ * @self: The URI to get the host of.
+ *
+ * Gets the host of @self in its Unicode form, for showing to people: IDNA
+ * `xn--` labels are decoded, and so is any percent-encoding. IP addresses
+ * are given as they are.
+ *
+ * Conversions are cached for the whole process, like with
+ * upg_uri_get_host_ascii().
+ *
+ * Returns: (transfer full) (nullable): The host as UTF-8, or %NULL if there's
+ * no host or it isn't a valid one.
+ */
+gchar* upg_uri_get_host_unicode(UpgUri* _self)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), NULL);
+
+    UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    UriTextRangeA host = uri->internal_uri.hostText;
+
+    if (upg_uri_get_host_type(_self) != UPG_HOST_REG_NAME || !upg_host_needs_idna(host, TRUE)) {
+        return str_from_uritextrange(host);
+    }
+
+    return upg_idna_to_unicode(host.first, host.afterLast - host.first);
 }
 
 /**
@@ -750,25 +1778,28 @@ guint8* upg_uri_get_host_data(UpgUri* _self, guint8* protocol)
  * @self: The URI to set the host of.
  * @host: (transfer none): The host to set the URI to.
  *
- * Sets the URI of @self to @host. The structured data is always reset after
- * this, but in future it might be set properly if @host is a valid IPvX
- * address.
+ * Sets the host of @self to @host. If @host is an IPv4 or IPv6 address, or
+ * an IPvFuture one, that's detected just like when parsing, so
+ * upg_uri_get_host_type() and upg_uri_get_host_address() work afterwards.
+ * IPv6 and IPvFuture addresses are given without the brackets.
  */
 void upg_uri_set_host(UpgUri* _self, const gchar* host)
 {
     g_return_if_fail(UPG_IS_URI(_self));
 
     UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    if (uritextrange_is(uri->internal_uri.hostText, host)) {
+        return;
+    }
 
     if (uri->modified & MASK_HOST) {
         upg_free_utr(uri->internal_uri.hostText);
     }
 
-    // FIXME we should probably parse the incoming host to check if it's IPvX
     uri->modified |= MASK_HOST;
-    uri->internal_uri.hostData = (UriHostDataA) { NULL, NULL, { NULL, NULL } };
     uri->internal_uri.hostText = uritextrange_from_str(host);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_HOST]);
+    upg_uri_classify_host(uri);
+    upg_uri_notify_changes(_self, PROP_BIT(PROP_HOST));
 }
 
 /**
@@ -789,34 +1820,93 @@ GList* upg_uri_get_path(UpgUri* _self)
 {
     g_return_val_if_fail(UPG_IS_URI(_self), NULL);
 
-    UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
-    if (uri->internal_uri.pathHead == NULL) {
-        return NULL;
-    }
+    gsize n_segments = 0;
+    const UpgSlice* segments = upg_uri_get_path_segments(_self, &n_segments);
 
     GList* list = NULL;
-    const UriPathSegmentA start = { { "", "" }, uri->internal_uri.pathHead };
-    const UriPathSegmentA* current = &start;
+    for (gsize i = n_segments; i > 0; i--) {
+        list = g_list_prepend(list, g_strndup(segments[i - 1].data, segments[i - 1].len));
+    }
 
-    if (current == NULL) {
-        return NULL;
+    return list;
+}
+
+/**
+ * upg_uri_get_path_segments:
+ * @self: The URI to get the path segments of.
+ * @n_segments: (out) (optional): Where to put the number of segments.
+ *
+ * Gets the path segments of @self as an array of slices, which point into
+ * @self. Unlike upg_uri_get_path(), nothing is copied; the array is made the
+ * first time it's asked for, and kept until the path changes.
+ *
+ * The array, and the text it points to, belong to @self, and are only valid
+ * until @self is changed. Use upg_uri_get_path_strv() if you need to keep the
+ * segments around.
+ *
+ * Returns: (transfer none) (array length=n_segments) (nullable): The path
+ * segments; possibly %NULL if there are none.
+ */
+const UpgSlice* upg_uri_get_path_segments(UpgUri* _self, gsize* n_segments)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), NULL);
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    if (!self->segments_valid) {
+        if (self->segments == NULL) {
+            self->segments = g_array_new(FALSE, FALSE, sizeof(UpgSlice));
+        }
+
+        g_array_set_size(self->segments, 0);
+        for (const UriPathSegmentA* current = self->internal_uri.pathHead; current != NULL; current = current->next) {
+            UpgSlice slice = { current->text.first, current->text.afterLast - current->text.first };
+            g_array_append_val(self->segments, slice);
+
+            if (current == self->internal_uri.pathTail) {
+                break;
+            }
+        }
+
+        self->segments_valid = TRUE;
     }
 
-    do {
-        current = current->next;
-        list = g_list_prepend(list, str_from_uritextrange(current->text));
-    } while (current != NULL && current != uri->internal_uri.pathTail);
-    list = g_list_reverse(list);
+    if (n_segments != NULL) {
+        *n_segments = self->segments->len;
+    }
 
-    return list;
+    return (const UpgSlice*)self->segments->data;
+}
+
+/**
+ * upg_uri_get_path_strv:
+ * @self: The URI to get the path segments of.
+ *
+ * Copies the path segments of @self into a new string array.
+ *
+ * Returns: (transfer full) (array zero-terminated=1): The path segments, which
+ * should be freed with g_strfreev().
+ */
+gchar** upg_uri_get_path_strv(UpgUri* self)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), NULL);
+
+    gsize n_segments = 0;
+    const UpgSlice* segments = upg_uri_get_path_segments(self, &n_segments);
+
+    gchar** strv = g_new(gchar*, n_segments + 1);
+    for (gsize i = 0; i < n_segments; i++) {
+        strv[i] = g_strndup(segments[i].data, segments[i].len);
+    }
+    strv[n_segments] = NULL;
+
+    return strv;
 }
 
 /**
  * upg_uri_get_path_str:
  * @self: The URI to get the stringified path for.
  *
- * Takes the path data from upg_uri_get_path() and puts it into a string, using
- * slashes as separators.
+ * Puts the path segments of @self into a string, with a slash before each.
  *
  * If @self hasn't been initialized, returns %NULL.
  *
@@ -826,24 +1916,26 @@ gchar* upg_uri_get_path_str(UpgUri* _self)
 {
     g_return_val_if_fail(UPG_IS_URI(_self), NULL);
 
-    GString* ret = g_string_new(NULL);
-    GList* ocurrent = upg_uri_get_path(_self);
-    GList* current = ocurrent;
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    const UriPathSegmentA* head = self->internal_uri.pathHead;
+    const UriPathSegmentA* tail = self->internal_uri.pathTail;
 
-    if (current == NULL) {
-        g_list_free_full(ocurrent, g_free);
-        g_string_free(ret, TRUE);
-        return g_strdup("");
+    gsize len = 0;
+    for (const UriPathSegmentA* current = head; current != NULL; current = current == tail ? NULL : current->next) {
+        len += 1 + (current->text.afterLast - current->text.first);
     }
 
-    while (current != NULL) {
-        g_string_append_c(ret, '/');
-        g_string_append(ret, (const gchar*)current->data);
-        current = current->next;
+    gchar* ret = g_malloc(len + 1);
+    gchar* out = ret;
+    for (const UriPathSegmentA* current = head; current != NULL; current = current == tail ? NULL : current->next) {
+        gsize segment_len = current->text.afterLast - current->text.first;
+        *out++ = '/';
+        memcpy(out, current->text.first, segment_len);
+        out += segment_len;
     }
+    *out = '\0';
 
-    g_list_free_full(ocurrent, g_free);
-    return g_string_free(ret, FALSE);
+    return ret;
 }
 
 /**
@@ -858,6 +1950,18 @@ void upg_uri_set_path(UpgUri* _self, GList* list)
     g_return_if_fail(UPG_IS_URI(_self));
 
     UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+
+    const UriPathSegmentA* existing = self->internal_uri.pathHead;
+    GList* wanted = list;
+    while (existing != NULL && wanted != NULL && uritextrange_is(existing->text, wanted->data)) {
+        existing = existing->next;
+        wanted = wanted->next;
+    }
+    if (existing == NULL && wanted == NULL) {
+        return;
+    }
+
+    self->segments_valid = FALSE;
     if (self->modified & MASK_PATH) {
         upg_free_upsl(self->internal_uri);
     }
@@ -867,6 +1971,7 @@ void upg_uri_set_path(UpgUri* _self, GList* list)
         self->internal_uri.pathHead = NULL;
         self->internal_uri.pathTail = NULL;
         self->modified |= MASK_PATH;
+        upg_uri_notify_changes(_self, PROP_BIT(PROP_PATH) | PROP_BIT(PROP_PATHSTR));
         return;
     }
 
@@ -880,8 +1985,7 @@ void upg_uri_set_path(UpgUri* _self, GList* list)
     self->internal_uri.pathHead = segments;
     self->internal_uri.pathTail = &segments[len - 1];
     self->modified |= MASK_PATH;
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_PATH]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_PATHSTR]);
+    upg_uri_notify_changes(_self, PROP_BIT(PROP_PATH) | PROP_BIT(PROP_PATHSTR));
 }
 
 /**
@@ -1011,30 +2115,26 @@ void upg_uri_set_query_str(UpgUri* _self, const gchar* nq)
     g_return_if_fail(UPG_IS_URI(_self));
 
     UpgUriPrivate* self = upg_uri_get_instance_private(_self);
-    if (self->modified & MASK_QUERY) {
-        upg_free_utr(self->internal_uri.query);
-    }
 
-    self->modified |= MASK_QUERY;
+    if (nq != NULL && nq[0] == '?') {
+        nq++;
+    }
 
-    if (nq == NULL) {
-        self->internal_uri.query = (UriTextRangeA) { NULL, NULL };
-        return;
+    if (nq != NULL && nq[0] == '\0') {
+        nq = NULL;
     }
 
-    gint len = strlen(nq);
-    if ((nq[0] == '?' && len <= 1) || (len == 0)) {
-        self->internal_uri.query = (UriTextRangeA) { NULL, NULL };
+    if (uritextrange_is(self->internal_uri.query, nq)) {
         return;
     }
 
-    if (nq[0] == '?') {
-        nq++;
+    if (self->modified & MASK_QUERY) {
+        upg_free_utr(self->internal_uri.query);
     }
 
+    self->modified |= MASK_QUERY;
     self->internal_uri.query = uritextrange_from_str(nq);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_QUERY]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_QUERYSTR]);
+    upg_uri_notify_changes(_self, PROP_BIT(PROP_QUERY) | PROP_BIT(PROP_QUERYSTR));
 }
 
 /**
@@ -1086,13 +2186,16 @@ void upg_uri_set_fragment(UpgUri* _self, const gchar* fragment)
     g_return_if_fail(UPG_IS_URI(_self));
 
     UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    if (uritextrange_is(uri->internal_uri.fragment, fragment)) {
+        return;
+    }
+
     if (uri->modified & MASK_FRAGMENT) {
         upg_free_utr(uri->internal_uri.fragment);
     }
     uri->modified |= MASK_FRAGMENT;
     uri->internal_uri.fragment = uritextrange_from_str(fragment);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_FRAGMENT]);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_FRAGMENTPARAMS]);
+    upg_uri_notify_changes(_self, PROP_BIT(PROP_FRAGMENT) | PROP_BIT(PROP_FRAGMENTPARAMS));
 }
 
 /**
@@ -1155,10 +2258,7 @@ guint16 upg_uri_get_port(UpgUri* self)
     g_return_val_if_fail(UPG_IS_URI(self), 0);
 
     UpgUriPrivate* priv = upg_uri_get_instance_private(self);
-    gchar* port_str = str_from_uritextrange(priv->internal_uri.portText);
-    guint ret = port_str ? strtoull(port_str, NULL, 10) : 0;
-    g_free(port_str);
-    return (guint16)ret;
+    return priv->port;
 }
 
 /**
@@ -1174,20 +2274,22 @@ void upg_uri_set_port(UpgUri* _self, guint16 port)
     g_return_if_fail(UPG_IS_URI(_self));
 
     UpgUriPrivate* self = upg_uri_get_instance_private(_self);
-    if (self->modified & MASK_PORT) {
-        upg_free_utr(self->internal_uri.portText);
-    }
-    self->modified |= MASK_PORT;
 
-    if (port == 0) {
-        self->internal_uri.portText = (UriTextRangeA) { NULL, NULL };
+    gchar buf[6];
+    g_ascii_dtostr(buf, 6, port);
+    const gchar* text = port == 0 ? NULL : buf;
+
+    if (uritextrange_is(self->internal_uri.portText, text)) {
         return;
     }
 
-    gchar buf[6];
-    g_ascii_dtostr(buf, 6, port);
-    self->internal_uri.portText = uritextrange_from_str(buf);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_PORT]);
+    if (self->modified & MASK_PORT) {
+        upg_free_utr(self->internal_uri.portText);
+    }
+    self->modified |= MASK_PORT;
+    self->internal_uri.portText = uritextrange_from_str(text);
+    self->port = port;
+    upg_uri_notify_changes(_self, PROP_BIT(PROP_PORT));
 }
 
 /**
@@ -1246,12 +2348,16 @@ void upg_uri_set_userinfo(UpgUri* _self, const gchar* userinfo)
     g_return_if_fail(UPG_IS_URI(_self));
 
     UpgUriPrivate* uri = upg_uri_get_instance_private(_self);
+    if (uritextrange_is(uri->internal_uri.userInfo, userinfo)) {
+        return;
+    }
+
     if (uri->modified & MASK_USERINFO) {
         upg_free_utr(uri->internal_uri.userInfo);
     }
     uri->modified |= MASK_USERINFO;
     uri->internal_uri.userInfo = uritextrange_from_str(userinfo);
-    g_object_notify_by_pspec(G_OBJECT(_self), params[PROP_USERINFO]);
+    upg_uri_notify_changes(_self, PROP_BIT(PROP_USERINFO) | PROP_BIT(PROP_USERNAME));
 }
 
 /**
@@ -1297,7 +2403,7 @@ UpgUri* upg_uri_apply_reference(UpgUri* self, const gchar* reference_str, GError
         goto cleanup;
     }
 
-    upg_uri_set_internal_uri(final, &applied);
+    upg_uri_set_internal_uri(final, &applied, NULL);
 
 cleanup:
     uriFreeUriMembersA(&reference);
@@ -1371,44 +2477,40 @@ gboolean upg_uri_is_parent_of(UpgUri* self, UpgUri* other, guint16 default_port,
     g_return_val_if_fail(self != NULL, FALSE);
     g_return_val_if_fail(other != NULL, FALSE);
 
-    GList* segments_a = upg_uri_get_path(self);
-    GList* segments_b = upg_uri_get_path(other);
-
-    GList* current_a = segments_a;
-    GList* current_b = segments_b;
-    do {
-        if (current_a && g_strcmp0(current_a->data, "") == 0)
-            current_a = NULL;
+    gsize n_a = 0;
+    gsize n_b = 0;
+    const UpgSlice* segments_a = upg_uri_get_path_segments(self, &n_a);
+    const UpgSlice* segments_b = upg_uri_get_path_segments(other, &n_b);
 
-        if (current_b && g_strcmp0(current_b->data, "") == 0)
-            current_b = NULL;
+    for (gsize i = 0;; i++) {
+        /* an empty segment (a trailing slash) ends the path too */
+        gboolean end_a = i >= n_a || segments_a[i].len == 0;
+        gboolean end_b = i >= n_b || segments_b[i].len == 0;
 
-        if (current_a != NULL && current_b == NULL) {
+        if (!end_a && end_b) {
             /* self < other, so clearly not a child */
-            goto cleanup_segments;
+            return FALSE;
         }
 
-        if (current_a == NULL && current_b != NULL) {
+        if (end_a && !end_b) {
             /* self > other, so clearly a child */
             break;
         }
 
-        if (current_a == NULL && current_b == NULL) {
+        if (end_a && end_b) {
             /* self == other, so check what we should do */
             if (flags & UPG_HIERARCHY_NOTSELF)
-                goto cleanup_segments;
+                return FALSE;
             else
                 break;
         }
 
-        g_assert(current_a->data != NULL);
-        g_assert(current_b->data != NULL);
-
-        if (strcmp(current_a->data, current_b->data) != 0) {
+        if (segments_a[i].len != segments_b[i].len
+            || memcmp(segments_a[i].data, segments_b[i].data, segments_a[i].len) != 0) {
             /* a segment is different, so clearly not a child */
-            goto cleanup_segments;
+            return FALSE;
         }
-    } while ((current_a = current_a->next), (current_b = current_b->next), 1);
+    }
 
     gchar* scheme_a = NULL;
     gchar* scheme_b = NULL;
@@ -1451,9 +2553,6 @@ cleanup_strict:
     g_free(scheme_b);
     g_free(userinfo_a);
     g_free(userinfo_b);
-cleanup_segments:
-    g_list_free_full(segments_a, g_free);
-    g_list_free_full(segments_b, g_free);
     return ret;
 }
 
@@ -1469,12 +2568,137 @@ guint upg_uri_hash(gconstpointer self)
 {
     g_return_val_if_fail(UPG_IS_URI((gpointer)self), 0);
 
-    // TODO create a better, more efficient algorithm
-
     // TODO upg_uri_to_string must never change it, but that's not guaranteed
-    gchar* str = upg_uri_to_string(UPG_URI((gpointer)self));
-    guint hash = g_str_hash(str);
-    g_free(str);
+    GString* str = upg_scratch_get();
+    upg_uri_append_to_gstring(UPG_URI((gpointer)self), str);
+    return (guint)upg_hash_bytes(str->str, str->len);
+}
+
+static guint64 upg_fnv1a(guint64 hash, const void* data, gsize len)
+{
+    const guint8* bytes = data;
+    for (gsize i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= G_GUINT64_CONSTANT(0x100000001b3);
+    }
+    return hash;
+}
+
+static guint64 upg_hash_mix(guint64 hash)
+{
+    // the finalizer from MurmurHash3
+    hash ^= hash >> 33;
+    hash *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    hash *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    hash ^= hash >> 33;
+    return hash;
+}
+
+#define UPG_FNV_OFFSET_BASIS G_GUINT64_CONSTANT(0xcbf29ce484222325)
+
+/*
+ * __upg_hash_bytes__:
+ * @data: (array length=len): The bytes to hash.
+ * @len: The number of bytes in @data.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Hashes @data with 64-bit FNV-1a, and then mixes the result so that the low
+ * bits, which hash tables use, depend on all of the input. The result is the
+ * same on every platform and in every run, so it can be stored.
+ *
+ * Returns: The hash of @data.
+ */
+guint64 __upg_hash_bytes__(const void* data, gsize len)
+{
+    return upg_hash_mix(upg_fnv1a(UPG_FNV_OFFSET_BASIS, data, len));
+}
+
+static guint64 upg_hash_range(guint64 hash, guint8 tag, UriTextRangeA range)
+{
+    if (range.first == NULL) {
+        return hash;
+    }
+
+    // the tag keeps "?a" from hashing the same as a path segment "a", and
+    // the length keeps where one part ends from being ambiguous
+    guint32 len = GUINT32_TO_LE((guint32)(range.afterLast - range.first));
+    hash = upg_fnv1a(hash, &tag, 1);
+    hash = upg_fnv1a(hash, &len, sizeof(len));
+    return upg_fnv1a(hash, range.first, range.afterLast - range.first);
+}
+
+/*
+ * upg_uriuri_hash:
+ * @uri: The URI to hash.
+ * @host: The host to hash in place of the one in @uri.
+ *
+ * Hashes each part of @uri in turn, for __upg_uri_hash_components__() and
+ * __upg_uri_hash_parsed__().
+ *
+ * Returns: The hash of @uri.
+ */
+static guint64 upg_uriuri_hash(const UriUriA* uri, UriTextRangeA host)
+{
+    guint64 hash = UPG_FNV_OFFSET_BASIS;
+    hash = upg_hash_range(hash, 's', uri->scheme);
+    hash = upg_hash_range(hash, 'u', uri->userInfo);
+    hash = upg_hash_range(hash, 'h', host);
+    hash = upg_hash_range(hash, 'p', uri->portText);
+    if (uri->absolutePath) {
+        hash = upg_fnv1a(hash, "a", 1);
+    }
+    for (const UriPathSegmentA* current = uri->pathHead; current != NULL; current = current == uri->pathTail ? NULL : current->next) {
+        hash = upg_hash_range(hash, '/', current->text);
+    }
+    hash = upg_hash_range(hash, '?', uri->query);
+    hash = upg_hash_range(hash, '#', uri->fragment);
+
+    return upg_hash_mix(hash);
+}
+
+/*
+ * __upg_uri_hash_components__:
+ * @self: The URI to hash.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Hashes each part of @self in turn, without writing it out as text first.
+ * Like __upg_hash_bytes__(), the result is the same everywhere, and two URIs
+ * that are the same after parsing hash the same however they were spelled.
+ *
+ * Returns: The hash of @self.
+ */
+guint64 __upg_uri_hash_components__(UpgUri* _self)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), 0);
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    return upg_uriuri_hash(&self->internal_uri, self->internal_uri.hostText);
+}
+
+/*
+ * __upg_uri_hash_parsed__:
+ * @uri: (not nullable): A URI from __upg_uri_parse_range__().
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Hashes @uri the same way __upg_uri_hash_components__() would hash a #UpgUri
+ * made from the same text, without making one; this is what lets callers
+ * parse into memory of their own and not share a #UpgUriParser.
+ *
+ * Returns: The hash of @uri.
+ */
+guint64 __upg_uri_hash_parsed__(const UriUriA* uri)
+{
+    g_return_val_if_fail(uri != NULL, 0);
+
+    gchar* ascii = upg_uriuri_idna_host(uri);
+    UriTextRangeA host = ascii != NULL ? (UriTextRangeA) { ascii, ascii + strlen(ascii) } : uri->hostText;
+    guint64 hash = upg_uriuri_hash(uri, host);
+    g_free(ascii);
+
     return hash;
 }
 
@@ -1554,35 +2778,293 @@ gboolean upg_uri_nearly_equal(gconstpointer ca, gconstpointer cb)
     if (strings_unequal)
         return FALSE;
 
-    GList* path_a = upg_uri_get_path(a);
-    GList* path_b = upg_uri_get_path(b);
+    gsize n_a = 0;
+    gsize n_b = 0;
+    const UpgSlice* path_a = upg_uri_get_path_segments(a, &n_a);
+    const UpgSlice* path_b = upg_uri_get_path_segments(b, &n_b);
 
-    GList* current_a = path_a;
-    GList* current_b = path_b;
-    gboolean same = FALSE;
-    for (;;) {
-        if (current_a == NULL && current_b == NULL) {
-            same = TRUE;
-            break;
+    if (n_a != n_b)
+        return FALSE;
+
+    for (gsize i = 0; i < n_a; i++) {
+        if (path_a[i].len != path_b[i].len || memcmp(path_a[i].data, path_b[i].data, path_a[i].len) != 0)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static const gchar upg_empty[] = "";
+static const UriTextRangeA upg_empty_range = { upg_empty, upg_empty };
+
+static gint upg_range_compare(UriTextRangeA a, UriTextRangeA b)
+{
+    if (a.first == NULL || b.first == NULL) {
+        return (a.first != NULL) - (b.first != NULL);
+    }
+
+    gsize len_a = a.afterLast - a.first;
+    gsize len_b = b.afterLast - b.first;
+    gint ret = memcmp(a.first, b.first, MIN(len_a, len_b));
+    if (ret != 0) {
+        return ret < 0 ? -1 : 1;
+    }
+
+    return (len_a > len_b) - (len_a < len_b);
+}
+
+static guint64 upg_hash_range_lower(guint64 hash, guint8 tag, UriTextRangeA range)
+{
+    guint32 len = range.first != NULL ? (guint32)(range.afterLast - range.first) : 0;
+    guint32 len_le = GUINT32_TO_LE(len);
+    hash = upg_fnv1a(hash, &tag, 1);
+    hash = upg_fnv1a(hash, &len_le, sizeof(len_le));
+    for (guint32 i = 0; i < len; i++) {
+        guint8 c = g_ascii_tolower(range.first[i]);
+        hash = upg_fnv1a(hash, &c, 1);
+    }
+    return hash;
+}
+
+/**
+ * upg_uri_hash_authority:
+ * @self: The URI to hash.
+ *
+ * Hashes the scheme, host and effective port of @self, ignoring case; the
+ * effective port is the one given in @self, or else the default for the
+ * scheme from upg_scheme_get_default_port(). So `http://Example.com/a` and
+ * `http://example.com:80/b` hash the same, but `https://example.com/` doesn't.
+ *
+ * Nothing is allocated, and the result is the same on every platform, in
+ * every process and in every version of this library, so it can be used to
+ * split work up by host between machines; see upg_uri_get_shard().
+ *
+ * Returns: The hash of the authority of @self.
+ */
+guint64 upg_uri_hash_authority(UpgUri* _self)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), 0);
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    const UriUriA* uri = &self->internal_uri;
+
+    guint16 port = self->port;
+    if (port == 0 && uri->scheme.first != NULL) {
+        port = upg_scheme_get_default_port(uri->scheme.first, uri->scheme.afterLast - uri->scheme.first);
+    }
+    guint16 port_le = GUINT16_TO_LE(port);
+
+    guint64 hash = UPG_FNV_OFFSET_BASIS;
+    hash = upg_hash_range_lower(hash, 's', uri->scheme);
+    hash = upg_hash_range_lower(hash, 'h', uri->hostText);
+    hash = upg_fnv1a(hash, &port_le, sizeof(port_le));
+    return upg_hash_mix(hash);
+}
+
+/**
+ * upg_uri_compare:
+ * @a: (not nullable) (type UpgUri): The first #UpgUri to compare.
+ * @b: (not nullable) (type UpgUri): The second #UpgUri to compare.
+ *
+ * Puts @a and @b in order, by scheme, then host, port, userinfo, path
+ * segments, query and finally fragment. A part that isn't there comes before
+ * one that is, even if it's empty, and text is compared byte by byte. Nothing
+ * is copied to do this.
+ *
+ * This is a #GCompareFunc, and it gives 0 for URIs that upg_uri_equal() says
+ * are the same.
+ * To sort lots of URIs, upg_uri_sort() is faster than using this with
+ * g_ptr_array_sort() or similar.
+ *
+ * Returns: A negative number if @a comes first, a positive number if @b comes
+ * first, and 0 if they are the same.
+ */
+gint upg_uri_compare(gconstpointer a, gconstpointer b)
+{
+    g_return_val_if_fail(UPG_IS_URI((gpointer)a), 0);
+    g_return_val_if_fail(UPG_IS_URI((gpointer)b), 0);
+
+    const UriUriA* ua = &((UpgUriPrivate*)upg_uri_get_instance_private(UPG_URI((gpointer)a)))->internal_uri;
+    const UriUriA* ub = &((UpgUriPrivate*)upg_uri_get_instance_private(UPG_URI((gpointer)b)))->internal_uri;
+    gint ret;
+
+    if ((ret = upg_range_compare(ua->scheme, ub->scheme)) != 0)
+        return ret;
+
+    if ((ret = upg_range_compare(ua->hostText, ub->hostText)) != 0)
+        return ret;
+
+    guint16 port_a = upg_uri_get_port(UPG_URI((gpointer)a));
+    guint16 port_b = upg_uri_get_port(UPG_URI((gpointer)b));
+    if (port_a != port_b)
+        return port_a < port_b ? -1 : 1;
+
+    if ((ret = upg_range_compare(ua->userInfo, ub->userInfo)) != 0)
+        return ret;
+
+    const UriPathSegmentA* current_a = ua->pathHead;
+    const UriPathSegmentA* current_b = ub->pathHead;
+    while (current_a != NULL && current_b != NULL) {
+        // a segment is always there, even if it's empty
+        UriTextRangeA text_a = current_a->text.first != NULL ? current_a->text : upg_empty_range;
+        UriTextRangeA text_b = current_b->text.first != NULL ? current_b->text : upg_empty_range;
+        if ((ret = upg_range_compare(text_a, text_b)) != 0)
+            return ret;
+
+        current_a = current_a == ua->pathTail ? NULL : current_a->next;
+        current_b = current_b == ub->pathTail ? NULL : current_b->next;
+    }
+    if (current_a != NULL || current_b != NULL)
+        return current_a != NULL ? 1 : -1;
+
+    if ((ret = upg_range_compare(ua->query, ub->query)) != 0)
+        return ret;
+
+    return upg_range_compare(ua->fragment, ub->fragment);
+}
+
+static void upg_sort_key_append_range(GString* key, UriTextRangeA range)
+{
+    if (range.first == NULL) {
+        g_string_append_c(key, '\0');
+        return;
+    }
+
+    g_string_append_c(key, '\1');
+    g_string_append_len(key, range.first, range.afterLast - range.first);
+    g_string_append_c(key, '\0');
+}
+
+/*
+ * __upg_uri_append_sort_key__:
+ * @self: The URI to make a key for.
+ * @key: (not nullable): The string to append the key to.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Appends a key for @self to @key, such that comparing two keys with memcmp()
+ * (and then by length) orders them like upg_uri_compare() does. Each part is
+ * a 0 if it isn't there, or a 1, its text and a 0 if it is; the port is two
+ * big-endian bytes, and the path is each segment like that and then a 0. No
+ * key starts with another one, since they're read the same way from the start.
+ */
+void __upg_uri_append_sort_key__(UpgUri* _self, GString* key)
+{
+    g_return_if_fail(UPG_IS_URI(_self));
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    const UriUriA* uri = &self->internal_uri;
+
+    upg_sort_key_append_range(key, uri->scheme);
+    upg_sort_key_append_range(key, uri->hostText);
+
+    guint16 port = upg_port_from_range(uri->portText);
+    g_string_append_c(key, (gchar)(port >> 8));
+    g_string_append_c(key, (gchar)(port & 0xff));
+
+    upg_sort_key_append_range(key, uri->userInfo);
+
+    for (const UriPathSegmentA* current = uri->pathHead; current != NULL; current = current == uri->pathTail ? NULL : current->next) {
+        UriTextRangeA text = current->text.first != NULL ? current->text : upg_empty_range;
+        upg_sort_key_append_range(key, text);
+    }
+    g_string_append_c(key, '\0');
+
+    upg_sort_key_append_range(key, uri->query);
+    upg_sort_key_append_range(key, uri->fragment);
+}
+
+/**
+ * upg_scheme_get_default_port:
+ * @scheme: (array length=len) (element-type guint8): The scheme, without the
+ *          colon.
+ * @len: The length of @scheme, or -1 if it's nul-terminated.
+ *
+ * Looks up the port that URIs with @scheme use when they don't give one, like
+ * 443 for `https`. Only well-known schemes are included; case doesn't matter.
+ *
+ * Returns: The default port for @scheme, or 0 if it isn't known.
+ */
+guint16 upg_scheme_get_default_port(const gchar* scheme, gssize len)
+{
+    static const struct {
+        const gchar* scheme;
+        guint16 port;
+    } ports[] = {
+        { "http", 80 },
+        { "https", 443 },
+        { "ws", 80 },
+        { "wss", 443 },
+        { "ftp", 21 },
+        { "gopher", 70 },
+        { "gemini", 1965 },
+        { "irc", 6667 },
+        { "ircs", 6697 },
+        { "ssh", 22 },
+        { "telnet", 23 },
+        { "nntp", 119 },
+        { "ldap", 389 },
+        { "ldaps", 636 },
+    };
+
+    g_return_val_if_fail(scheme != NULL, 0);
+
+    gsize slen = len < 0 ? strlen(scheme) : (gsize)len;
+    for (gsize i = 0; i < G_N_ELEMENTS(ports); i++) {
+        if (strlen(ports[i].scheme) == slen && g_ascii_strncasecmp(ports[i].scheme, scheme, slen) == 0) {
+            return ports[i].port;
         }
+    }
 
-        if (current_a == NULL && current_b != NULL)
-            break;
+    return 0;
+}
 
-        if (current_a != NULL && current_b == NULL)
-            break;
+/*
+ * __upg_uri_has_default_port__:
+ * @self: The URI to check.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Checks whether the port of @self can be left out without changing where it
+ * points: either it's empty, or it's the default for the scheme from
+ * upg_scheme_get_default_port(). This goes by the port that was worked out
+ * when @self was parsed, so the port text isn't read again.
+ *
+ * Returns: Whether the port of @self is the default one.
+ */
+gboolean __upg_uri_has_default_port__(UpgUri* _self)
+{
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    const UriUriA* uri = &self->internal_uri;
 
-        if (g_strcmp0(current_a->data, current_b->data) != 0)
-            break;
+    if (uri->portText.first == uri->portText.afterLast) {
+        return TRUE;
+    }
 
-        current_a = current_a->next;
-        current_b = current_b->next;
+    if (self->port == 0 || uri->scheme.first == NULL) {
+        return FALSE;
     }
 
-    g_list_free_full(path_a, g_free);
-    g_list_free_full(path_b, g_free);
+    return self->port == upg_scheme_get_default_port(uri->scheme.first, uri->scheme.afterLast - uri->scheme.first);
+}
+
+/*
+ * __upg_uri_get_internal__:
+ * @self: The URI.
+ *
+ * > This is an internal function! Do not use!
+ *
+ * Gets the UriUriA that @self wraps, for reading. It's only valid until @self
+ * is changed.
+ *
+ * Returns: (transfer none): The internal URI of @self.
+ */
+const UriUriA* __upg_uri_get_internal__(UpgUri* self)
+{
+    g_return_val_if_fail(UPG_IS_URI(self), NULL);
 
-    return same;
+    UpgUriPrivate* priv = upg_uri_get_instance_private(self);
+    return &priv->internal_uri;
 }
 
 /**
@@ -1657,3 +3139,171 @@ gpointer upg_uri_ref(gpointer self)
 {
     return g_object_ref(UPG_URI(self));
 }
+
+#if GLIB_CHECK_VERSION(2, 66, 0)
+static gssize upg_guri_append_part(GString* parts, UriTextRangeA range)
+{
+    if (range.first == NULL) {
+        return -1;
+    }
+
+    gssize offset = parts->len;
+    g_string_append_len(parts, range.first, range.afterLast - range.first);
+    g_string_append_c(parts, '\0');
+    return offset;
+}
+
+#define upg_guri_part(parts, offset) ((offset) >= 0 ? (parts)->str + (offset) : NULL)
+
+/**
+ * upg_uri_to_guri:
+ * @self: The URI to convert.
+ *
+ * Makes a #GUri with the same parts as @self. The parts are handed over
+ * already encoded, with %G_URI_FLAGS_ENCODED, so nothing is serialized and
+ * parsed again, and nothing is decoded.
+ *
+ * A #GUri must have a scheme, so relative references can't be converted.
+ *
+ * Returns: (transfer full) (nullable): The new #GUri, or %NULL if @self
+ * doesn't have a scheme.
+ */
+GUri* upg_uri_to_guri(UpgUri* _self)
+{
+    g_return_val_if_fail(UPG_IS_URI(_self), NULL);
+
+    UpgUriPrivate* self = upg_uri_get_instance_private(_self);
+    const UriUriA* uri = &self->internal_uri;
+
+    if (uri->scheme.first == NULL) {
+        return NULL;
+    }
+
+    // every part goes into one buffer, since g_uri_build() copies them anyway
+    GString* parts = upg_scratch_get();
+    gssize scheme = upg_guri_append_part(parts, uri->scheme);
+    gssize userinfo = upg_guri_append_part(parts, uri->userInfo);
+    gssize host = upg_guri_append_part(parts, uri->hostText);
+    gssize query = upg_guri_append_part(parts, uri->query);
+    gssize fragment = upg_guri_append_part(parts, uri->fragment);
+
+    gsize path_offset = parts->len;
+    for (const UriPathSegmentA* current = uri->pathHead; current != NULL; current = current == uri->pathTail ? NULL : current->next) {
+        if (current != uri->pathHead || uri->absolutePath || uri->hostText.first != NULL) {
+            g_string_append_c(parts, '/');
+        }
+        g_string_append_len(parts, current->text.first, current->text.afterLast - current->text.first);
+    }
+    if (uri->pathHead == NULL && uri->absolutePath) {
+        g_string_append_c(parts, '/');
+    }
+    g_string_append_c(parts, '\0');
+
+    return g_uri_build(G_URI_FLAGS_ENCODED,
+        upg_guri_part(parts, scheme),
+        upg_guri_part(parts, userinfo),
+        upg_guri_part(parts, host),
+        self->port != 0 ? self->port : -1,
+        parts->str + path_offset,
+        upg_guri_part(parts, query),
+        upg_guri_part(parts, fragment));
+}
+
+#define UPG_SUB_DELIMS "!$&'()*+,;="
+
+/*
+ * upg_guri_append_encoded:
+ * @text: The URI being put together.
+ * @value: (nullable): A part of a #GUri.
+ * @encoded: Whether @value is already percent-encoded.
+ * @allowed: The reserved characters that are allowed in this part.
+ *
+ * Appends @value to @text in the encoded form that UpgUri keeps, encoding it
+ * on the way if the #GUri gave it decoded.
+ */
+static void upg_guri_append_encoded(GString* text, const gchar* value, gboolean encoded, const gchar* allowed)
+{
+    if (value == NULL) {
+        return;
+    }
+
+    if (encoded) {
+        g_string_append(text, value);
+    } else {
+        g_string_append_uri_escaped(text, value, allowed, FALSE);
+    }
+}
+
+/**
+ * upg_uri_new_from_guri:
+ * @guri: (transfer none) (not nullable): The #GUri to convert.
+ *
+ * Makes a new #UpgUri with the same parts as @guri. Parts that @guri keeps
+ * decoded, going by its #GUriFlags, are percent-encoded again on the way.
+ *
+ * The parts are written straight into the buffer that the new #UpgUri keeps,
+ * which is then parsed once, so there is a single copy and no per-part
+ * notifications. Like upg_uri_new(), the result is normalized.
+ *
+ * Returns: (transfer full) (nullable): The new #UpgUri, or %NULL if the parts
+ * of @guri don't make up a valid URI.
+ */
+UpgUri* upg_uri_new_from_guri(GUri* guri)
+{
+    g_return_val_if_fail(guri != NULL, NULL);
+
+    GUriFlags flags = g_uri_get_flags(guri);
+    gboolean all_encoded = (flags & G_URI_FLAGS_ENCODED) != 0;
+
+    GString* text = g_string_new(g_uri_get_scheme(guri));
+    g_string_append_c(text, ':');
+
+    const gchar* host = g_uri_get_host(guri);
+    if (host != NULL) {
+        g_string_append(text, "//");
+
+        const gchar* userinfo = g_uri_get_userinfo(guri);
+        if (userinfo != NULL) {
+            upg_guri_append_encoded(text, userinfo, all_encoded, UPG_SUB_DELIMS ":");
+            g_string_append_c(text, '@');
+        }
+
+        // IP literals have colons in them, and are never encoded
+        if (strchr(host, ':') != NULL) {
+            g_string_append_c(text, '[');
+            g_string_append(text, host);
+            g_string_append_c(text, ']');
+        } else {
+            upg_guri_append_encoded(text, host, all_encoded, UPG_SUB_DELIMS);
+        }
+
+        gint port = g_uri_get_port(guri);
+        if (port > 0) {
+            g_string_append_printf(text, ":%d", port);
+        }
+    }
+
+    upg_guri_append_encoded(text, g_uri_get_path(guri), all_encoded || (flags & G_URI_FLAGS_ENCODED_PATH), UPG_SUB_DELIMS ":@/");
+
+    const gchar* query = g_uri_get_query(guri);
+    if (query != NULL) {
+        g_string_append_c(text, '?');
+        upg_guri_append_encoded(text, query, all_encoded || (flags & G_URI_FLAGS_ENCODED_QUERY), UPG_SUB_DELIMS ":@/?");
+    }
+
+    const gchar* fragment = g_uri_get_fragment(guri);
+    if (fragment != NULL) {
+        g_string_append_c(text, '#');
+        upg_guri_append_encoded(text, fragment, all_encoded || (flags & G_URI_FLAGS_ENCODED_FRAGMENT), UPG_SUB_DELIMS ":@/?");
+    }
+
+    UpgUri* self = upg_uri_new(NULL, NULL);
+    gsize len = text->len;
+    if (!upg_uri_configure_from_buffer(self, g_string_free(text, FALSE), len, NULL)) {
+        g_object_unref(self);
+        return NULL;
+    }
+
+    return self;
+}
+#endif
@@ -21,6 +21,7 @@
 #define UPGURI_H
 
 #include <glib-2.0/glib.h>
+#include <gio/gio.h>
 #include <glib-object.h>
 
 #if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
@@ -44,19 +45,89 @@ typedef enum {
     UPG_HIERARCHY_IGNOREPORT = 4,
 } UpgHierarchyFlags;
 
+/**
+ * UpgHostType:
+ * @UPG_HOST_NONE: There's no host at all.
+ * @UPG_HOST_REG_NAME: A registered name, like `example.com`. It may be empty.
+ * @UPG_HOST_IPV4: An IPv4 address, like `127.0.0.1`.
+ * @UPG_HOST_IPV6: An IPv6 address, like `[::1]`.
+ * @UPG_HOST_IPVFUTURE: An address in some future format, like `[v1.fe80::a]`.
+ *
+ * The kinds of host that a #UpgUri can have.
+ */
+typedef enum {
+    UPG_HOST_NONE = 0,
+    UPG_HOST_REG_NAME,
+    UPG_HOST_IPV4,
+    UPG_HOST_IPV6,
+    UPG_HOST_IPVFUTURE,
+} UpgHostType;
+
+/**
+ * UpgSlice:
+ * @data: The start of the text. It isn't nul-terminated.
+ * @len: The length of the text, in bytes.
+ *
+ * A piece of text that belongs to something else, like a path segment of a
+ * #UpgUri.
+ */
+typedef struct {
+    const gchar* data;
+    gsize len;
+} UpgSlice;
+
+/**
+ * UpgLimits:
+ * @max_length: The longest a URI can be, in bytes.
+ * @max_segments: The most path segments a URI can have.
+ * @max_query_params: The most `&`-separated query parameters a URI can have.
+ * @max_dot_segments: The most `.` and `..` segments a URI's path can have.
+ *
+ * Limits on how big a URI can be, so that untrusted input can't make parsing,
+ * or working with the URI afterwards, take too long. A limit of 0 means there
+ * is no limit. Going over a limit gives a %UPG_ERR_LIMIT error.
+ *
+ * The limits are checked before the URI is parsed, in one pass over the text,
+ * so they're counted as written: `%2E` counts as a dot, and the path is
+ * counted before dot segments are removed.
+ */
+typedef struct {
+    gsize max_length;
+    guint max_segments;
+    guint max_query_params;
+    guint max_dot_segments;
+} UpgLimits;
+
 GType upg_hierarchy_flags_get_type(void);
 #define UPG_TYPE_HIERARCHY_FLAGS upg_hierarchy_flags_get_type()
+GType upg_host_type_get_type(void);
+#define UPG_TYPE_HOST_TYPE upg_host_type_get_type()
 
 UpgUri* upg_uri_new(const gchar* uri, GError** error);
+UpgUri* upg_uri_new_full(const gchar* uri, const UpgLimits* limits, GError** error);
+void upg_uri_set_limits(UpgUri* self, const UpgLimits* limits);
+void upg_limits_init_default(UpgLimits* limits);
 gboolean upg_uri_configure_from_string(UpgUri* self, const gchar* nuri, GError** error);
+gboolean upg_uri_is_valid(const gchar* uri, gssize len, gsize* error_offset);
+UpgUri* upg_uri_new_utf16(const gunichar2* uri, glong len, GError** error);
+gboolean upg_uri_configure_from_utf16(UpgUri* self, const gunichar2* nuri, glong len, GError** error);
 gchar* upg_uri_to_string(UpgUri* self);
+gboolean upg_uri_to_string_buf(UpgUri* self, gchar* buf, gsize cap, gsize* written);
+void upg_uri_append_to_gstring(UpgUri* self, GString* str);
+gboolean upg_uri_write_to_stream(UpgUri* self, GOutputStream* stream, GCancellable* cancellable, GError** error);
 void upg_uri_set_scheme(UpgUri* self, const gchar* nscheme);
 gchar* upg_uri_get_scheme(UpgUri* self);
 gchar* upg_uri_get_host(UpgUri* self);
 guint8* upg_uri_get_host_data(UpgUri* self, guint8* protocol);
+UpgHostType upg_uri_get_host_type(UpgUri* self);
+const guint8* upg_uri_get_host_address(UpgUri* self, UpgHostType* type);
+gchar* upg_uri_get_host_ascii(UpgUri* self);
+gchar* upg_uri_get_host_unicode(UpgUri* self);
 void upg_uri_set_host(UpgUri* self, const gchar* host);
 GList* upg_uri_get_path(UpgUri* self);
 gchar* upg_uri_get_path_str(UpgUri* self);
+const UpgSlice* upg_uri_get_path_segments(UpgUri* self, gsize* n_segments);
+gchar** upg_uri_get_path_strv(UpgUri* self);
 void upg_uri_set_path(UpgUri* self, GList* list);
 void upg_uri_set_path_str(UpgUri* self, const char* path);
 GHashTable* upg_uri_get_query(UpgUri* self);
@@ -75,14 +146,53 @@ void upg_uri_set_userinfo(UpgUri* self, const gchar* userinfo);
 UpgUri* upg_uri_apply_reference(UpgUri* self, const gchar* reference, GError** error);
 gchar* upg_uri_subtract_to_reference(UpgUri* self, UpgUri* subtrahend, GError** error);
 gboolean upg_uri_is_parent_of(UpgUri* self, UpgUri* other, guint16 default_port, UpgHierarchyFlags flags);
+guint16 upg_scheme_get_default_port(const gchar* scheme, gssize len);
 
 guint upg_uri_hash(gconstpointer self);
 gboolean upg_uri_equal(gconstpointer a, gconstpointer b);
 gboolean upg_uri_nearly_equal(gconstpointer a, gconstpointer b);
+gint upg_uri_compare(gconstpointer a, gconstpointer b);
+guint64 upg_uri_hash_authority(UpgUri* self);
 
 UpgUri* upg_uri_copy(UpgUri* self);
 gpointer upg_uri_ref(gpointer self);
 void upg_uri_unref(gpointer self);
+
+#if GLIB_CHECK_VERSION(2, 66, 0)
+GUri* upg_uri_to_guri(UpgUri* self);
+UpgUri* upg_uri_new_from_guri(GUri* guri);
+#endif
+
+#ifdef LIBURIPARSER_GOBJECT_COMPILATION
+#include <uriparser/Uri.h>
+
+#define upg_uri_parse_range(out, first, after_last, memory, error) \
+    __upg_uri_parse_range__(out, first, after_last, memory, error)
+#define upg_uri_take_internal(self, uri, memory, buffer) __upg_uri_take_internal__(self, uri, memory, buffer)
+gboolean __upg_uri_parse_range__(UriUriA* out, const gchar* first, const gchar* after_last, UriMemoryManager* memory, GError** error);
+guint32 __upg_uri_take_internal__(UpgUri* self, UriUriA* uri, UriMemoryManager* memory, gchar* buffer);
+#define upg_uri_notify_changes(self, changed) __upg_uri_notify_changes__(self, changed)
+void __upg_uri_notify_changes__(UpgUri* self, guint32 changed);
+
+#define upg_hash_bytes(data, len) __upg_hash_bytes__(data, len)
+guint64 __upg_hash_bytes__(const void* data, gsize len);
+#define upg_uri_hash_components(self) __upg_uri_hash_components__(self)
+guint64 __upg_uri_hash_components__(UpgUri* self);
+#define upg_uri_hash_parsed(uri) __upg_uri_hash_parsed__(uri)
+guint64 __upg_uri_hash_parsed__(const UriUriA* uri);
+#define upg_uri_append_sort_key(self, key) __upg_uri_append_sort_key__(self, key)
+void __upg_uri_append_sort_key__(UpgUri* self, GString* key);
+#define upg_uri_has_default_port(self) __upg_uri_has_default_port__(self)
+gboolean __upg_uri_has_default_port__(UpgUri* self);
+#define upg_uri_get_internal(self) __upg_uri_get_internal__(self)
+const UriUriA* __upg_uri_get_internal__(UpgUri* self);
+#define upg_idna_to_ascii(host, len) __upg_idna_to_ascii__(host, len)
+gchar* __upg_idna_to_ascii__(const gchar* host, gsize len);
+#define upg_uriuri_idna_host(uri) __upg_uriuri_idna_host__(uri)
+gchar* __upg_uriuri_idna_host__(const UriUriA* uri);
+#define upg_idna_to_unicode(host, len) __upg_idna_to_unicode__(host, len)
+gchar* __upg_idna_to_unicode__(const gchar* host, gsize len);
+#endif
 G_END_DECLS
 
 #endif
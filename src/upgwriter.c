@@ -0,0 +1,222 @@
+/* upgwriter.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "upgwriter.h"
+#include <string.h>
+
+#define UPG_WRITER_CHUNK_SIZE (64 * 1024)
+#define UPG_WRITER_N_CHUNKS 16
+
+/**
+ * SECTION:upgwriter
+ * @short_description: Writing lots of URIs to a stream
+ * @include: liburiparser-gobject.h
+ * @title: UpgUriWriter
+ *
+ * #UpgUriWriter writes URIs to a #GOutputStream, one after another, with a
+ * separator after each. The URIs are serialized straight into a set of
+ * buffers that belong to the writer, and when those fill up they are all
+ * written with a single g_output_stream_writev_all(); there's no string made
+ * for each URI, and there are far fewer writes than URIs.
+ *
+ * Nothing is written until the buffers are full or upg_uri_writer_flush() is
+ * called, so make sure to flush when you're done. The writer tries to flush
+ * when it's disposed, but it can't tell you if that fails.
+ */
+struct _UpgUriWriter {
+    GObject parent_instance;
+
+    GOutputStream* stream;
+    gchar* separator;
+    gsize separator_len;
+    GString* chunks[UPG_WRITER_N_CHUNKS];
+    guint current;
+};
+
+G_DEFINE_TYPE(UpgUriWriter, upg_uri_writer, G_TYPE_OBJECT)
+
+static void upg_uri_writer_dispose(GObject* obj)
+{
+    UpgUriWriter* self = UPG_URI_WRITER(obj);
+
+    if (self->stream != NULL) {
+        GError* error = NULL;
+        if (!upg_uri_writer_flush(self, NULL, &error)) {
+            g_warning("Failed to flush UpgUriWriter when disposing it: %s", error->message);
+            g_error_free(error);
+        }
+    }
+
+    g_clear_object(&self->stream);
+
+    G_OBJECT_CLASS(upg_uri_writer_parent_class)->dispose(obj);
+}
+
+static void upg_uri_writer_finalize(GObject* obj)
+{
+    UpgUriWriter* self = UPG_URI_WRITER(obj);
+
+    for (guint i = 0; i < UPG_WRITER_N_CHUNKS; i++) {
+        if (self->chunks[i] != NULL) {
+            g_string_free(self->chunks[i], TRUE);
+        }
+    }
+    g_free(self->separator);
+
+    G_OBJECT_CLASS(upg_uri_writer_parent_class)->finalize(obj);
+}
+
+static void upg_uri_writer_class_init(UpgUriWriterClass* klass)
+{
+    GObjectClass* glass = G_OBJECT_CLASS(klass);
+
+    glass->dispose = upg_uri_writer_dispose;
+    glass->finalize = upg_uri_writer_finalize;
+}
+
+static void upg_uri_writer_init(UpgUriWriter* self)
+{
+}
+
+/**
+ * upg_uri_writer_new:
+ * @stream: (transfer none) (not nullable): The stream to write to.
+ * @separator: (transfer none) (nullable): What to write after each URI, or
+ *             %NULL for a newline.
+ *
+ * Creates a new #UpgUriWriter that writes to @stream.
+ *
+ * Returns: (transfer full): a new #UpgUriWriter.
+ */
+UpgUriWriter* upg_uri_writer_new(GOutputStream* stream, const gchar* separator)
+{
+    g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), NULL);
+
+    UpgUriWriter* self = g_object_new(UPG_TYPE_URI_WRITER, NULL);
+    self->stream = g_object_ref(stream);
+    self->separator = g_strdup(separator != NULL ? separator : "\n");
+    self->separator_len = strlen(self->separator);
+    return self;
+}
+
+/**
+ * upg_uri_writer_add:
+ * @self: The writer to use.
+ * @uri: (transfer none) (not nullable): The URI to write.
+ * @cancellable: (nullable): A #GCancellable, or %NULL.
+ * @error: A #GError.
+ *
+ * Adds @uri, followed by the separator, to what @self is going to write. If
+ * that fills up the buffers, they're flushed, which is the only time this
+ * can fail.
+ *
+ * Returns: Whether everything succeeded; if not, @error is set.
+ */
+gboolean upg_uri_writer_add(UpgUriWriter* self, UpgUri* uri, GCancellable* cancellable, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_URI_WRITER(self), FALSE);
+    g_return_val_if_fail(UPG_IS_URI(uri), FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    if (self->chunks[self->current] == NULL) {
+        self->chunks[self->current] = g_string_sized_new(UPG_WRITER_CHUNK_SIZE);
+    }
+
+    GString* chunk = self->chunks[self->current];
+    upg_uri_append_to_gstring(uri, chunk);
+    g_string_append_len(chunk, self->separator, self->separator_len);
+
+    if (chunk->len < UPG_WRITER_CHUNK_SIZE) {
+        return TRUE;
+    }
+
+    if (++self->current < UPG_WRITER_N_CHUNKS) {
+        return TRUE;
+    }
+
+    return upg_uri_writer_flush(self, cancellable, error);
+}
+
+/**
+ * upg_uri_writer_add_many:
+ * @self: The writer to use.
+ * @uris: (array length=n_uris) (transfer none): The URIs to write.
+ * @n_uris: The number of URIs in @uris.
+ * @cancellable: (nullable): A #GCancellable, or %NULL.
+ * @error: A #GError.
+ *
+ * Adds each of @uris, like upg_uri_writer_add(). If a flush fails part of the
+ * way through, the rest of @uris aren't added.
+ *
+ * Returns: Whether everything succeeded; if not, @error is set.
+ */
+gboolean upg_uri_writer_add_many(UpgUriWriter* self, UpgUri** uris, gsize n_uris, GCancellable* cancellable, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_URI_WRITER(self), FALSE);
+    g_return_val_if_fail(uris != NULL || n_uris == 0, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    for (gsize i = 0; i < n_uris; i++) {
+        if (!upg_uri_writer_add(self, uris[i], cancellable, error)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * upg_uri_writer_flush:
+ * @self: The writer to flush.
+ * @cancellable: (nullable): A #GCancellable, or %NULL.
+ * @error: A #GError.
+ *
+ * Writes everything that has been added to @self to its stream, using one
+ * g_output_stream_writev_all() call. This doesn't flush the stream itself.
+ *
+ * If the write fails, whatever wasn't written is thrown away.
+ *
+ * Returns: Whether the write succeeded; if not, @error is set.
+ */
+gboolean upg_uri_writer_flush(UpgUriWriter* self, GCancellable* cancellable, GError** error)
+{
+    g_return_val_if_fail(UPG_IS_URI_WRITER(self), FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    GOutputVector vectors[UPG_WRITER_N_CHUNKS];
+    gsize n_vectors = 0;
+
+    for (guint i = 0; i < UPG_WRITER_N_CHUNKS && self->chunks[i] != NULL; i++) {
+        if (self->chunks[i]->len > 0) {
+            vectors[n_vectors++] = (GOutputVector) { self->chunks[i]->str, self->chunks[i]->len };
+        }
+    }
+
+    gboolean ret = TRUE;
+    if (n_vectors > 0) {
+        ret = g_output_stream_writev_all(self->stream, vectors, n_vectors, NULL, cancellable, error);
+    }
+
+    for (guint i = 0; i < UPG_WRITER_N_CHUNKS && self->chunks[i] != NULL; i++) {
+        g_string_truncate(self->chunks[i], 0);
+    }
+    self->current = 0;
+
+    return ret;
+}
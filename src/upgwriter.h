@@ -0,0 +1,45 @@
+/* upgwriter.h
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#ifndef UPGWRITER_H
+#define UPGWRITER_H
+
+#include <gio/gio.h>
+#include <glib-2.0/glib.h>
+#include <glib-object.h>
+
+#include "upguri.h"
+
+#if !defined(__LIBURIPARSER_GOBJECT_INSIDE__) && !defined(LIBURIPARSER_GOBJECT_COMPILATION)
+#error "Only <liburiparser-gobject.h> can be included directly."
+#endif
+
+G_BEGIN_DECLS
+
+#define UPG_TYPE_URI_WRITER upg_uri_writer_get_type()
+G_DECLARE_FINAL_TYPE(UpgUriWriter, upg_uri_writer, UPG, URI_WRITER, GObject)
+
+UpgUriWriter* upg_uri_writer_new(GOutputStream* stream, const gchar* separator);
+gboolean upg_uri_writer_add(UpgUriWriter* self, UpgUri* uri, GCancellable* cancellable, GError** error);
+gboolean upg_uri_writer_add_many(UpgUriWriter* self, UpgUri** uris, gsize n_uris, GCancellable* cancellable, GError** error);
+gboolean upg_uri_writer_flush(UpgUriWriter* self, GCancellable* cancellable, GError** error);
+
+G_END_DECLS
+
+#endif
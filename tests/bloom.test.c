@@ -0,0 +1,171 @@
+/* bloom.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+#include <glib/gstdio.h>
+
+static void no_false_negatives(void)
+{
+    UpgBloomFilter* filter = upg_bloom_filter_new(1000, 0.01);
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        upg_bloom_filter_add(filter, uri);
+        g_assert_true(upg_bloom_filter_contains(filter, uri));
+        g_object_unref(uri);
+
+        g_assert_true(upg_bloom_filter_contains_string(filter, tests[i]->uri, NULL));
+    }
+
+    g_object_unref(filter);
+}
+
+static void normalizes_strings(void)
+{
+    UpgBloomFilter* filter = upg_bloom_filter_new(1000, 0.01);
+
+    FOR_EACH_CASE(tests)
+    {
+        g_assert_true(upg_bloom_filter_add_string(filter, tests[i]->nonnormalized, NULL));
+
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        g_assert_true(upg_bloom_filter_contains(filter, uri));
+        g_object_unref(uri);
+    }
+
+    g_assert_true(upg_bloom_filter_add_string(filter, "HTTP://Example.COM/a/../b/%7euser", NULL));
+    g_assert_true(upg_bloom_filter_contains_string(filter, "http://example.com/b/~user", NULL));
+
+    // setters don't normalize, but the filter still should
+    UpgUri* changed = upg_uri_new("http://other.example/b/~user", NULL);
+    upg_uri_set_host(changed, "EXAMPLE.com");
+    g_assert_true(upg_bloom_filter_contains(filter, changed));
+    g_object_unref(changed);
+
+    GError* err = NULL;
+    g_assert_false(upg_bloom_filter_add_string(filter, "ä", &err));
+    g_assert_error(err, UPG_ERROR, UPG_ERR_PARSE);
+    g_error_free(err);
+
+    g_object_unref(filter);
+}
+
+static void false_positive_rate(void)
+{
+    UpgBloomFilter* filter = upg_bloom_filter_new(10000, 0.01);
+
+    for (guint i = 0; i < 10000; i++) {
+        gchar* uri = g_strdup_printf("https://example.com/added/%u", i);
+        upg_bloom_filter_add_string(filter, uri, NULL);
+        g_free(uri);
+    }
+
+    guint false_positives = 0;
+    for (guint i = 0; i < 10000; i++) {
+        gchar* uri = g_strdup_printf("https://example.com/not-added/%u", i);
+        if (upg_bloom_filter_contains_string(filter, uri, NULL))
+            false_positives++;
+        g_free(uri);
+    }
+
+    // allow plenty of slack over the 1% asked for
+    g_assert_cmpuint(false_positives, <, 300);
+
+    g_object_unref(filter);
+}
+
+static void save_and_load(void)
+{
+    UpgBloomFilter* filter = upg_bloom_filter_new(100, 0.001);
+    upg_bloom_filter_add_string(filter, "https://example.com/saved", NULL);
+
+    gchar* filename = NULL;
+    gint fd = g_file_open_tmp("upg-bloom-XXXXXX", &filename, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    g_close(fd, NULL);
+
+    g_assert_true(upg_bloom_filter_save(filter, filename, NULL));
+
+    UpgBloomFilter* loaded = upg_bloom_filter_load(filename, NULL);
+    g_assert_nonnull(loaded);
+    g_assert_cmpuint(upg_bloom_filter_get_size(loaded), ==, upg_bloom_filter_get_size(filter));
+    g_assert_true(upg_bloom_filter_contains_string(loaded, "https://example.com/saved", NULL));
+
+    GError* err = NULL;
+    g_assert_true(g_file_set_contents(filename, "not a filter", -1, NULL));
+    g_assert_null(upg_bloom_filter_load(filename, &err));
+    g_assert_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+    g_error_free(err);
+
+    g_unlink(filename);
+    g_free(filename);
+    g_object_unref(loaded);
+    g_object_unref(filter);
+}
+
+static void load_checks_length(void)
+{
+    UpgBloomFilter* filter = upg_bloom_filter_new(100, 0.001);
+
+    gchar* filename = NULL;
+    gint fd = g_file_open_tmp("upg-bloom-XXXXXX", &filename, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    g_close(fd, NULL);
+    g_assert_true(upg_bloom_filter_save(filter, filename, NULL));
+
+    gchar* contents = NULL;
+    gsize length = 0;
+    g_assert_true(g_file_get_contents(filename, &contents, &length, NULL));
+
+    GError* err = NULL;
+    g_assert_true(g_file_set_contents(filename, contents, length - 1, NULL));
+    g_assert_null(upg_bloom_filter_load(filename, &err));
+    g_assert_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+    g_clear_error(&err);
+
+    gchar* longer = g_malloc0(length + 1);
+    memcpy(longer, contents, length);
+    g_assert_true(g_file_set_contents(filename, longer, length + 1, NULL));
+    g_assert_null(upg_bloom_filter_load(filename, &err));
+    g_assert_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+    g_clear_error(&err);
+
+    // a header asking for far more blocks than there are
+    memset(contents + 16, 0xff, 7);
+    g_assert_true(g_file_set_contents(filename, contents, length, NULL));
+    g_assert_null(upg_bloom_filter_load(filename, &err));
+    g_assert_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+    g_clear_error(&err);
+
+    g_unlink(filename);
+    g_free(longer);
+    g_free(contents);
+    g_free(filename);
+    g_object_unref(filter);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_bloom_filter_contains", no_false_negatives);
+    g_test_add_func("/upg_bloom_filter_add_string", normalizes_strings);
+    g_test_add_func("/upg_bloom_filter_contains/false-positives", false_positive_rate);
+    g_test_add_func("/upg_bloom_filter_save", save_and_load);
+    g_test_add_func("/upg_bloom_filter_load/length", load_checks_length);
+}
@@ -0,0 +1,137 @@
+/* builder.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void fill_builder(UpgUriBuilder* builder, Test test)
+{
+    upg_uri_builder_reset(builder);
+    upg_uri_builder_set_scheme(builder, test->scheme);
+    upg_uri_builder_set_userinfo(builder, test->userinfo);
+    upg_uri_builder_set_host(builder, test->host);
+    upg_uri_builder_set_port(builder, test->port);
+
+    for (GList* current = test->path; current != NULL; current = current->next) {
+        upg_uri_builder_append_segment(builder, current->data);
+    }
+
+    for (GList* current = test->query_order; current != NULL; current = current->next) {
+        upg_uri_builder_add_query_param(builder, current->data, g_hash_table_lookup(test->query, current->data));
+    }
+
+    upg_uri_builder_set_fragment(builder, test->fragment);
+}
+
+static void builds_strings(void)
+{
+    UpgUriBuilder* builder = upg_uri_builder_new();
+
+    FOR_EACH_CASE(tests)
+    {
+        fill_builder(builder, tests[i]);
+
+        gchar* built = upg_uri_builder_to_string(builder);
+        g_assert_cmpstr(built, ==, tests[i]->uri);
+        g_free(built);
+    }
+
+    g_object_unref(builder);
+}
+
+static void builds_uris(void)
+{
+    UpgUriBuilder* builder = upg_uri_builder_new();
+
+    FOR_EACH_CASE(tests)
+    {
+        fill_builder(builder, tests[i]);
+
+        UpgUri* uri = upg_uri_builder_to_uri(builder);
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, tests[i]->uri);
+        g_free(str);
+
+        GList* path = upg_uri_get_path(uri);
+        g_assert_cmpuint(g_list_length(path), ==, g_list_length(tests[i]->path));
+        g_assert_true(compare_lists(path, tests[i]->path));
+        g_list_free_full(path, g_free);
+
+        g_assert_cmpuint(upg_uri_get_port(uri), ==, tests[i]->port);
+
+        // the built URI has to behave like any other
+        upg_uri_set_host(uri, "example.com");
+        upg_uri_set_path_str(uri, "/changed");
+        UpgUri* copy = upg_uri_copy(uri);
+        g_assert_true(upg_uri_equal(uri, copy));
+
+        upg_uri_unref(copy);
+        upg_uri_unref(uri);
+    }
+
+    g_object_unref(builder);
+}
+
+static void builds_relative_paths(void)
+{
+    UpgUriBuilder* builder = upg_uri_builder_new();
+    upg_uri_builder_set_scheme(builder, "mailto");
+    upg_uri_builder_append_segment(builder, "a");
+    upg_uri_builder_append_segment(builder, "");
+
+    UpgUri* uri = upg_uri_builder_to_uri(builder);
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "mailto:/a/");
+    g_free(str);
+
+    upg_uri_unref(uri);
+    g_object_unref(builder);
+}
+
+static void escapes_slashes_in_segments(void)
+{
+    UpgUriBuilder* builder = upg_uri_builder_new();
+    upg_uri_builder_set_scheme(builder, "http");
+    upg_uri_builder_set_host(builder, "example.com");
+    upg_uri_builder_append_segment(builder, "a/b");
+    upg_uri_builder_append_segment(builder, "/");
+
+    gchar* str = upg_uri_builder_to_string(builder);
+    g_assert_cmpstr(str, ==, "http://example.com/a%2Fb/%2F");
+    g_free(str);
+
+    UpgUri* uri = upg_uri_builder_to_uri(builder);
+    gsize n_segments = 0;
+    upg_uri_get_path_segments(uri, &n_segments);
+    g_assert_cmpuint(n_segments, ==, 2);
+
+    str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://example.com/a%2Fb/%2F");
+    g_free(str);
+
+    upg_uri_unref(uri);
+    g_object_unref(builder);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_builder_to_string", builds_strings);
+    g_test_add_func("/upg_uri_builder_to_uri", builds_uris);
+    g_test_add_func("/upg_uri_builder_to_uri/no-authority", builds_relative_paths);
+    g_test_add_func("/upg_uri_builder_append_segment/slashes", escapes_slashes_in_segments);
+}
@@ -0,0 +1,114 @@
+/* guri.bench.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+/*
+ * Compares UpgUri with GUri on the test corpus: parsing each, and converting
+ * each way with the direct functions and through a string. The numbers are
+ * nanoseconds per URI; set UPG_BENCH_ROUNDS to change how many times the
+ * corpus is gone through.
+ */
+
+#if GLIB_CHECK_VERSION(2, 66, 0)
+typedef void (*BenchFunc)(gpointer item, gpointer data);
+
+static void bench(const gchar* name, GPtrArray* items, BenchFunc func, gpointer data, guint rounds)
+{
+    gint64 start = g_get_monotonic_time();
+    for (guint round = 0; round < rounds; round++) {
+        for (guint i = 0; i < items->len; i++) {
+            func(items->pdata[i], data);
+        }
+    }
+    gint64 elapsed = g_get_monotonic_time() - start;
+
+    gdouble per_item = (gdouble)elapsed * 1000 / ((gdouble)rounds * items->len);
+    g_print("%-36s %10.1f ns\n", name, per_item);
+}
+
+static void parse_upg(gpointer item, gpointer data)
+{
+    g_object_unref(upg_uri_new(item, NULL));
+}
+
+static void parse_guri(gpointer item, gpointer data)
+{
+    g_uri_unref(g_uri_parse(item, G_URI_FLAGS_ENCODED, NULL));
+}
+
+static void to_guri_direct(gpointer item, gpointer data)
+{
+    g_uri_unref(upg_uri_to_guri(item));
+}
+
+static void to_guri_string(gpointer item, gpointer data)
+{
+    gchar* str = upg_uri_to_string(item);
+    g_uri_unref(g_uri_parse(str, G_URI_FLAGS_ENCODED, NULL));
+    g_free(str);
+}
+
+static void from_guri_direct(gpointer item, gpointer data)
+{
+    g_object_unref(upg_uri_new_from_guri(item));
+}
+
+static void from_guri_string(gpointer item, gpointer data)
+{
+    gchar* str = g_uri_to_string(item);
+    g_object_unref(upg_uri_new(str, NULL));
+    g_free(str);
+}
+
+int main(int argc, char** argv)
+{
+    const gchar* rounds_env = g_getenv("UPG_BENCH_ROUNDS");
+    guint rounds = rounds_env != NULL ? (guint)g_ascii_strtoull(rounds_env, NULL, 10) : 20000;
+
+    GPtrArray* strings = g_ptr_array_new();
+    GPtrArray* upg_uris = g_ptr_array_new_with_free_func(g_object_unref);
+    GPtrArray* guris = g_ptr_array_new_with_free_func((GDestroyNotify)g_uri_unref);
+
+    FOR_EACH_CASE(tests)
+    {
+        g_ptr_array_add(strings, (gpointer)tests[i]->nonnormalized);
+        g_ptr_array_add(upg_uris, upg_uri_new(tests[i]->uri, NULL));
+        g_ptr_array_add(guris, g_uri_parse(tests[i]->uri, G_URI_FLAGS_ENCODED, NULL));
+    }
+
+    bench("parse: upg_uri_new", strings, parse_upg, NULL, rounds);
+    bench("parse: g_uri_parse", strings, parse_guri, NULL, rounds);
+    bench("to GUri: upg_uri_to_guri", upg_uris, to_guri_direct, NULL, rounds);
+    bench("to GUri: through a string", upg_uris, to_guri_string, NULL, rounds);
+    bench("from GUri: upg_uri_new_from_guri", guris, from_guri_direct, NULL, rounds);
+    bench("from GUri: through a string", guris, from_guri_string, NULL, rounds);
+
+    g_ptr_array_unref(guris);
+    g_ptr_array_unref(upg_uris);
+    g_ptr_array_unref(strings);
+    return 0;
+}
+#else
+int main(int argc, char** argv)
+{
+    g_print("GUri needs GLib 2.66; skipping\n");
+    return 77;
+}
+#endif
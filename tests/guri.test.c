@@ -0,0 +1,125 @@
+/* guri.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+#if GLIB_CHECK_VERSION(2, 66, 0)
+static void to_guri(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        GUri* guri = upg_uri_to_guri(uri);
+        g_assert_nonnull(guri);
+
+        gchar* str = g_uri_to_string(guri);
+        g_assert_cmpstr(str, ==, tests[i]->uri);
+        g_free(str);
+
+        g_assert_cmpstr(g_uri_get_scheme(guri), ==, tests[i]->scheme);
+        g_assert_cmpint(g_uri_get_port(guri), ==, tests[i]->port != 0 ? tests[i]->port : -1);
+
+        g_uri_unref(guri);
+        g_object_unref(uri);
+    }
+}
+
+static void from_guri(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        GUri* guri = g_uri_parse(tests[i]->uri, G_URI_FLAGS_ENCODED, NULL);
+        g_assert_nonnull(guri);
+
+        UpgUri* uri = upg_uri_new_from_guri(guri);
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, tests[i]->uri);
+        g_free(str);
+
+        g_object_unref(uri);
+        g_uri_unref(guri);
+    }
+}
+
+static void from_guri_decoded(void)
+{
+    GUri* guri = g_uri_parse("http://example.com/a%20b/c?x=%C3%A9&y=1#top", G_URI_FLAGS_NONE, NULL);
+    g_assert_nonnull(guri);
+    g_assert_cmpstr(g_uri_get_path(guri), ==, "/a b/c");
+
+    UpgUri* uri = upg_uri_new_from_guri(guri);
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://example.com/a%20b/c?x=%C3%A9&y=1#top");
+    g_free(str);
+
+    g_object_unref(uri);
+    g_uri_unref(guri);
+}
+
+static void from_guri_normalized(void)
+{
+    GUri* guri = g_uri_parse("HTTP://User@[::1]:8080/a/./b/../c%7e?q#f", G_URI_FLAGS_ENCODED, NULL);
+    g_assert_nonnull(guri);
+
+    UpgUri* uri = upg_uri_new_from_guri(guri);
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://User@[::1]:8080/a/c~?q#f");
+    g_free(str);
+    g_assert_cmpint(upg_uri_get_port(uri), ==, 8080);
+
+    g_object_unref(uri);
+    g_uri_unref(guri);
+}
+
+static void relative(void)
+{
+    UpgUri* uri = upg_uri_new("a/b", NULL);
+    g_assert_null(upg_uri_to_guri(uri));
+    g_object_unref(uri);
+
+    uri = upg_uri_new("mailto:someone@example.com", NULL);
+    GUri* guri = upg_uri_to_guri(uri);
+    g_assert_cmpstr(g_uri_get_path(guri), ==, "someone@example.com");
+
+    UpgUri* back = upg_uri_new_from_guri(guri);
+    g_assert_true(upg_uri_equal(uri, back));
+
+    g_object_unref(back);
+    g_uri_unref(guri);
+    g_object_unref(uri);
+}
+#else
+static void skip(void)
+{
+    g_test_skip("GUri needs GLib 2.66");
+}
+#endif
+
+declare_tests
+{
+#if GLIB_CHECK_VERSION(2, 66, 0)
+    g_test_add_func("/upg_uri_to_guri", to_guri);
+    g_test_add_func("/upg_uri_to_guri/relative", relative);
+    g_test_add_func("/upg_uri_new_from_guri", from_guri);
+    g_test_add_func("/upg_uri_new_from_guri/decoded", from_guri_decoded);
+    g_test_add_func("/upg_uri_new_from_guri/normalized", from_guri_normalized);
+#else
+    g_test_add_func("/upg_uri_to_guri", skip);
+#endif
+}
@@ -0,0 +1,118 @@
+/* idna.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void ascii_hosts_unchanged(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        gchar* host = upg_uri_get_host(uri);
+        gchar* ascii = upg_uri_get_host_ascii(uri);
+        gchar* unicode = upg_uri_get_host_unicode(uri);
+        g_assert_cmpstr(ascii, ==, host);
+        g_assert_cmpstr(unicode, ==, host);
+
+        g_free(host);
+        g_free(ascii);
+        g_free(unicode);
+        g_object_unref(uri);
+    }
+}
+
+static void normalized_on_parse(void)
+{
+    UpgUri* uri = upg_uri_new("http://B%C3%BCcher.example/a", NULL);
+
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://xn--bcher-kva.example/a");
+    g_free(str);
+
+    gchar* unicode = upg_uri_get_host_unicode(uri);
+    g_assert_cmpstr(unicode, ==, "b\xc3\xbc" "cher.example");
+    g_free(unicode);
+
+    g_object_unref(uri);
+}
+
+static void conversions(void)
+{
+    UpgUri* uri = upg_uri_new("http://xn--bcher-kva.example/", NULL);
+
+    // twice, so the second comes from the cache
+    for (gint i = 0; i < 2; i++) {
+        gchar* unicode = upg_uri_get_host_unicode(uri);
+        g_assert_cmpstr(unicode, ==, "b\xc3\xbc" "cher.example");
+        g_free(unicode);
+
+        gchar* ascii = upg_uri_get_host_ascii(uri);
+        g_assert_cmpstr(ascii, ==, "xn--bcher-kva.example");
+        g_free(ascii);
+    }
+
+    upg_uri_set_host(uri, "b\xc3\xbc" "cher.example");
+    gchar* ascii = upg_uri_get_host_ascii(uri);
+    g_assert_cmpstr(ascii, ==, "xn--bcher-kva.example");
+    g_free(ascii);
+
+    g_object_unref(uri);
+}
+
+static void invalid(void)
+{
+    UpgUri* uri = upg_uri_new("http://%FF%FE.example/", NULL);
+
+    gchar* host = upg_uri_get_host(uri);
+    g_assert_cmpstr(host, ==, "%FF%FE.example");
+    g_free(host);
+
+    g_assert_null(upg_uri_get_host_ascii(uri));
+    g_assert_null(upg_uri_get_host_unicode(uri));
+
+    g_object_unref(uri);
+}
+
+static void many_hosts(void)
+{
+    // more than the cache holds, so some are thrown out along the way
+    for (gint i = 0; i < 10000; i++) {
+        gchar* str = g_strdup_printf("http://h%d-%%C3%%A9.example/", i % 5000);
+        UpgUri* uri = upg_uri_new(str, NULL);
+
+        gchar* unicode = upg_uri_get_host_unicode(uri);
+        gchar* expected = g_strdup_printf("h%d-\xc3\xa9.example", i % 5000);
+        g_assert_cmpstr(unicode, ==, expected);
+
+        g_free(expected);
+        g_free(unicode);
+        g_object_unref(uri);
+        g_free(str);
+    }
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_get_host_ascii/ascii-hosts", ascii_hosts_unchanged);
+    g_test_add_func("/upg_uri_get_host_ascii/normalized-on-parse", normalized_on_parse);
+    g_test_add_func("/upg_uri_get_host_ascii/conversions", conversions);
+    g_test_add_func("/upg_uri_get_host_ascii/invalid", invalid);
+    g_test_add_func("/upg_uri_get_host_unicode/many-hosts", many_hosts);
+}
@@ -0,0 +1,116 @@
+/* limits.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void within_defaults(void)
+{
+    UpgLimits limits;
+    upg_limits_init_default(&limits);
+
+    FOR_EACH_CASE(tests)
+    {
+        GError* error = NULL;
+        UpgUri* uri = upg_uri_new_full(tests[i]->nonnormalized, &limits, &error);
+        g_assert_no_error(error);
+
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, tests[i]->uri);
+        g_free(str);
+
+        g_object_unref(uri);
+    }
+}
+
+static void over(void)
+{
+    static const struct {
+        const gchar* uri;
+        UpgLimits limits;
+    } cases[] = {
+        { "http://example.com/abcdef", { 20, 0, 0, 0 } },
+        { "http://example.com/a/b/c/d", { 0, 3, 0, 0 } },
+        { "http://example.com/a/b/c/", { 0, 3, 0, 0 } },
+        { "a/b/c/d", { 0, 3, 0, 0 } },
+        { "http://example.com/?a&b&c", { 0, 0, 2, 0 } },
+        { "http://example.com/a/../b/./c", { 0, 0, 0, 1 } },
+        { "http://example.com/%2e%2E/%2E", { 0, 0, 0, 1 } },
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        GError* error = NULL;
+        UpgUri* uri = upg_uri_new_full(cases[i].uri, &cases[i].limits, &error);
+        g_assert_null(uri);
+        g_assert_error(error, UPG_ERROR, UPG_ERR_LIMIT);
+        g_error_free(error);
+    }
+}
+
+static void under(void)
+{
+    static const struct {
+        const gchar* uri;
+        UpgLimits limits;
+    } cases[] = {
+        { "http://example.com/abcde", { 24, 0, 0, 0 } },
+        { "http://example.com/a/b/c", { 0, 3, 0, 0 } },
+        { "http://a/b/c/d/e/f/g/h/i/j/k/l#/m/n/o/p", { 0, 12, 0, 0 } },
+        { "http://example.com/?a&b#&c&d", { 0, 0, 2, 0 } },
+        { "http://example.com/a../.b/...", { 0, 0, 0, 1 } },
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        GError* error = NULL;
+        UpgUri* uri = upg_uri_new_full(cases[i].uri, &cases[i].limits, &error);
+        g_assert_no_error(error);
+        g_assert_nonnull(uri);
+        g_object_unref(uri);
+    }
+}
+
+static void kept(void)
+{
+    UpgLimits limits = { 0, 2, 0, 0 };
+    UpgUri* uri = upg_uri_new_full("http://example.com/a/b", &limits, NULL);
+    g_assert_nonnull(uri);
+
+    GError* error = NULL;
+    g_assert_false(upg_uri_configure_from_string(uri, "http://example.com/a/b/c", &error));
+    g_assert_error(error, UPG_ERROR, UPG_ERR_LIMIT);
+    g_clear_error(&error);
+
+    // a URI that's too big leaves the old one alone
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://example.com/a/b");
+    g_free(str);
+
+    upg_uri_set_limits(uri, NULL);
+    g_assert_true(upg_uri_configure_from_string(uri, "http://example.com/a/b/c", &error));
+    g_assert_no_error(error);
+
+    g_object_unref(uri);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_new_full/within-defaults", within_defaults);
+    g_test_add_func("/upg_uri_new_full/over", over);
+    g_test_add_func("/upg_uri_new_full/under", under);
+    g_test_add_func("/upg_uri_configure_from_string/limits-kept", kept);
+}
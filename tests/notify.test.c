@@ -0,0 +1,155 @@
+/* notify.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void count_notify(GObject* obj, GParamSpec* spec, GHashTable* seen)
+{
+    (void)obj;
+    const gchar* name = g_param_spec_get_name(spec);
+    guint count = GPOINTER_TO_UINT(g_hash_table_lookup(seen, name));
+    g_hash_table_insert(seen, (gpointer)name, GUINT_TO_POINTER(count + 1));
+}
+
+static void reparse_same_is_silent(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        GHashTable* seen = g_hash_table_new(g_str_hash, g_str_equal);
+        g_signal_connect(uri, "notify", G_CALLBACK(count_notify), seen);
+
+        g_assert_true(upg_uri_configure_from_string(uri, tests[i]->nonnormalized, NULL));
+        g_assert_cmpuint(g_hash_table_size(seen), ==, 0);
+
+        g_hash_table_unref(seen);
+        g_object_unref(uri);
+    }
+
+    // the host is stored as ASCII, which the text being parsed isn't
+    UpgUri* uri = upg_uri_new("http://b%C3%BCcher.example/a", NULL);
+    GHashTable* seen = g_hash_table_new(g_str_hash, g_str_equal);
+    g_signal_connect(uri, "notify", G_CALLBACK(count_notify), seen);
+
+    g_assert_true(upg_uri_configure_from_string(uri, "http://B%C3%BCcher.example/a", NULL));
+    g_assert_cmpuint(g_hash_table_size(seen), ==, 0);
+
+    g_hash_table_unref(seen);
+    g_object_unref(uri);
+}
+
+static void only_changes_are_notified(void)
+{
+    UpgUri* uri = upg_uri_new("https://example.com/a/b?q=1#top", NULL);
+    GHashTable* seen = g_hash_table_new(g_str_hash, g_str_equal);
+    g_signal_connect(uri, "notify", G_CALLBACK(count_notify), seen);
+
+    g_assert_true(upg_uri_configure_from_string(uri, "https://example.org/a/b?q=1#top", NULL));
+    g_assert_cmpuint(g_hash_table_size(seen), ==, 1);
+    g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "host")), ==, 1);
+    g_hash_table_remove_all(seen);
+
+    g_assert_true(upg_uri_configure_from_string(uri, "https://example.org/a/c?q=1#top", NULL));
+    g_assert_cmpuint(g_hash_table_size(seen), ==, 2);
+    g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "path")), ==, 1);
+    g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "path-str")), ==, 1);
+    g_hash_table_remove_all(seen);
+
+    upg_uri_set_scheme(uri, "https");
+    upg_uri_set_query_str(uri, "?q=1");
+    upg_uri_set_fragment(uri, "top");
+    upg_uri_set_port(uri, 0);
+    g_assert_cmpuint(g_hash_table_size(seen), ==, 0);
+
+    upg_uri_set_userinfo(uri, "user");
+    g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "userinfo")), ==, 1);
+    g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "username")), ==, 1);
+    g_hash_table_remove_all(seen);
+
+    g_assert_true(upg_uri_configure_from_string(uri, NULL, NULL));
+    g_assert_nonnull(g_hash_table_lookup(seen, "scheme"));
+    g_assert_nonnull(g_hash_table_lookup(seen, "fragment"));
+    g_assert_null(g_hash_table_lookup(seen, "port"));
+
+    g_hash_table_unref(seen);
+    g_object_unref(uri);
+}
+
+static void check_finished(GObject* obj, GParamSpec* spec, gpointer data)
+{
+    (void)spec;
+    (void)data;
+
+    // the notifications are frozen until everything is in place
+    gchar* str = upg_uri_to_string(UPG_URI(obj));
+    g_assert_cmpstr(str, ==, "gopher://example.net:70/1/x");
+    g_free(str);
+}
+
+static void notifications_are_coalesced(void)
+{
+    UpgUri* uri = upg_uri_new("https://example.com/a/b?q=1#top", NULL);
+    g_signal_connect(uri, "notify", G_CALLBACK(check_finished), NULL);
+
+    g_assert_true(upg_uri_configure_from_string(uri, "gopher://example.net:70/1/x", NULL));
+
+    g_object_unref(uri);
+}
+
+static void reconfigure_on_host(GObject* obj, GParamSpec* spec, gpointer data)
+{
+    (void)spec;
+    UpgUri* uri = UPG_URI(obj);
+    gboolean* done = data;
+
+    // everything about the new URI is there by the time anyone hears of it
+    UpgHostType type;
+    g_assert_nonnull(upg_uri_get_host_address(uri, &type));
+    g_assert_cmpint(type, ==, UPG_HOST_IPV4);
+    g_assert_cmpuint(upg_uri_get_port(uri), ==, 8080);
+
+    if (!*done) {
+        *done = TRUE;
+        g_assert_true(upg_uri_configure_from_string(uri, "http://192.0.2.2:8080/inner", NULL));
+    }
+}
+
+static void reconfigure_while_notifying(void)
+{
+    gboolean done = FALSE;
+    UpgUri* uri = upg_uri_new("http://192.0.2.0:8080/", NULL);
+    g_signal_connect(uri, "notify::host", G_CALLBACK(reconfigure_on_host), &done);
+
+    g_assert_true(upg_uri_configure_from_string(uri, "http://192.0.2.1:8080/outer", NULL));
+    g_assert_true(done);
+
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://192.0.2.2:8080/inner");
+    g_free(str);
+
+    g_object_unref(uri);
+}
+
+declare_tests
+{
+    g_test_add_func("/notify/reparse-same-is-silent", reparse_same_is_silent);
+    g_test_add_func("/notify/only-changes", only_changes_are_notified);
+    g_test_add_func("/notify/coalesced", notifications_are_coalesced);
+    g_test_add_func("/notify/reentrant", reconfigure_while_notifying);
+}
@@ -0,0 +1,184 @@
+/* params.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void assert_slice(const UpgSlice* slice, const gchar* expected)
+{
+    if (expected == NULL) {
+        g_assert_null(slice->data);
+        g_assert_cmpuint(slice->len, ==, 0);
+    } else {
+        g_assert_cmpmem(slice->data, slice->len, expected, strlen(expected));
+    }
+}
+
+static void matches_table(GHashTable* table, UpgParamIter* iter)
+{
+    UpgSlice key;
+    UpgSlice value;
+    guint count = 0;
+
+    while (upg_param_iter_next(iter, &key, &value)) {
+        gchar* key_str = g_strndup(key.data, key.len);
+        g_assert_true(g_hash_table_contains(table, key_str));
+        assert_slice(&value, g_hash_table_lookup(table, key_str));
+        g_free(key_str);
+        count++;
+    }
+
+    g_assert_cmpuint(count, ==, g_hash_table_size(table));
+}
+
+static void query_params(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        UpgParamIter iter;
+        upg_param_iter_init_query(&iter, uri);
+
+        if (tests[i]->query == NULL) {
+            g_assert_false(upg_param_iter_next(&iter, NULL, NULL));
+            g_assert_false(upg_uri_get_query_param(uri, "a", NULL));
+        } else {
+            matches_table(tests[i]->query, &iter);
+
+            for (GList* key = tests[i]->query_order; key != NULL; key = key->next) {
+                UpgSlice value;
+                g_assert_true(upg_uri_get_query_param(uri, key->data, &value));
+                assert_slice(&value, g_hash_table_lookup(tests[i]->query, key->data));
+            }
+        }
+
+        g_object_unref(uri);
+    }
+}
+
+static void fragment_params(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        if (tests[i]->fragment_params == NULL) {
+            continue;
+        }
+
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        UpgParamIter iter;
+        upg_param_iter_init_fragment(&iter, uri);
+        matches_table(tests[i]->fragment_params, &iter);
+
+        g_object_unref(uri);
+    }
+}
+
+static void lookup(void)
+{
+    UpgUri* uri = upg_uri_new("http://example.com/?a=1&&b&c=&a=2&n=-42&f=2.5&t=yes&name=J%C3%B6rg+M", NULL);
+    UpgSlice value;
+
+    g_assert_true(upg_uri_get_query_param(uri, "a", &value));
+    assert_slice(&value, "1");
+    g_assert_true(upg_uri_get_query_param(uri, "b", &value));
+    assert_slice(&value, NULL);
+    g_assert_true(upg_uri_get_query_param(uri, "c", &value));
+    assert_slice(&value, "");
+    g_assert_false(upg_uri_get_query_param(uri, "", NULL));
+    g_assert_false(upg_uri_get_query_param(uri, "missing", NULL));
+    g_assert_false(upg_uri_get_fragment_param(uri, "a", NULL));
+
+    gint64 n = 0;
+    g_assert_true(upg_uri_get_query_param_int64(uri, "n", &n));
+    g_assert_cmpint(n, ==, -42);
+    g_assert_false(upg_uri_get_query_param_int64(uri, "f", &n));
+    g_assert_cmpint(n, ==, -42);
+
+    gdouble f = 0;
+    g_assert_true(upg_uri_get_query_param_double(uri, "f", &f));
+    g_assert_cmpfloat(f, ==, 2.5);
+
+    gboolean t = FALSE;
+    g_assert_true(upg_uri_get_query_param_boolean(uri, "t", &t));
+    g_assert_true(t);
+    t = FALSE;
+    g_assert_true(upg_uri_get_query_param_boolean(uri, "b", &t));
+    g_assert_true(t);
+    g_assert_false(upg_uri_get_query_param_boolean(uri, "n", &t));
+
+    g_assert_true(upg_uri_get_query_param(uri, "name", &value));
+    gchar buf[32];
+    gsize written = 0;
+    g_assert_true(upg_slice_unescape(&value, TRUE, buf, sizeof(buf), &written));
+    g_assert_cmpstr(buf, ==, "J\xc3\xb6rg M");
+    g_assert_cmpuint(written, ==, strlen("J\xc3\xb6rg M"));
+    g_assert_false(upg_slice_unescape(&value, TRUE, buf, 4, &written));
+    g_assert_cmpuint(written, ==, strlen("J\xc3\xb6rg M"));
+
+    g_object_unref(uri);
+}
+
+static void slices(void)
+{
+    static const struct {
+        const gchar* text;
+        gboolean valid;
+        gint64 value;
+    } ints[] = {
+        { "0", TRUE, 0 },
+        { "+17", TRUE, 17 },
+        { "-9223372036854775808", TRUE, G_MININT64 },
+        { "9223372036854775807", TRUE, G_MAXINT64 },
+        { "9223372036854775808", FALSE, 0 },
+        { "-", FALSE, 0 },
+        { "", FALSE, 0 },
+        { " 1", FALSE, 0 },
+        { "1x", FALSE, 0 },
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(ints); i++) {
+        UpgSlice slice = { ints[i].text, strlen(ints[i].text) };
+        gint64 value = 0;
+        g_assert_cmpint(upg_slice_to_int64(&slice, &value), ==, ints[i].valid);
+        g_assert_cmpint(value, ==, ints[i].value);
+    }
+
+    // the slice isn't nul-terminated where it ends
+    UpgSlice partial = { "1.5e3junk", 5 };
+    gdouble d = 0;
+    g_assert_true(upg_slice_to_double(&partial, &d));
+    g_assert_cmpfloat(d, ==, 1500);
+
+    UpgSlice bad = { "%zz%4", 5 };
+    gchar buf[8];
+    g_assert_true(upg_slice_unescape(&bad, FALSE, buf, sizeof(buf), NULL));
+    g_assert_cmpstr(buf, ==, "%zz%4");
+
+    UpgSlice off = { "OFF", 3 };
+    gboolean b = TRUE;
+    g_assert_true(upg_slice_to_boolean(&off, &b));
+    g_assert_false(b);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_param_iter/query", query_params);
+    g_test_add_func("/upg_param_iter/fragment", fragment_params);
+    g_test_add_func("/upg_uri_get_query_param", lookup);
+    g_test_add_func("/upg_slice", slices);
+}
@@ -44,9 +44,53 @@ void new_returns_null_on_error()
     GError* error = NULL;
     g_assert_null(upg_uri_new("ä", &error));
     g_assert_error(error, UPG_ERROR, UPG_ERR_PARSE);
+    g_assert_nonnull(strstr(error->message, "at offset 0"));
     g_error_free(error);
 }
 
+void is_valid_matches_new()
+{
+    FOR_EACH_CASE(tests)
+    {
+        gsize offset = 12345;
+        g_assert_true(upg_uri_is_valid(tests[i]->uri, -1, &offset));
+        g_assert_true(upg_uri_is_valid(tests[i]->nonnormalized, strlen(tests[i]->nonnormalized), NULL));
+        g_assert_cmpuint(offset, ==, 12345);
+    }
+
+    static const struct {
+        const gchar* uri;
+        gsize offset;
+    } invalid[] = {
+        { "\xc3\xa4", 0 },
+        { "http://exa mple.com/", 10 },
+        { "http://example.com/a b", 20 },
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(invalid); i++) {
+        gsize offset = 0;
+        g_assert_false(upg_uri_is_valid(invalid[i].uri, -1, &offset));
+        g_assert_cmpuint(offset, ==, invalid[i].offset);
+        g_assert_null(upg_uri_new(invalid[i].uri, NULL));
+    }
+
+    g_assert_true(upg_uri_is_valid(NULL, -1, NULL));
+    g_assert_true(upg_uri_is_valid("", 0, NULL));
+    g_assert_true(upg_uri_is_valid("http://example.com/a b", 20, NULL));
+
+    // more segments than fit on the stack
+    GString* many = g_string_new("http://example.com");
+    for (guint i = 0; i < 1000; i++) {
+        g_string_append(many, "/segment");
+    }
+    g_assert_true(upg_uri_is_valid(many->str, many->len, NULL));
+    g_string_append(many, "/{");
+    gsize offset = 0;
+    g_assert_false(upg_uri_is_valid(many->str, many->len, &offset));
+    g_assert_cmpuint(offset, ==, many->len - 1);
+    g_string_free(many, TRUE);
+}
+
 void are_normalized()
 {
     FOR_EACH_CASE(tests)
@@ -139,6 +183,103 @@ void host_is_resettable()
     }
 }
 
+void host_type_is_correct()
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        UpgHostType type;
+        const guint8* address = upg_uri_get_host_address(uri, &type);
+        g_assert_cmpint(type, ==, upg_uri_get_host_type(uri));
+
+        if (tests[i]->hostdata_proto != 0) {
+            g_assert_cmpint(type, ==, tests[i]->hostdata_proto == 4 ? UPG_HOST_IPV4 : UPG_HOST_IPV6);
+            gint protodlen = tests[i]->hostdata_proto == 4 ? 4 : 16;
+            g_assert_cmpmem(address, protodlen, tests[i]->hostdata_data, protodlen);
+        } else {
+            g_assert_null(address);
+        }
+
+        g_object_unref(uri);
+    }
+}
+
+void host_type_follows_set()
+{
+    static const struct {
+        const gchar* host;
+        UpgHostType type;
+        guint8 data[16];
+    } hosts[] = {
+        { "example.com", UPG_HOST_REG_NAME, { 0 } },
+        { "192.168.0.1", UPG_HOST_IPV4, { 192, 168, 0, 1 } },
+        { "192.168.00.1", UPG_HOST_REG_NAME, { 0 } },
+        { "256.0.0.1", UPG_HOST_REG_NAME, { 0 } },
+        { "1.2.3", UPG_HOST_REG_NAME, { 0 } },
+        { "::1", UPG_HOST_IPV6, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } },
+        { "v1.fe80::a", UPG_HOST_IPVFUTURE, { 0 } },
+    };
+
+    UpgUri* uri = upg_uri_new("http://example.org:8080/", NULL);
+
+    for (gsize i = 0; i < G_N_ELEMENTS(hosts); i++) {
+        upg_uri_set_host(uri, hosts[i].host);
+
+        UpgHostType type;
+        const guint8* address = upg_uri_get_host_address(uri, &type);
+        g_assert_cmpint(type, ==, hosts[i].type);
+        if (type == UPG_HOST_IPV4 || type == UPG_HOST_IPV6) {
+            gint len = type == UPG_HOST_IPV4 ? 4 : 16;
+            g_assert_cmpmem(address, len, hosts[i].data, len);
+
+            guint8 protocol;
+            guint8* data = upg_uri_get_host_data(uri, &protocol);
+            g_assert_cmpint(protocol, ==, type == UPG_HOST_IPV4 ? 4 : 6);
+            g_assert_cmpmem(data, len, hosts[i].data, len);
+            g_free(data);
+        } else {
+            g_assert_null(address);
+        }
+    }
+
+    // URIs put together by a builder are classified the same way
+    UpgUriBuilder* builder = upg_uri_builder_new();
+    upg_uri_builder_set_scheme(builder, "http");
+    upg_uri_builder_set_port(builder, 8080);
+
+    for (gsize i = 0; i < G_N_ELEMENTS(hosts); i++) {
+        upg_uri_builder_set_host(builder, hosts[i].host);
+        UpgUri* built = upg_uri_builder_to_uri(builder);
+
+        UpgHostType type;
+        const guint8* address = upg_uri_get_host_address(built, &type);
+        g_assert_cmpint(type, ==, hosts[i].type);
+        g_assert_cmpint(upg_uri_get_host_type(built), ==, hosts[i].type);
+        if (type == UPG_HOST_IPV4 || type == UPG_HOST_IPV6) {
+            gint len = type == UPG_HOST_IPV4 ? 4 : 16;
+            g_assert_cmpmem(address, len, hosts[i].data, len);
+        } else {
+            g_assert_null(address);
+        }
+        g_assert_cmpuint(upg_uri_get_port(built), ==, 8080);
+
+        upg_uri_unref(built);
+    }
+
+    g_object_unref(builder);
+
+    upg_uri_set_host(uri, "::1");
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://[0000:0000:0000:0000:0000:0000:0000:0001]:8080/");
+    g_free(str);
+
+    upg_uri_set_host(uri, NULL);
+    g_assert_cmpint(upg_uri_get_host_type(uri), ==, UPG_HOST_NONE);
+
+    g_object_unref(uri);
+}
+
 void properties_work()
 {
     FOR_EACH_CASE(tests)
@@ -352,10 +493,13 @@ declare_tests
     g_test_add_func("/urigobj/version-check-accurate", version_check_accurate);
     g_test_add_func("/urigobj/new-returns-instance", new_returns_instance);
     g_test_add_func("/urigobj/new-returns-null-on-error", new_returns_null_on_error);
+    g_test_add_func("/urigobj/is-valid-matches-new", is_valid_matches_new);
     g_test_add_func("/urigobj/are-normalized", are_normalized);
     g_test_add_func("/urigobj/to-string-is-reparsable", to_string_is_reparsable);
     g_test_add_func("/urigobj/host-is-correct", host_is_correct);
     g_test_add_func("/urigobj/host-is-resettable", host_is_resettable);
+    g_test_add_func("/urigobj/host-type-is-correct", host_type_is_correct);
+    g_test_add_func("/urigobj/host-type-follows-set", host_type_follows_set);
     g_test_add_func("/urigobj/properties-work", properties_work);
     g_test_add_func("/urigobj/path-segments-are-right", path_segments_are_right);
     g_test_add_func("/urigobj/query-is-right", query_is_right);
@@ -103,10 +103,28 @@ static void change_port_property_recv_property()
     }
 }
 
+static void port_follows_reparse()
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new("http://example.com:1234/", NULL);
+        g_assert_cmpuint(upg_uri_get_port(uri), ==, 1234);
+
+        upg_uri_set_port(uri, 0);
+        g_assert_cmpuint(upg_uri_get_port(uri), ==, 0);
+
+        g_assert_true(upg_uri_configure_from_string(uri, tests[i]->uri, NULL));
+        g_assert_cmpuint(upg_uri_get_port(uri), ==, tests[i]->port);
+
+        g_object_unref(uri);
+    }
+}
+
 declare_tests
 {
     g_test_add_func("/upg_uri_get_port", get_port);
     g_test_add_func("/upg_uri_set_port", change_port);
+    g_test_add_func("/upg_uri_get_port/after-reparse", port_follows_reparse);
     g_test_add_func("/gobject-properties/upg_uri_get_port", get_port_property);
     g_test_add_func("/gobject-properties/upg_uri_set_port (recieved without properties)", change_port_property_recv_normal);
     g_test_add_func("/gobject-properties/upg_uri_set_port (recieved with properties)", change_port_property_recv_property);
@@ -0,0 +1,180 @@
+/* queryfilter.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+typedef struct {
+    const gchar* uri;
+    const gchar* filtered;
+} FilterCase;
+
+static const FilterCase cases[] = {
+    { "http://example.com/a?utm_source=x&q=1&fbclid=abc&utm_medium=y&z", "http://example.com/a?q=1&z" },
+    { "http://example.com/?q=1&b=2", "http://example.com/?q=1&b=2" },
+    { "http://example.com/?utm_source=x", "http://example.com/" },
+    { "http://example.com/?dclid=1&gclid=2", "http://example.com/?gclid=2" },
+    { "http://example.com/?utm%5Fsource=x&a=1", "http://example.com/?a=1" },
+    { "http://example.com/?a=1&&b=2", "http://example.com/?a=1&b=2" },
+    { "http://example.com/?utm_x=1&?b", "http://example.com/??b" },
+    { "http://example.com/?", "http://example.com/?" },
+    { "http://shop.example/item?page=2&ref=abc&id=5&utm_source=x", "http://shop.example/item?page=2&id=5" },
+    { "http://shop.example/?x=1", "http://shop.example/" },
+};
+
+static UpgQueryFilter* make_filter(void)
+{
+    UpgQueryFilter* filter = upg_query_filter_new();
+    upg_query_filter_add_rule(filter, NULL, "utm_*", UPG_QUERY_FILTER_REMOVE);
+    upg_query_filter_add_rule(filter, NULL, "fbclid", UPG_QUERY_FILTER_REMOVE);
+    upg_query_filter_add_rule(filter, NULL, "*clid", UPG_QUERY_FILTER_REMOVE);
+    upg_query_filter_add_rule(filter, NULL, "gclid", UPG_QUERY_FILTER_KEEP);
+
+    upg_query_filter_set_default(filter, "Shop.Example", UPG_QUERY_FILTER_REMOVE);
+    upg_query_filter_add_rule(filter, "shop.example", "id", UPG_QUERY_FILTER_KEEP);
+    upg_query_filter_add_rule(filter, "shop.example", "page", UPG_QUERY_FILTER_KEEP);
+    return filter;
+}
+
+static void apply(void)
+{
+    UpgQueryFilter* filter = make_filter();
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        UpgUri* uri = upg_uri_new(cases[i].uri, NULL);
+        g_assert_nonnull(uri);
+
+        gboolean changed = upg_query_filter_apply(filter, uri);
+        g_assert_cmpint(changed, ==, strcmp(cases[i].uri, cases[i].filtered) != 0);
+
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, cases[i].filtered);
+        g_free(str);
+
+        g_object_unref(uri);
+    }
+
+    g_object_unref(filter);
+}
+
+static void empty_filter_keeps_everything(void)
+{
+    UpgQueryFilter* filter = upg_query_filter_new();
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        g_assert_false(upg_query_filter_apply(filter, uri));
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, tests[i]->uri);
+        g_free(str);
+
+        g_object_unref(uri);
+    }
+
+    g_object_unref(filter);
+}
+
+static void remove_all_tests(void)
+{
+    UpgQueryFilter* filter = upg_query_filter_new();
+    upg_query_filter_add_rule(filter, NULL, "*", UPG_QUERY_FILTER_REMOVE);
+
+    FOR_EACH_CASE(tests)
+    {
+        // everything from the '?' up to the fragment goes
+        GString* expected = g_string_new(tests[i]->uri);
+        const gchar* query = strchr(tests[i]->uri, '?');
+        if (query != NULL) {
+            const gchar* fragment = strchr(query, '#');
+            gsize len = fragment != NULL ? (gsize)(fragment - query) : strlen(query);
+            g_string_erase(expected, query - tests[i]->uri, len);
+        }
+
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        g_assert_cmpint(upg_query_filter_apply(filter, uri), ==, tests[i]->query != NULL);
+
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, expected->str);
+        g_free(str);
+
+        g_object_unref(uri);
+        g_string_free(expected, TRUE);
+    }
+
+    g_object_unref(filter);
+}
+
+static void lookup(void)
+{
+    UpgQueryFilter* filter = make_filter();
+    upg_query_filter_add_rule(filter, NULL, "a*b?c", UPG_QUERY_FILTER_REMOVE);
+
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "utm_", -1), ==, UPG_QUERY_FILTER_REMOVE);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "utm", -1), ==, UPG_QUERY_FILTER_KEEP);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "fbclid", -1), ==, UPG_QUERY_FILTER_REMOVE);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "gclid", -1), ==, UPG_QUERY_FILTER_KEEP);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "msclid", -1), ==, UPG_QUERY_FILTER_REMOVE);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "utm_sourcexyz", 3), ==, UPG_QUERY_FILTER_KEEP);
+
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "abxc", -1), ==, UPG_QUERY_FILTER_REMOVE);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "aXXbyc", -1), ==, UPG_QUERY_FILTER_REMOVE);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "abc", -1), ==, UPG_QUERY_FILTER_KEEP);
+    g_assert_cmpint(upg_query_filter_lookup(filter, NULL, "abxcd", -1), ==, UPG_QUERY_FILTER_KEEP);
+
+    g_assert_cmpint(upg_query_filter_lookup(filter, "SHOP.EXAMPLE", "id", -1), ==, UPG_QUERY_FILTER_KEEP);
+    g_assert_cmpint(upg_query_filter_lookup(filter, "shop.example", "ref", -1), ==, UPG_QUERY_FILTER_REMOVE);
+    g_assert_cmpint(upg_query_filter_lookup(filter, "example.com", "ref", -1), ==, UPG_QUERY_FILTER_KEEP);
+
+    g_object_unref(filter);
+}
+
+static void long_query(void)
+{
+    GString* query = g_string_new(NULL);
+    GString* expected = g_string_new("http://example.com/?");
+    for (gint i = 0; i < 200; i++) {
+        g_string_append_printf(query, "%sp%d=1&utm_%d=1", i == 0 ? "" : "&", i, i);
+        g_string_append_printf(expected, "%sp%d=1", i == 0 ? "" : "&", i);
+    }
+
+    UpgUri* uri = upg_uri_new("http://example.com/", NULL);
+    upg_uri_set_query_str(uri, query->str);
+
+    UpgQueryFilter* filter = make_filter();
+    g_assert_true(upg_query_filter_apply(filter, uri));
+
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, expected->str);
+    g_free(str);
+
+    g_object_unref(filter);
+    g_object_unref(uri);
+    g_string_free(query, TRUE);
+    g_string_free(expected, TRUE);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_query_filter_apply", apply);
+    g_test_add_func("/upg_query_filter_apply/empty", empty_filter_keeps_everything);
+    g_test_add_func("/upg_query_filter_apply/remove-all", remove_all_tests);
+    g_test_add_func("/upg_query_filter_apply/long-query", long_query);
+    g_test_add_func("/upg_query_filter_lookup", lookup);
+}
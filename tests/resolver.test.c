@@ -0,0 +1,206 @@
+/* resolver.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static const gchar* references[] = {
+    "../1/../2/aaaa/bbbb/cccc/../file",
+    "",
+    "#section",
+    "#",
+    "#%7euser",
+    "?page=2",
+    "?page=2#top",
+    "?",
+    "/about/team/",
+    "/about/./team",
+    "/",
+    "//example.org/elsewhere",
+    "//b%C3%BCcher.example/shelf",
+    "mailto:someone@example.com",
+    NULL,
+};
+
+static void resolves_like_apply_reference(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* base = upg_uri_new(tests[i]->uri, NULL);
+        UpgBaseResolver* resolver = upg_base_resolver_new(base, NULL);
+        g_assert_nonnull(resolver);
+
+        for (const gchar** reference = references; *reference != NULL; reference++) {
+            UpgUri* applied = upg_uri_apply_reference(base, *reference, NULL);
+            gchar* expected = upg_uri_to_string(applied);
+
+            gchar* str = upg_base_resolver_resolve_to_string(resolver, *reference, NULL);
+            g_assert_cmpstr(str, ==, expected);
+            g_free(str);
+
+            UpgUri* resolved = upg_base_resolver_resolve(resolver, *reference, NULL);
+            g_assert_true(upg_uri_equal(resolved, applied));
+            g_object_unref(resolved);
+
+            g_free(expected);
+            g_object_unref(applied);
+        }
+
+        g_object_unref(resolver);
+        g_object_unref(base);
+    }
+}
+
+static void resolves_many(void)
+{
+    UpgUri* base = upg_uri_new("https://example.com/a/b?c#d", NULL);
+    UpgBaseResolver* resolver = upg_base_resolver_new(base, NULL);
+
+    const gchar* batch[] = { "e", "ä", "#f", "/g" };
+    gsize offsets[G_N_ELEMENTS(batch)];
+    GString* out = g_string_new(NULL);
+
+    g_assert_cmpuint(upg_base_resolver_resolve_many(resolver, batch, G_N_ELEMENTS(batch), out, offsets), ==, 3);
+    g_assert_cmpstr(out->str + offsets[0], ==, "https://example.com/a/e");
+    g_assert_cmpuint(offsets[1], ==, UPG_BASE_RESOLVER_FAILED);
+    g_assert_cmpstr(out->str + offsets[2], ==, "https://example.com/a/b?c#f");
+    g_assert_cmpstr(out->str + offsets[3], ==, "https://example.com/g");
+
+    gsize len = 0;
+    const gchar* view = upg_base_resolver_resolve_view(resolver, "?x", &len, NULL);
+    g_assert_cmpstr(view, ==, "https://example.com/a/b?x");
+    g_assert_cmpuint(len, ==, strlen(view));
+
+    view = upg_base_resolver_resolve_view(resolver, "http://b%C3%BCcher.example/a", NULL, NULL);
+    g_assert_cmpstr(view, ==, "http://xn--bcher-kva.example/a");
+
+    g_string_free(out, TRUE);
+    g_object_unref(resolver);
+    g_object_unref(base);
+}
+
+static void resolver_throws_when_needed(void)
+{
+    GError* err = NULL;
+
+    UpgUri* relative = upg_uri_new("example", NULL);
+    g_assert_null(upg_base_resolver_new(relative, &err));
+    g_assert_error(err, UPG_ERROR, UPG_ERR_REFERENCE);
+    g_clear_error(&err);
+    g_object_unref(relative);
+
+    UpgUri* base = upg_uri_new("https://example.edu", NULL);
+    UpgBaseResolver* resolver = upg_base_resolver_new(base, NULL);
+    g_assert_null(upg_base_resolver_resolve_to_string(resolver, "ä", &err));
+    g_assert_error(err, UPG_ERROR, UPG_ERR_PARSE);
+    g_clear_error(&err);
+
+    g_object_unref(resolver);
+    g_object_unref(base);
+}
+
+static void assert_subtracts_to(UpgUri* base, const gchar* target, const gchar* reference)
+{
+    UpgUri* applied = upg_uri_apply_reference(base, reference, NULL);
+    g_assert_nonnull(applied);
+
+    gchar* str = upg_uri_to_string(applied);
+    g_assert_cmpstr(str, ==, target);
+    g_free(str);
+
+    g_object_unref(applied);
+}
+
+static void subtracts_many(void)
+{
+    Test* all = get_tests();
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* base = upg_uri_new(tests[i]->uri, NULL);
+        UpgBaseResolver* resolver = upg_base_resolver_new(base, NULL);
+        GPtrArray* targets = g_ptr_array_new_with_free_func(g_object_unref);
+
+        for (gint j = 0; all[j] != NULL; j++) {
+            g_ptr_array_add(targets, upg_uri_new(all[j]->uri, NULL));
+        }
+
+        for (const gchar** reference = references; *reference != NULL; reference++) {
+            g_ptr_array_add(targets, upg_base_resolver_resolve(resolver, *reference, NULL));
+        }
+
+        GString* out = g_string_new(NULL);
+        gsize* offsets = g_new(gsize, targets->len);
+        upg_base_resolver_subtract_many(resolver, (UpgUri**)targets->pdata, targets->len, out, offsets);
+
+        for (guint j = 0; j < targets->len; j++) {
+            gchar* target = upg_uri_to_string(targets->pdata[j]);
+            assert_subtracts_to(base, target, out->str + offsets[j]);
+            g_free(target);
+        }
+
+        g_free(offsets);
+        g_string_free(out, TRUE);
+        g_ptr_array_unref(targets);
+        g_object_unref(resolver);
+        g_object_unref(base);
+    }
+}
+
+static void subtracts_shortest(void)
+{
+    UpgUri* base = upg_uri_new("https://example.com/a/b/c?d#e", NULL);
+    UpgBaseResolver* resolver = upg_base_resolver_new(base, NULL);
+
+    const gchar* cases[][2] = {
+        { "https://example.com/a/b/c?d#f", "#f" },
+        { "https://example.com/a/b/c?d", "" },
+        { "https://example.com/a/b/c?g", "?g" },
+        { "https://example.com/a/b/c", "c" },
+        { "https://example.com/a/b/", "./" },
+        { "https://example.com/a/b/h/i", "h/i" },
+        { "https://example.com/a/j", "../j" },
+        { "https://example.com/k", "/k" },
+        { "https://example.com/a/b/l:m", "./l:m" },
+        { "https://example.org/a", "//example.org/a" },
+        { "http://example.com/a/b/c", "http://example.com/a/b/c" },
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        UpgUri* target = upg_uri_new(cases[i][0], NULL);
+
+        gchar* reference = upg_base_resolver_subtract(resolver, target);
+        g_assert_cmpstr(reference, ==, cases[i][1]);
+        assert_subtracts_to(base, cases[i][0], reference);
+        g_free(reference);
+
+        g_object_unref(target);
+    }
+
+    g_object_unref(resolver);
+    g_object_unref(base);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_base_resolver_resolve", resolves_like_apply_reference);
+    g_test_add_func("/upg_base_resolver_resolve_many", resolves_many);
+    g_test_add_func("/upg_base_resolver_new: throws when needed", resolver_throws_when_needed);
+    g_test_add_func("/upg_base_resolver_subtract_many", subtracts_many);
+    g_test_add_func("/upg_base_resolver_subtract", subtracts_shortest);
+}
@@ -0,0 +1,147 @@
+/* reuse.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void parser_parses_everything(void)
+{
+    UpgUriParser* parser = upg_uri_parser_new();
+
+    // twice, so that the second round runs on recycled memory
+    for (gint round = 0; round < 2; round++) {
+        FOR_EACH_CASE(tests)
+        {
+            GError* error = NULL;
+            UpgUri* uri = upg_uri_parser_parse(parser, tests[i]->nonnormalized, -1, &error);
+            g_assert_no_error(error);
+            g_assert_true(uri == upg_uri_parser_get_uri(parser));
+
+            gchar* str = upg_uri_to_string(uri);
+            g_assert_cmpstr(str, ==, tests[i]->uri);
+            g_free(str);
+
+            gchar* host = upg_uri_get_host(uri);
+            g_assert_cmpstr(host, ==, tests[i]->host);
+            g_free(host);
+        }
+    }
+
+    g_object_unref(parser);
+}
+
+static void parser_keeps_uri_on_failure(void)
+{
+    UpgUriParser* parser = upg_uri_parser_new();
+
+    GError* error = NULL;
+    UpgUri* uri = upg_uri_parser_parse(parser, "https://example.com/a/b", -1, &error);
+    g_assert_no_error(error);
+
+    g_assert_null(upg_uri_parser_parse(parser, "ä", -1, &error));
+    g_assert_error(error, UPG_ERROR, UPG_ERR_PARSE);
+    g_clear_error(&error);
+
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "https://example.com/a/b");
+    g_free(str);
+
+    g_object_unref(parser);
+}
+
+static void parser_honours_length(void)
+{
+    UpgUriParser* parser = upg_uri_parser_new();
+
+    UpgUri* uri = upg_uri_parser_parse(parser, "https://example.com/path#ignored", 24, NULL);
+    g_assert_nonnull(uri);
+
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "https://example.com/path");
+    g_free(str);
+
+    g_object_unref(parser);
+}
+
+static void parser_uri_survives_parser(void)
+{
+    UpgUriParser* parser = upg_uri_parser_new();
+    UpgUri* uri = upg_uri_ref(upg_uri_parser_parse(parser, "https://example.com/", -1, NULL));
+    g_object_unref(parser);
+
+    // it's cleared rather than left pointing at freed memory
+    g_assert_null(upg_uri_get_host(uri));
+
+    upg_uri_set_host(uri, "example.org");
+    gchar* host = upg_uri_get_host(uri);
+    g_assert_cmpstr(host, ==, "example.org");
+    g_free(host);
+
+    upg_uri_unref(uri);
+}
+
+static void parse_again_on_notify(GObject* obj, GParamSpec* spec, UpgUriParser* parser)
+{
+    (void)obj;
+    (void)spec;
+
+    // long enough that the spare arena has to grow, which frees its memory
+    static gboolean done = FALSE;
+    if (done) {
+        return;
+    }
+    done = TRUE;
+
+    GString* inner = g_string_new("https://inner.example/");
+    for (gint i = 0; i < 200; i++) {
+        g_string_append(inner, "segment/");
+    }
+    g_assert_nonnull(upg_uri_parser_parse(parser, inner->str, -1, NULL));
+    g_string_free(inner, TRUE);
+}
+
+static void parser_reentered_from_notify(void)
+{
+    UpgUriParser* parser = upg_uri_parser_new();
+    UpgUri* uri = upg_uri_parser_parse(parser, "https://example.com/a", -1, NULL);
+    g_signal_connect(uri, "notify::host", G_CALLBACK(parse_again_on_notify), parser);
+
+    g_assert_nonnull(upg_uri_parser_parse(parser, "https://outer.example/b", -1, NULL));
+    gchar* host = upg_uri_get_host(uri);
+    g_assert_cmpstr(host, ==, "inner.example");
+    g_free(host);
+
+    // and the parser still knows which arena is which
+    for (gint round = 0; round < 3; round++) {
+        g_assert_nonnull(upg_uri_parser_parse(parser, "https://after.example/c", -1, NULL));
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, "https://after.example/c");
+        g_free(str);
+    }
+
+    g_object_unref(parser);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_parser_parse", parser_parses_everything);
+    g_test_add_func("/upg_uri_parser_parse/failure-keeps-uri", parser_keeps_uri_on_failure);
+    g_test_add_func("/upg_uri_parser_parse/length", parser_honours_length);
+    g_test_add_func("/upg_uri_parser_parse/reentrant", parser_reentered_from_notify);
+    g_test_add_func("/upg_uri_parser_get_uri/outlives-parser", parser_uri_survives_parser);
+}
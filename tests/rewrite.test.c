@@ -0,0 +1,230 @@
+/* rewrite.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+typedef struct {
+    const gchar* host;
+    const gchar* path;
+    const gchar* target;
+} RewriteRule;
+
+static const RewriteRule rules[] = {
+    { "old.example", "/blog/*", "https://blog.example/posts/" },
+    { "*.cdn.example", NULL, "https://cdn.example" },
+    { NULL, "/favicon.ico", "/static/favicon.ico" },
+    { "old.example", "/blog/*", "/never" },
+    { NULL, "/*/edit", "/editor?mode=1" },
+    { "Old.Example", "/", "https://new.example/" },
+    { "*", "/*", "/fallback" },
+};
+
+typedef struct {
+    const gchar* uri;
+    gint rule;
+    const gchar* rewritten;
+} RewriteCase;
+
+static const RewriteCase cases[] = {
+    { "http://old.example/blog/2020/a?x=1", 0, "https://blog.example/posts/2020/a?x=1" },
+    { "http://old.example/blog", 0, "https://blog.example/posts/" },
+    { "http://old.example/blog/", 0, "https://blog.example/posts/" },
+    { "http://a.b.cdn.example:8080/img/x.png", 1, "https://cdn.example/img/x.png" },
+    { "http://cdn.example/img/x.png", 6, "http://cdn.example/fallback/img/x.png" },
+    { "http://any.example/favicon.ico", 2, "http://any.example/static/favicon.ico" },
+    { "http://x.example/page/edit?y", 4, "http://x.example/editor?mode=1" },
+    { "http://old.example", 5, "https://new.example/" },
+    { "http://old.example/", 5, "https://new.example/" },
+    { "http://other.example/x#top", 6, "http://other.example/fallback/x#top" },
+};
+
+static UpgRewriteEngine* make_engine(void)
+{
+    UpgRewriteEngine* engine = upg_rewrite_engine_new();
+    for (gsize i = 0; i < G_N_ELEMENTS(rules); i++) {
+        GError* error = NULL;
+        gint rule = upg_rewrite_engine_add_rule(engine, rules[i].host, rules[i].path, rules[i].target, &error);
+        g_assert_no_error(error);
+        g_assert_cmpint(rule, ==, i);
+    }
+    g_assert_cmpuint(upg_rewrite_engine_get_n_rules(engine), ==, G_N_ELEMENTS(rules));
+    return engine;
+}
+
+static void apply(void)
+{
+    UpgRewriteEngine* engine = make_engine();
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        UpgUri* uri = upg_uri_new(cases[i].uri, NULL);
+        g_assert_nonnull(uri);
+
+        g_assert_cmpint(upg_rewrite_engine_match(engine, uri), ==, cases[i].rule);
+        g_assert_cmpint(upg_rewrite_engine_apply(engine, uri), ==, cases[i].rule);
+
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, cases[i].rewritten);
+        g_free(str);
+
+        g_object_unref(uri);
+    }
+
+    g_object_unref(engine);
+}
+
+static void no_match(void)
+{
+    UpgRewriteEngine* engine = upg_rewrite_engine_new();
+    g_assert_cmpint(upg_rewrite_engine_add_rule(engine, "example.com", "/a", "/b", NULL), ==, 0);
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        g_assert_cmpint(upg_rewrite_engine_apply(engine, uri), ==, -1);
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, tests[i]->uri);
+        g_free(str);
+
+        g_object_unref(uri);
+    }
+
+    g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 0), ==, 0);
+    g_object_unref(engine);
+}
+
+static void moves_tests(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        // there is no host to write a rule for in file:///etc/passwd
+        if (tests[i]->host == NULL || *tests[i]->host == '\0') {
+            continue;
+        }
+
+        UpgRewriteEngine* engine = upg_rewrite_engine_new();
+        g_assert_cmpint(upg_rewrite_engine_add_rule(engine, tests[i]->host, "/*", "/moved/", NULL), ==, 0);
+
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        g_assert_cmpint(upg_rewrite_engine_apply(engine, uri), ==, 0);
+
+        GList* expected = g_list_prepend(g_list_copy(tests[i]->path), "moved");
+        if (tests[i]->path == NULL) {
+            expected = g_list_append(expected, "");
+        }
+        GList* path = upg_uri_get_path(uri);
+        g_assert_cmpuint(g_list_length(path), ==, g_list_length(expected));
+        g_assert_true(compare_lists(path, expected));
+        g_list_free_full(path, g_free);
+        g_list_free(expected);
+
+        gchar* fragment = upg_uri_get_fragment(uri);
+        g_assert_cmpstr(fragment, ==, tests[i]->fragment);
+        g_free(fragment);
+
+        g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 0), ==, 1);
+        g_object_unref(uri);
+        g_object_unref(engine);
+    }
+}
+
+static void hits(void)
+{
+    UpgRewriteEngine* engine = make_engine();
+
+    for (gint n = 0; n < 3; n++) {
+        UpgUri* uri = upg_uri_new("http://old.example/blog/x", NULL);
+        upg_rewrite_engine_apply(engine, uri);
+        g_object_unref(uri);
+    }
+
+    UpgUri* uri = upg_uri_new("http://other.example/x", NULL);
+    g_assert_cmpint(upg_rewrite_engine_match(engine, uri), ==, 6);
+    g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 6), ==, 0);
+    upg_rewrite_engine_apply(engine, uri);
+    g_object_unref(uri);
+
+    g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 0), ==, 3);
+    g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 3), ==, 0);
+    g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 6), ==, 1);
+
+    upg_rewrite_engine_reset_hits(engine);
+    g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 0), ==, 0);
+    g_assert_cmpuint(upg_rewrite_engine_get_hits(engine, 6), ==, 0);
+
+    g_object_unref(engine);
+}
+
+static void invalid_rules(void)
+{
+    UpgRewriteEngine* engine = upg_rewrite_engine_new();
+    GError* error = NULL;
+
+    g_assert_cmpint(upg_rewrite_engine_add_rule(engine, NULL, "nope", "/b", &error), ==, -1);
+    g_assert_error(error, UPG_ERROR, UPG_ERR_PARSE);
+    g_clear_error(&error);
+
+    g_assert_cmpint(upg_rewrite_engine_add_rule(engine, NULL, "/a", "relative/path", &error), ==, -1);
+    g_assert_error(error, UPG_ERROR, UPG_ERR_REFERENCE);
+    g_clear_error(&error);
+
+    g_assert_cmpint(upg_rewrite_engine_add_rule(engine, "a.*.example", "/a", "/b", &error), ==, -1);
+    g_assert_error(error, UPG_ERROR, UPG_ERR_PARSE);
+    g_clear_error(&error);
+
+    g_assert_cmpint(upg_rewrite_engine_add_rule(engine, NULL, "/a", "http://[oops/", &error), ==, -1);
+    g_assert_nonnull(error);
+    g_clear_error(&error);
+
+    g_assert_cmpuint(upg_rewrite_engine_get_n_rules(engine), ==, 0);
+    g_object_unref(engine);
+}
+
+static void many_rules(void)
+{
+    UpgRewriteEngine* engine = upg_rewrite_engine_new();
+
+    for (gint i = 0; i < 5000; i++) {
+        gchar* host = g_strdup_printf("h%d.example", i);
+        gchar* target = g_strdup_printf("/q%d/", i);
+        g_assert_cmpint(upg_rewrite_engine_add_rule(engine, host, "/p/*", target, NULL), ==, i);
+        g_free(host);
+        g_free(target);
+    }
+
+    UpgUri* uri = upg_uri_new("http://h4321.example/p/z", NULL);
+    g_assert_cmpint(upg_rewrite_engine_apply(engine, uri), ==, 4321);
+
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://h4321.example/q4321/z");
+    g_free(str);
+
+    g_object_unref(uri);
+    g_object_unref(engine);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_rewrite_engine_apply", apply);
+    g_test_add_func("/upg_rewrite_engine_apply/no-match", no_match);
+    g_test_add_func("/upg_rewrite_engine_apply/tests", moves_tests);
+    g_test_add_func("/upg_rewrite_engine_apply/many-rules", many_rules);
+    g_test_add_func("/upg_rewrite_engine_get_hits", hits);
+    g_test_add_func("/upg_rewrite_engine_add_rule/invalid", invalid_rules);
+}
@@ -0,0 +1,288 @@
+/* router.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+typedef struct {
+    const gchar* path_template;
+    gint priority;
+} RouteDef;
+
+static const RouteDef routes[] = {
+    { "/", 0 },
+    { "/users", 0 },
+    { "/users/{id}", 0 },
+    { "/users/me", 0 },
+    { "/users/{id}/posts/{post}", 0 },
+    { "/static/*", 0 },
+    { "/*", 0 },
+    { "/admin/*", 10 },
+    { "/admin/{page}", 0 },
+};
+
+typedef struct {
+    const gchar* uri;
+    gint route;
+    const gchar* id;
+    guint n_rest;
+} RouteCase;
+
+static const RouteCase cases[] = {
+    { "http://example.com", 0, NULL, 0 },
+    { "http://example.com/", 0, NULL, 0 },
+    { "http://example.com/users", 1, NULL, 0 },
+    { "http://example.com/users/5", 2, "5", 0 },
+    { "http://example.com/users/me", 3, NULL, 0 },
+    { "http://example.com/users/5/posts/hello", 4, "5", 0 },
+    { "http://example.com/users/5/posts", 6, NULL, 3 },
+    { "http://example.com/users/", 6, NULL, 2 },
+    { "http://example.com/static", 5, NULL, 0 },
+    { "http://example.com/static/css/a.css", 5, NULL, 2 },
+    { "http://example.com/other?x=1", 6, NULL, 1 },
+    { "http://example.com/admin/users", 7, NULL, 1 },
+};
+
+static UpgRouter* make_router(void)
+{
+    UpgRouter* router = upg_router_new(NULL);
+    for (gsize i = 0; i < G_N_ELEMENTS(routes); i++) {
+        GError* error = NULL;
+        g_assert_true(upg_router_add(router, routes[i].path_template, routes[i].priority, GINT_TO_POINTER(i + 1), &error));
+        g_assert_no_error(error);
+    }
+    g_assert_cmpuint(upg_router_get_size(router), ==, G_N_ELEMENTS(routes));
+    return router;
+}
+
+static void lookup(void)
+{
+    UpgRouter* router = make_router();
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        UpgUri* uri = upg_uri_new(cases[i].uri, NULL);
+        g_assert_nonnull(uri);
+
+        UpgRouteMatch match;
+        g_assert_true(upg_router_lookup(router, uri, &match));
+        g_assert_cmpint(GPOINTER_TO_INT(match.value), ==, cases[i].route + 1);
+        g_assert_cmpint(match.priority, ==, routes[cases[i].route].priority);
+        g_assert_cmpuint(match.n_rest, ==, cases[i].n_rest);
+
+        UpgSlice id;
+        if (cases[i].id != NULL) {
+            g_assert_true(upg_route_match_get(&match, "id", &id));
+            g_assert_cmpuint(id.len, ==, strlen(cases[i].id));
+            g_assert_true(memcmp(id.data, cases[i].id, id.len) == 0);
+        } else {
+            g_assert_false(upg_route_match_get(&match, "id", &id));
+        }
+
+        g_object_unref(uri);
+    }
+
+    g_object_unref(router);
+}
+
+static void lookup_tests(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        // a variable for every segment of the path captures each of them
+        GString* path_template = g_string_new("/");
+        guint n = 0;
+        for (GList* segment = tests[i]->path; segment != NULL; segment = segment->next, n++) {
+            g_string_append_printf(path_template, "%s{s%u}", n == 0 ? "" : "/", n);
+        }
+
+        UpgRouter* router = upg_router_new(NULL);
+        g_assert_true(upg_router_add(router, path_template->str, 0, GINT_TO_POINTER(1), NULL));
+
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        UpgRouteMatch match;
+        g_assert_true(upg_router_lookup(router, uri, &match));
+        g_assert_cmpuint(match.n_variables, ==, n);
+        g_assert_cmpuint(match.n_rest, ==, 0);
+
+        n = 0;
+        for (GList* segment = tests[i]->path; segment != NULL; segment = segment->next, n++) {
+            g_assert_cmpuint(match.variables[n].len, ==, strlen(segment->data));
+            g_assert_true(memcmp(match.variables[n].data, segment->data, match.variables[n].len) == 0);
+        }
+
+        g_object_unref(uri);
+        g_object_unref(router);
+        g_string_free(path_template, TRUE);
+    }
+}
+
+static void captures(void)
+{
+    UpgRouter* router = make_router();
+    UpgUri* uri = upg_uri_new("http://example.com/users/alice/posts/first%20post", NULL);
+
+    UpgRouteMatch match;
+    g_assert_true(upg_router_lookup(router, uri, &match));
+    g_assert_cmpuint(match.n_variables, ==, 2);
+    g_assert_cmpstr(match.names[0], ==, "id");
+    g_assert_cmpstr(match.names[1], ==, "post");
+
+    gsize n_segments;
+    const UpgSlice* segments = upg_uri_get_path_segments(uri, &n_segments);
+    g_assert_true(match.variables[0].data == segments[1].data);
+    g_assert_true(match.variables[1].data == segments[3].data);
+    g_assert_cmpuint(match.variables[1].len, ==, strlen("first%20post"));
+
+    g_object_unref(uri);
+    uri = upg_uri_new("http://example.com/static/css/a.css", NULL);
+    g_assert_true(upg_router_lookup(router, uri, &match));
+    g_assert_cmpuint(match.n_rest, ==, 2);
+    g_assert_cmpuint(match.rest[0].len, ==, 3);
+    g_assert_true(memcmp(match.rest[0].data, "css", 3) == 0);
+    g_assert_cmpuint(match.rest[1].len, ==, 5);
+    g_assert_true(memcmp(match.rest[1].data, "a.css", 5) == 0);
+
+    g_object_unref(uri);
+    g_object_unref(router);
+}
+
+static void no_match(void)
+{
+    UpgRouter* router = upg_router_new(NULL);
+    g_assert_true(upg_router_add(router, "/users/{id}", 0, NULL, NULL));
+
+    UpgUri* uri = upg_uri_new("http://example.com/users/5/posts", NULL);
+    UpgRouteMatch match = { GINT_TO_POINTER(42) };
+    g_assert_false(upg_router_lookup(router, uri, &match));
+    g_assert_cmpint(GPOINTER_TO_INT(match.value), ==, 42);
+    g_object_unref(uri);
+
+    uri = upg_uri_new("http://example.com/", NULL);
+    g_assert_false(upg_router_lookup(router, uri, NULL));
+    g_object_unref(uri);
+
+    g_object_unref(router);
+}
+
+static void priorities(void)
+{
+    UpgRouter* router = upg_router_new(NULL);
+    g_assert_true(upg_router_add(router, "/a/{x}", 0, GINT_TO_POINTER(1), NULL));
+    g_assert_true(upg_router_add(router, "/a/b", 0, GINT_TO_POINTER(2), NULL));
+    g_assert_true(upg_router_add(router, "/{y}/b", 5, GINT_TO_POINTER(3), NULL));
+
+    UpgUri* uri = upg_uri_new("http://example.com/a/b", NULL);
+    UpgRouteMatch match;
+    g_assert_true(upg_router_lookup(router, uri, &match));
+    g_assert_cmpint(GPOINTER_TO_INT(match.value), ==, 3);
+    g_assert_true(upg_route_match_get(&match, "y", NULL));
+    g_object_unref(uri);
+
+    uri = upg_uri_new("http://example.com/a/c", NULL);
+    g_assert_true(upg_router_lookup(router, uri, &match));
+    g_assert_cmpint(GPOINTER_TO_INT(match.value), ==, 1);
+    g_object_unref(uri);
+
+    g_object_unref(router);
+}
+
+static void replace(void)
+{
+    UpgRouter* router = upg_router_new(g_free);
+    g_assert_true(upg_router_add(router, "/users/{id}", 0, g_strdup("first"), NULL));
+    g_assert_true(upg_router_add(router, "/users/{name}", 0, g_strdup("second"), NULL));
+    g_assert_cmpuint(upg_router_get_size(router), ==, 1);
+
+    UpgUri* uri = upg_uri_new("http://example.com/users/bob", NULL);
+    UpgRouteMatch match;
+    g_assert_true(upg_router_lookup(router, uri, &match));
+    g_assert_cmpstr(match.value, ==, "second");
+    g_assert_true(upg_route_match_get(&match, "name", NULL));
+    g_assert_false(upg_route_match_get(&match, "id", NULL));
+
+    g_object_unref(uri);
+    g_object_unref(router);
+}
+
+static void invalid(void)
+{
+    static const gchar* const templates[] = {
+        "",
+        "users",
+        "/*/users",
+        "/{id}/{id}",
+        "/{a{b}",
+        "/{0}/{1}/{2}/{3}/{4}/{5}/{6}/{7}/{8}/{9}/{10}/{11}/{12}/{13}/{14}/{15}/{16}",
+    };
+
+    UpgRouter* router = upg_router_new(g_free);
+    for (gsize i = 0; i < G_N_ELEMENTS(templates); i++) {
+        GError* error = NULL;
+        gchar* value = g_strdup("value");
+        g_assert_false(upg_router_add(router, templates[i], 0, value, &error));
+        g_assert_error(error, UPG_ERROR, UPG_ERR_PARSE);
+        g_error_free(error);
+        g_free(value);
+    }
+    g_assert_cmpuint(upg_router_get_size(router), ==, 0);
+
+    g_object_unref(router);
+}
+
+static void many_routes(void)
+{
+    UpgRouter* router = upg_router_new(NULL);
+
+    for (guint i = 0; i < 5000; i++) {
+        gchar* path_template = g_strdup_printf("/service%u/{id}/item%u", i % 100, i);
+        g_assert_true(upg_router_add(router, path_template, 0, GUINT_TO_POINTER(i + 1), NULL));
+        g_free(path_template);
+    }
+    g_assert_cmpuint(upg_router_get_size(router), ==, 5000);
+
+    for (guint i = 0; i < 5000; i += 7) {
+        gchar* str = g_strdup_printf("http://example.com/service%u/x%u/item%u", i % 100, i, i);
+        UpgUri* uri = upg_uri_new(str, NULL);
+
+        UpgRouteMatch match;
+        g_assert_true(upg_router_lookup(router, uri, &match));
+        g_assert_cmpuint(GPOINTER_TO_UINT(match.value), ==, i + 1);
+
+        gchar* id = g_strdup_printf("x%u", i);
+        g_assert_cmpuint(match.variables[0].len, ==, strlen(id));
+        g_assert_true(memcmp(match.variables[0].data, id, match.variables[0].len) == 0);
+        g_free(id);
+
+        g_object_unref(uri);
+        g_free(str);
+    }
+
+    g_object_unref(router);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_router_lookup", lookup);
+    g_test_add_func("/upg_router_lookup/tests", lookup_tests);
+    g_test_add_func("/upg_router_lookup/captures", captures);
+    g_test_add_func("/upg_router_lookup/no-match", no_match);
+    g_test_add_func("/upg_router_lookup/priorities", priorities);
+    g_test_add_func("/upg_router_add/replace", replace);
+    g_test_add_func("/upg_router_add/invalid", invalid);
+    g_test_add_func("/upg_router_lookup/many-routes", many_routes);
+}
@@ -0,0 +1,106 @@
+/* segments.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void get_path_segments(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        gsize n_segments = 0;
+        const UpgSlice* segments = upg_uri_get_path_segments(uri, &n_segments);
+        g_assert_cmpuint(n_segments, ==, g_list_length(tests[i]->path));
+
+        GList* expected = tests[i]->path;
+        for (gsize j = 0; j < n_segments; j++, expected = expected->next) {
+            g_assert_cmpuint(segments[j].len, ==, strlen(expected->data));
+            g_assert_cmpmem(segments[j].data, segments[j].len, expected->data, strlen(expected->data));
+        }
+
+        gchar** strv = upg_uri_get_path_strv(uri);
+        g_assert_cmpuint(g_strv_length(strv), ==, n_segments);
+        expected = tests[i]->path;
+        for (gsize j = 0; strv[j] != NULL; j++, expected = expected->next) {
+            g_assert_cmpstr(strv[j], ==, expected->data);
+        }
+        g_strfreev(strv);
+
+        g_object_unref(uri);
+    }
+}
+
+static void get_path_segments_follows_changes(void)
+{
+    UpgUri* uri = upg_uri_new("https://example.com/a/b/c", NULL);
+
+    gsize n_segments = 0;
+    upg_uri_get_path_segments(uri, &n_segments);
+    g_assert_cmpuint(n_segments, ==, 3);
+
+    upg_uri_set_path_str(uri, "/d/");
+    const UpgSlice* segments = upg_uri_get_path_segments(uri, &n_segments);
+    g_assert_cmpuint(n_segments, ==, 2);
+    g_assert_cmpmem(segments[0].data, segments[0].len, "d", 1);
+    g_assert_cmpuint(segments[1].len, ==, 0);
+
+    gchar* str = upg_uri_get_path_str(uri);
+    g_assert_cmpstr(str, ==, "/d/");
+    g_free(str);
+
+    upg_uri_configure_from_string(uri, "https://example.com", NULL);
+    upg_uri_get_path_segments(uri, &n_segments);
+    g_assert_cmpuint(n_segments, ==, 0);
+
+    gchar** strv = upg_uri_get_path_strv(uri);
+    g_assert_nonnull(strv);
+    g_assert_null(strv[0]);
+    g_strfreev(strv);
+
+    g_object_unref(uri);
+}
+
+static void get_path_str(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        GString* expected = g_string_new(NULL);
+        for (GList* current = tests[i]->path; current != NULL; current = current->next) {
+            g_string_append_c(expected, '/');
+            g_string_append(expected, current->data);
+        }
+
+        gchar* str = upg_uri_get_path_str(uri);
+        g_assert_cmpstr(str, ==, expected->str);
+        g_free(str);
+
+        g_string_free(expected, TRUE);
+        g_object_unref(uri);
+    }
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_get_path_segments", get_path_segments);
+    g_test_add_func("/upg_uri_get_path_segments/changes", get_path_segments_follows_changes);
+    g_test_add_func("/upg_uri_get_path_str", get_path_str);
+}
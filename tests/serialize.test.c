@@ -0,0 +1,92 @@
+/* serialize.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void to_string_buf_fits(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        gsize expected = strlen(tests[i]->uri);
+
+        gchar buf[512];
+        gsize written = 0;
+        g_assert_true(upg_uri_to_string_buf(uri, buf, sizeof(buf), &written));
+        g_assert_cmpuint(written, ==, expected);
+        g_assert_cmpstr(buf, ==, tests[i]->uri);
+
+        gchar* exact = g_malloc(expected + 1);
+        g_assert_true(upg_uri_to_string_buf(uri, exact, expected + 1, NULL));
+        g_assert_cmpstr(exact, ==, tests[i]->uri);
+        g_free(exact);
+
+        g_object_unref(uri);
+    }
+}
+
+static void to_string_buf_too_small(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        gsize expected = strlen(tests[i]->uri);
+
+        gchar buf[8];
+        gsize written = 0;
+        g_assert_false(upg_uri_to_string_buf(uri, buf, sizeof(buf), &written));
+        g_assert_cmpuint(written, ==, expected);
+
+        written = 0;
+        g_assert_false(upg_uri_to_string_buf(uri, NULL, 0, &written));
+        g_assert_cmpuint(written, ==, expected);
+
+        g_object_unref(uri);
+    }
+}
+
+static void append_to_gstring(void)
+{
+    GString* str = g_string_new("<");
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        g_string_truncate(str, 1);
+        upg_uri_append_to_gstring(uri, str);
+        g_string_append_c(str, '>');
+
+        gchar* expected = g_strdup_printf("<%s>", tests[i]->uri);
+        g_assert_cmpstr(str->str, ==, expected);
+        g_assert_cmpuint(str->len, ==, strlen(expected));
+        g_free(expected);
+
+        g_object_unref(uri);
+    }
+
+    g_string_free(str, TRUE);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_to_string_buf", to_string_buf_fits);
+    g_test_add_func("/upg_uri_to_string_buf/too-small", to_string_buf_too_small);
+    g_test_add_func("/upg_uri_append_to_gstring", append_to_gstring);
+}
@@ -0,0 +1,143 @@
+/* set.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void add_and_contains(void)
+{
+    UpgUriSet* set = upg_uri_set_new(0);
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        g_assert_false(upg_uri_set_contains(set, uri));
+        g_assert_true(upg_uri_set_add(set, uri));
+        g_assert_false(upg_uri_set_add(set, uri));
+        g_assert_false(upg_uri_set_add_string(set, tests[i]->uri, -1));
+        g_assert_true(upg_uri_set_contains(set, uri));
+        g_assert_true(upg_uri_set_contains_string(set, tests[i]->uri, strlen(tests[i]->uri)));
+
+        g_object_unref(uri);
+    }
+
+    g_assert_cmpuint(upg_uri_set_get_size(set), ==, i);
+    g_assert_false(upg_uri_set_contains_string(set, "https://example.com", -1));
+
+    g_object_unref(set);
+}
+
+static void strings_and_uris_match(void)
+{
+    UpgUriSet* set = upg_uri_set_new(0);
+
+    UpgUri* uri = upg_uri_new("http://example.com/~user", NULL);
+    g_assert_true(upg_uri_set_add(set, uri));
+    g_assert_true(upg_uri_set_contains_string(set, "HTTP://Example.COM/%7euser", -1));
+    g_assert_false(upg_uri_set_add_string(set, "http://EXAMPLE.com/%7Euser", -1));
+
+    g_assert_true(upg_uri_set_add_string(set, "HTTPS://Example.com/a/./b/../c", -1));
+    UpgUri* other = upg_uri_new("https://example.com/a/c", NULL);
+    g_assert_true(upg_uri_set_contains(set, other));
+    g_object_unref(other);
+
+    // changed with a setter, so it isn't normalized until the set does it
+    upg_uri_set_host(uri, "Other.Example");
+    g_assert_true(upg_uri_set_add(set, uri));
+    g_assert_true(upg_uri_set_contains_string(set, "http://other.example/~user", -1));
+
+    g_assert_cmpuint(upg_uri_set_get_size(set), ==, 3);
+    g_object_unref(uri);
+    g_object_unref(set);
+}
+
+static void grows(void)
+{
+    UpgUriSet* set = upg_uri_set_new(0);
+
+    for (guint i = 0; i < 100000; i++) {
+        gchar* uri = g_strdup_printf("https://example.com/%u", i);
+        g_assert_true(upg_uri_set_add_string(set, uri, -1));
+        g_free(uri);
+    }
+
+    // adding them again shouldn't change anything, even after growing
+    for (guint i = 0; i < 100000; i++) {
+        gchar* uri = g_strdup_printf("https://example.com/%u", i);
+        g_assert_false(upg_uri_set_add_string(set, uri, -1));
+        g_free(uri);
+    }
+
+    g_assert_cmpuint(upg_uri_set_get_size(set), ==, 100000);
+    g_object_unref(set);
+}
+
+static void iterates_in_order(void)
+{
+    UpgUriSet* set = upg_uri_set_new(4);
+    const gchar* uris[] = { "https://a.example", "https://b.example/", "https://a.example", "https://c.example/?q" };
+    const gchar* expected[] = { "https://a.example", "https://b.example/", "https://c.example/?q" };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(uris); i++) {
+        upg_uri_set_add_string(set, uris[i], -1);
+    }
+
+    UpgUriSetIter iter;
+    const gchar* uri = NULL;
+    gsize len = 0;
+    gsize n = 0;
+    upg_uri_set_iter_init(&iter, set);
+    while (upg_uri_set_iter_next(&iter, &uri, &len)) {
+        g_assert_cmpuint(n, <, G_N_ELEMENTS(expected));
+        g_assert_cmpstr(uri, ==, expected[n]);
+        g_assert_cmpuint(len, ==, strlen(expected[n]));
+        n++;
+    }
+    g_assert_cmpuint(n, ==, G_N_ELEMENTS(expected));
+
+    g_object_unref(set);
+}
+
+static void union_(void)
+{
+    UpgUriSet* a = upg_uri_set_new(0);
+    UpgUriSet* b = upg_uri_set_new(0);
+
+    upg_uri_set_add_string(a, "https://a.example", -1);
+    upg_uri_set_add_string(a, "https://both.example", -1);
+    upg_uri_set_add_string(b, "https://both.example", -1);
+    upg_uri_set_add_string(b, "https://b.example", -1);
+
+    upg_uri_set_union(a, b);
+    g_assert_cmpuint(upg_uri_set_get_size(a), ==, 3);
+    g_assert_true(upg_uri_set_contains_string(a, "https://b.example", -1));
+    g_assert_cmpuint(upg_uri_set_get_size(b), ==, 2);
+
+    g_object_unref(a);
+    g_object_unref(b);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_set_add", add_and_contains);
+    g_test_add_func("/upg_uri_set_add/normalizes", strings_and_uris_match);
+    g_test_add_func("/upg_uri_set_add/grows", grows);
+    g_test_add_func("/upg_uri_set_iter_next", iterates_in_order);
+    g_test_add_func("/upg_uri_set_union", union_);
+}
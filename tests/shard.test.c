@@ -0,0 +1,103 @@
+/* shard.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static guint64 hash_authority(const gchar* str)
+{
+    UpgUri* uri = upg_uri_new(str, NULL);
+    g_assert_nonnull(uri);
+    guint64 hash = upg_uri_hash_authority(uri);
+    g_object_unref(uri);
+    return hash;
+}
+
+static void authority_same(void)
+{
+    guint64 hash = hash_authority("http://example.com/");
+
+    g_assert_cmpuint(hash_authority("http://example.com/a/b?c#d"), ==, hash);
+    g_assert_cmpuint(hash_authority("HTTP://Example.COM/"), ==, hash);
+    g_assert_cmpuint(hash_authority("http://example.com:80/"), ==, hash);
+    g_assert_cmpuint(hash_authority("http://user@example.com/"), ==, hash);
+}
+
+static void authority_different(void)
+{
+    guint64 hash = hash_authority("http://example.com/");
+
+    g_assert_cmpuint(hash_authority("https://example.com/"), !=, hash);
+    g_assert_cmpuint(hash_authority("http://example.com:8080/"), !=, hash);
+    g_assert_cmpuint(hash_authority("http://www.example.com/"), !=, hash);
+    g_assert_cmpuint(hash_authority("http://example.org/"), !=, hash);
+}
+
+static void authority_stable(void)
+{
+    // these must never change, since hashes are shared between machines
+    g_assert_cmpuint(hash_authority("http://example.com/"), ==, G_GUINT64_CONSTANT(0x859051a166c3f052));
+    g_assert_cmpuint(hash_authority("https://example.com/"), ==, G_GUINT64_CONSTANT(0xd742027a1d1bdee8));
+    g_assert_cmpuint(hash_authority("gemini://gemini.circumlunar.space/"), ==, G_GUINT64_CONSTANT(0xa79c686cdb317133));
+}
+
+static void jump_stable(void)
+{
+    g_assert_cmpuint(upg_jump_consistent_hash(0, 10), ==, 0);
+    g_assert_cmpuint(upg_jump_consistent_hash(1, 10), ==, 6);
+    g_assert_cmpuint(upg_jump_consistent_hash(0xdeadbeef, 100), ==, 87);
+    g_assert_cmpuint(upg_jump_consistent_hash(G_MAXUINT64, 12345), ==, 5934);
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+        g_assert_cmpuint(upg_uri_get_shard(uri, 1), ==, 0);
+        g_assert_cmpuint(upg_uri_get_shard(uri, 1000), <, 1000);
+        g_object_unref(uri);
+    }
+}
+
+static void jump_movement(void)
+{
+    guint moved = 0;
+
+    for (guint64 key = 0; key < 10000; key++) {
+        guint64 hashed = key * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15);
+        guint32 before = upg_jump_consistent_hash(hashed, 10);
+        guint32 after = upg_jump_consistent_hash(hashed, 11);
+
+        g_assert_cmpuint(before, <, 10);
+        if (before != after) {
+            g_assert_cmpuint(after, ==, 10);
+            moved++;
+        }
+    }
+
+    // about one in eleven should move
+    g_assert_cmpuint(moved, >, 600);
+    g_assert_cmpuint(moved, <, 1200);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_hash_authority/same", authority_same);
+    g_test_add_func("/upg_uri_hash_authority/different", authority_different);
+    g_test_add_func("/upg_uri_hash_authority/stable", authority_stable);
+    g_test_add_func("/upg_jump_consistent_hash/stable", jump_stable);
+    g_test_add_func("/upg_jump_consistent_hash/movement", jump_movement);
+}
@@ -0,0 +1,159 @@
+/* sort.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static gint compare_indirect(gconstpointer a, gconstpointer b)
+{
+    return upg_uri_compare(*(UpgUri**)a, *(UpgUri**)b);
+}
+
+static void compare(void)
+{
+    Test* all = get_tests();
+
+    FOR_EACH_CASE(tests)
+    {
+        UpgUri* a = upg_uri_new(tests[i]->uri, NULL);
+        UpgUri* copy = upg_uri_copy(a);
+        g_assert_cmpint(upg_uri_compare(a, copy), ==, 0);
+
+        for (gint j = 0; all[j] != NULL; j++) {
+            UpgUri* b = upg_uri_new(all[j]->uri, NULL);
+            gint ab = upg_uri_compare(a, b);
+            gint ba = upg_uri_compare(b, a);
+
+            g_assert_cmpint(ab < 0, ==, ba > 0);
+            g_assert_cmpint(ab == 0, ==, i == j);
+
+            g_object_unref(b);
+        }
+
+        g_object_unref(copy);
+        g_object_unref(a);
+    }
+}
+
+static void compare_order(void)
+{
+    const gchar* ordered[] = {
+        "a://example.com",
+        "b://",
+        "b://a.example",
+        "b://a.example:1",
+        "b://a.example:2/",
+        "b://a.example:2/a",
+        "b://a.example:2/a/",
+        "b://a.example:2/a/b",
+        "b://a.example:2/a/b?q",
+        "b://a.example:2/a/b?q#f",
+        "b://a.example:2/b",
+        "b://user@a.example:2/",
+    };
+
+    for (gsize i = 0; i + 1 < G_N_ELEMENTS(ordered); i++) {
+        UpgUri* a = upg_uri_new(ordered[i], NULL);
+        UpgUri* b = upg_uri_new(ordered[i + 1], NULL);
+        g_assert_cmpint(upg_uri_compare(a, b), <, 0);
+        g_object_unref(a);
+        g_object_unref(b);
+    }
+}
+
+static void sort(void)
+{
+    const gchar* schemes[] = { "http", "https", "ftp" };
+    const gchar* hosts[] = { "example.com", "example.org", "a.example.com", "localhost" };
+    const gchar* ports[] = { "", ":80", ":8080" };
+    const gchar* segments[] = { "a", "b", "ab", "", "index.html", "aaaaaaaaaaaaaaaa" };
+    const gchar* tails[] = { "", "?q=1", "?q=2", "#f", "?q=1#f" };
+
+    GPtrArray* uris = g_ptr_array_new_with_free_func(g_object_unref);
+    GRand* rand = g_rand_new_with_seed(0x5eed);
+
+    for (guint i = 0; i < 5000; i++) {
+        GString* str = g_string_new(NULL);
+        g_string_append_printf(str, "%s://%s%s",
+            schemes[g_rand_int_range(rand, 0, G_N_ELEMENTS(schemes))],
+            hosts[g_rand_int_range(rand, 0, G_N_ELEMENTS(hosts))],
+            ports[g_rand_int_range(rand, 0, G_N_ELEMENTS(ports))]);
+
+        gint depth = g_rand_int_range(rand, 0, 5);
+        for (gint j = 0; j < depth; j++) {
+            g_string_append_printf(str, "/%s", segments[g_rand_int_range(rand, 0, G_N_ELEMENTS(segments))]);
+        }
+        g_string_append(str, tails[g_rand_int_range(rand, 0, G_N_ELEMENTS(tails))]);
+
+        UpgUri* uri = upg_uri_new(str->str, NULL);
+        g_assert_nonnull(uri);
+        g_ptr_array_add(uris, uri);
+        g_string_free(str, TRUE);
+    }
+
+    GPtrArray* expected = g_ptr_array_sized_new(uris->len);
+    for (guint i = 0; i < uris->len; i++) {
+        g_ptr_array_add(expected, uris->pdata[i]);
+    }
+    g_ptr_array_sort(expected, compare_indirect);
+
+    upg_uri_sort((UpgUri**)uris->pdata, uris->len);
+
+    for (guint i = 0; i < uris->len; i++) {
+        g_assert_cmpint(upg_uri_compare(uris->pdata[i], expected->pdata[i]), ==, 0);
+    }
+
+    g_ptr_array_unref(expected);
+    g_rand_free(rand);
+    g_ptr_array_unref(uris);
+}
+
+static void sort_long_prefix(void)
+{
+    // thousands of bytes in common, which used to be one recursion per eight
+    GString* prefix = g_string_new("https://example.com/");
+    for (guint i = 0; i < 4000; i++) {
+        g_string_append(prefix, "abcdefgh/");
+    }
+
+    GPtrArray* uris = g_ptr_array_new_with_free_func(g_object_unref);
+    for (guint i = 0; i < 200; i++) {
+        gchar* str = g_strdup_printf("%s%u", prefix->str, (i * 7919) % 200);
+        UpgUri* uri = upg_uri_new(str, NULL);
+        g_assert_nonnull(uri);
+        g_ptr_array_add(uris, uri);
+        g_free(str);
+    }
+
+    upg_uri_sort((UpgUri**)uris->pdata, uris->len);
+
+    for (guint i = 0; i + 1 < uris->len; i++) {
+        g_assert_cmpint(upg_uri_compare(uris->pdata[i], uris->pdata[i + 1]), <=, 0);
+    }
+
+    g_ptr_array_unref(uris);
+    g_string_free(prefix, TRUE);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_compare", compare);
+    g_test_add_func("/upg_uri_compare/order", compare_order);
+    g_test_add_func("/upg_uri_sort", sort);
+    g_test_add_func("/upg_uri_sort/long-prefix", sort_long_prefix);
+}
@@ -0,0 +1,110 @@
+/* stream.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static gchar* steal_stream_text(GOutputStream* stream)
+{
+    g_assert_true(g_output_stream_write_all(stream, "", 1, NULL, NULL, NULL));
+    g_assert_true(g_output_stream_close(stream, NULL, NULL));
+    return g_memory_output_stream_steal_data(G_MEMORY_OUTPUT_STREAM(stream));
+}
+
+static void write_to_stream(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        GOutputStream* stream = g_memory_output_stream_new_resizable();
+        UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+        g_assert_true(upg_uri_write_to_stream(uri, stream, NULL, NULL));
+
+        gchar* text = steal_stream_text(stream);
+        g_assert_cmpstr(text, ==, tests[i]->uri);
+        g_free(text);
+
+        g_object_unref(uri);
+        g_object_unref(stream);
+    }
+}
+
+static void writer_writes_everything(void)
+{
+    GOutputStream* stream = g_memory_output_stream_new_resizable();
+    UpgUriWriter* writer = upg_uri_writer_new(stream, NULL);
+    GString* expected = g_string_new(NULL);
+
+    // enough rounds to go through all of the writer's buffers a few times
+    for (guint round = 0; round < 2000; round++) {
+        FOR_EACH_CASE(tests)
+        {
+            UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+            g_assert_true(upg_uri_writer_add(writer, uri, NULL, NULL));
+            g_object_unref(uri);
+
+            g_string_append(expected, tests[i]->uri);
+            g_string_append_c(expected, '\n');
+        }
+    }
+
+    g_assert_true(upg_uri_writer_flush(writer, NULL, NULL));
+
+    gchar* text = steal_stream_text(stream);
+    g_assert_cmpuint(strlen(text), ==, expected->len);
+    g_assert_cmpstr(text, ==, expected->str);
+    g_free(text);
+
+    g_string_free(expected, TRUE);
+    g_object_unref(writer);
+    g_object_unref(stream);
+}
+
+static void writer_add_many(void)
+{
+    GOutputStream* stream = g_memory_output_stream_new_resizable();
+    UpgUriWriter* writer = upg_uri_writer_new(stream, ", ");
+    GPtrArray* uris = g_ptr_array_new_with_free_func(g_object_unref);
+    GString* expected = g_string_new(NULL);
+
+    FOR_EACH_CASE(tests)
+    {
+        g_ptr_array_add(uris, upg_uri_new(tests[i]->uri, NULL));
+        g_string_append_printf(expected, "%s, ", tests[i]->uri);
+    }
+
+    g_assert_true(upg_uri_writer_add_many(writer, (UpgUri**)uris->pdata, uris->len, NULL, NULL));
+
+    // disposing the writer flushes it
+    g_object_unref(writer);
+
+    gchar* text = steal_stream_text(stream);
+    g_assert_cmpstr(text, ==, expected->str);
+    g_free(text);
+
+    g_string_free(expected, TRUE);
+    g_ptr_array_unref(uris);
+    g_object_unref(stream);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_write_to_stream", write_to_stream);
+    g_test_add_func("/upg_uri_writer_add", writer_writes_everything);
+    g_test_add_func("/upg_uri_writer_add_many", writer_add_many);
+}
@@ -0,0 +1,203 @@
+/* trie.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static gint compare_pointers(gconstpointer a, gconstpointer b)
+{
+    gconstpointer pa = *(gconstpointer*)a;
+    gconstpointer pb = *(gconstpointer*)b;
+    return pa < pb ? -1 : pa > pb;
+}
+
+/*
+ * make_prefixes:
+ *
+ * Makes every test case, and every URI that's the same as one but with a
+ * shorter path.
+ */
+static GPtrArray* make_prefixes(void)
+{
+    GPtrArray* prefixes = g_ptr_array_new_with_free_func(g_object_unref);
+    GHashTable* seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    FOR_EACH_CASE(tests)
+    {
+        guint depth = g_list_length(tests[i]->path);
+        for (guint j = 0; j <= depth; j++) {
+            UpgUri* uri = upg_uri_new(tests[i]->uri, NULL);
+
+            GList* path = NULL;
+            GList* current = tests[i]->path;
+            for (guint k = 0; k < j; k++, current = current->next) {
+                path = g_list_append(path, current->data);
+            }
+            upg_uri_set_path(uri, path);
+            g_list_free(path);
+
+            gchar* str = upg_uri_to_string(uri);
+            if (g_hash_table_add(seen, str)) {
+                g_ptr_array_add(prefixes, uri);
+            } else {
+                g_object_unref(uri);
+            }
+        }
+    }
+
+    g_hash_table_unref(seen);
+    return prefixes;
+}
+
+static void assert_same_values(GPtrArray* actual, GPtrArray* expected)
+{
+    g_ptr_array_sort(actual, compare_pointers);
+    g_ptr_array_sort(expected, compare_pointers);
+
+    g_assert_cmpuint(actual->len, ==, expected->len);
+    for (guint i = 0; i < actual->len; i++) {
+        g_assert_true(actual->pdata[i] == expected->pdata[i]);
+    }
+}
+
+static void check_against_is_parent_of(UpgHierarchyFlags flags)
+{
+    GPtrArray* prefixes = make_prefixes();
+    UpgUriTrie* trie = upg_uri_trie_new(80, flags, NULL);
+
+    for (guint i = 0; i < prefixes->len; i++) {
+        upg_uri_trie_insert(trie, prefixes->pdata[i], prefixes->pdata[i]);
+    }
+    g_assert_cmpuint(upg_uri_trie_get_size(trie), ==, prefixes->len);
+
+    for (guint i = 0; i < prefixes->len; i++) {
+        UpgUri* uri = prefixes->pdata[i];
+        GPtrArray* expected_ancestors = g_ptr_array_new();
+        GPtrArray* expected_descendants = g_ptr_array_new();
+
+        for (guint j = 0; j < prefixes->len; j++) {
+            if (upg_uri_is_parent_of(prefixes->pdata[j], uri, 80, flags)) {
+                g_ptr_array_add(expected_ancestors, prefixes->pdata[j]);
+            }
+
+            if (upg_uri_is_parent_of(uri, prefixes->pdata[j], 80, flags)) {
+                g_ptr_array_add(expected_descendants, prefixes->pdata[j]);
+            }
+        }
+
+        GPtrArray* ancestors = upg_uri_trie_ancestors(trie, uri);
+        gpointer longest = NULL;
+        g_assert_cmpint(upg_uri_trie_longest_prefix(trie, uri, &longest), ==, ancestors->len > 0);
+        if (ancestors->len > 0) {
+            g_assert_true(longest == ancestors->pdata[ancestors->len - 1]);
+        }
+        assert_same_values(ancestors, expected_ancestors);
+
+        GPtrArray* descendants = upg_uri_trie_descendants(trie, uri);
+        assert_same_values(descendants, expected_descendants);
+
+        g_ptr_array_unref(ancestors);
+        g_ptr_array_unref(descendants);
+        g_ptr_array_unref(expected_ancestors);
+        g_ptr_array_unref(expected_descendants);
+    }
+
+    g_object_unref(trie);
+    g_ptr_array_unref(prefixes);
+}
+
+static void trie_lax(void)
+{
+    check_against_is_parent_of(UPG_HIERARCHY_LAX);
+}
+
+static void trie_strict(void)
+{
+    check_against_is_parent_of(UPG_HIERARCHY_STRICT);
+}
+
+static void trie_notself(void)
+{
+    check_against_is_parent_of(UPG_HIERARCHY_NOTSELF);
+}
+
+static void trie_ignoreport(void)
+{
+    UpgUriTrie* trie = upg_uri_trie_new(0, UPG_HIERARCHY_IGNOREPORT, g_free);
+    UpgUri* prefix = upg_uri_new("https://example.com:8443/docs", NULL);
+    UpgUri* uri = upg_uri_new("https://example.com/docs/api/index.html", NULL);
+
+    upg_uri_trie_insert(trie, prefix, g_strdup("docs"));
+
+    gpointer value = NULL;
+    g_assert_true(upg_uri_trie_longest_prefix(trie, uri, &value));
+    g_assert_cmpstr(value, ==, "docs");
+
+    g_assert_true(upg_uri_trie_remove(trie, prefix));
+    g_assert_false(upg_uri_trie_remove(trie, prefix));
+    g_assert_false(upg_uri_trie_longest_prefix(trie, uri, NULL));
+    g_assert_cmpuint(upg_uri_trie_get_size(trie), ==, 0);
+
+    g_object_unref(uri);
+    g_object_unref(prefix);
+    g_object_unref(trie);
+}
+
+static void trie_remove(void)
+{
+    GPtrArray* prefixes = make_prefixes();
+    UpgUriTrie* trie = upg_uri_trie_new(80, UPG_HIERARCHY_LAX, NULL);
+
+    // twice, so that nodes freed by the first round of removals come back
+    for (guint round = 0; round < 2; round++) {
+        for (guint i = 0; i < prefixes->len; i++) {
+            upg_uri_trie_insert(trie, prefixes->pdata[i], prefixes->pdata[i]);
+        }
+
+        // freeing empty nodes mustn't lose anything that's still there
+        for (guint i = 0; i < prefixes->len; i++) {
+            g_assert_true(upg_uri_trie_remove(trie, prefixes->pdata[i]));
+            g_assert_false(upg_uri_trie_remove(trie, prefixes->pdata[i]));
+            g_assert_cmpuint(upg_uri_trie_get_size(trie), ==, prefixes->len - i - 1);
+
+            for (guint j = i + 1; j < prefixes->len; j++) {
+                gpointer value = NULL;
+                g_assert_true(upg_uri_trie_longest_prefix(trie, prefixes->pdata[j], &value));
+                g_assert_true(value == prefixes->pdata[j]);
+            }
+        }
+
+        for (guint i = 0; i < prefixes->len; i++) {
+            GPtrArray* descendants = upg_uri_trie_descendants(trie, prefixes->pdata[i]);
+            g_assert_cmpuint(descendants->len, ==, 0);
+            g_ptr_array_unref(descendants);
+        }
+    }
+
+    g_object_unref(trie);
+    g_ptr_array_unref(prefixes);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_trie/lax", trie_lax);
+    g_test_add_func("/upg_uri_trie/strict", trie_strict);
+    g_test_add_func("/upg_uri_trie/notself", trie_notself);
+    g_test_add_func("/upg_uri_trie/ignoreport", trie_ignoreport);
+    g_test_add_func("/upg_uri_trie/remove", trie_remove);
+}
@@ -0,0 +1,87 @@
+/* utf16.test.c
+ *
+ * Copyright 2021 thatlittlegit <personal@thatlittlegit.tk>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+#include "common.h"
+
+static void parses_cases(void)
+{
+    FOR_EACH_CASE(tests)
+    {
+        glong len = 0;
+        gunichar2* wide = g_utf8_to_utf16(tests[i]->nonnormalized, -1, NULL, &len, NULL);
+
+        GError* error = NULL;
+        UpgUri* uri = upg_uri_new_utf16(wide, len, &error);
+        g_assert_no_error(error);
+
+        gchar* str = upg_uri_to_string(uri);
+        g_assert_cmpstr(str, ==, tests[i]->uri);
+        g_free(str);
+
+        gchar* host = upg_uri_get_host(uri);
+        g_assert_cmpstr(host, ==, tests[i]->host);
+        g_free(host);
+
+        g_object_unref(uri);
+
+        // nul-terminated, into an existing URI
+        uri = upg_uri_new("http://example.com/", NULL);
+        g_assert_true(upg_uri_configure_from_utf16(uri, wide, -1, &error));
+        g_assert_no_error(error);
+        g_assert_cmpuint(upg_uri_get_port(uri), ==, tests[i]->port);
+        g_object_unref(uri);
+
+        g_free(wide);
+    }
+}
+
+static void rejects_non_ascii(void)
+{
+    gunichar2* wide = g_utf8_to_utf16("http://example.com/\xc3\xa9", -1, NULL, NULL, NULL);
+
+    GError* error = NULL;
+    g_assert_null(upg_uri_new_utf16(wide, -1, &error));
+    g_assert_error(error, UPG_ERROR, UPG_ERR_PARSE);
+    g_error_free(error);
+
+    g_free(wide);
+}
+
+static void partial(void)
+{
+    gunichar2* wide = g_utf8_to_utf16("http://example.com/a/b#junk", -1, NULL, NULL, NULL);
+
+    UpgUri* uri = upg_uri_new_utf16(wide, 22, NULL);
+    gchar* str = upg_uri_to_string(uri);
+    g_assert_cmpstr(str, ==, "http://example.com/a/b");
+    g_free(str);
+
+    g_assert_true(upg_uri_configure_from_utf16(uri, NULL, 0, NULL));
+    g_assert_null(upg_uri_get_host(uri));
+
+    g_object_unref(uri);
+    g_free(wide);
+}
+
+declare_tests
+{
+    g_test_add_func("/upg_uri_new_utf16", parses_cases);
+    g_test_add_func("/upg_uri_new_utf16/non-ascii", rejects_non_ascii);
+    g_test_add_func("/upg_uri_new_utf16/partial", partial);
+}